@@ -0,0 +1,417 @@
+// NumericBenchmarks.cpp : Measures how fast add_numbers / subtract_numbers run for every type and backend.
+//
+// Sweeps tested_types (NumericTypeList.h), the types do_overflow_tests() uses, across several step counts
+// and four increment cases (a unit step, a walk that ends at the limit and never overflows, a walk refused
+// at the first step and one refused after five steps), through every backend from CheckedArithmetic.h and the stepwise reference loop.
+// Every type also times formatting one result as a report line: through an std::ostream (what printing with
+// std::cout costs) and with format_result (ResultFormat.h) into a stack buffer, floats as %g ("to_chars") and
+// as the shortest text that reads back exactly ("shortest").
+// Prints a table by default; --json writes the same rows as JSON so runs can be compared between releases.
+//
+// Usage: NumericBenchmarks [--json] [--out <file>] [--min-ms <milliseconds>]
+
+#include <chrono>       // std::chrono::steady_clock
+#include <cstdint>      // std::uint64_t
+#include <cstring>      // std::strcmp
+#include <fstream>      // std::ofstream
+#include <iomanip>      // std::setw, std::setprecision
+#include <iostream>     // std::cout, std::cerr
+#include <limits>       // std::numeric_limits
+#include <ostream>      // std::ostream
+#include <stdexcept>    // std::exception
+#include <streambuf>    // std::streambuf
+#include <string>       // std::string, std::stoul
+#include <type_traits>  // std::is_same, std::is_integral
+#include <vector>       // std::vector
+
+#include "NumericFunctions.h"
+#include "NumericTypeName.h"
+#include "ResultFormat.h"
+
+namespace
+{
+    // The stepwise reference loop, benchmarked alongside the backends as the baseline.
+    struct stepwise_reference {};
+
+    // The stepwise loop costs one add per step, so it is only timed up to this many steps.
+    const step_count_t stepwise_step_limit = 100000;
+
+    // Step counts every type is measured with. The last one is far more than any integer type has room for.
+    const step_count_t step_counts[] = { 1, 5, 1000, 1000000, step_count_t{ 1 } << 40 };
+
+    /// <summary>
+    /// One measured combination of type, backend, operation, case and step count.
+    /// </summary>
+    struct BenchmarkRow
+    {
+        std::string type;
+        std::string backend;
+        std::string operation;
+        std::string input_case;
+        step_count_t steps{ 0 };
+        bool success{ false };       // what the measured call returned, so the row says which path it timed
+        std::uint64_t iterations{ 0 };
+        double ns_per_op{ 0.0 };
+        double ops_per_sec{ 0.0 };
+    };
+
+    /// <summary>
+    /// Command line settings.
+    /// </summary>
+    struct BenchmarkOptions
+    {
+        bool json{ false };
+        std::string out_path;   // empty = print to the console
+        unsigned long min_ms{ 20 };
+    };
+
+    // Inputs are read and results written through volatiles, so the compiler can neither fold the
+    // constexpr engine at compile time nor hoist it out of the timing loop. Every row pays the same cost.
+    template <typename T>
+    T read_input(const volatile T& input)
+    {
+        return input;
+    }
+
+    template <typename T>
+    volatile T value_sink{};
+    volatile bool success_sink{ false };
+
+    template <typename T>
+    void consume(const CalcResult<T>& result)
+    {
+        value_sink<T> = result.value;
+        success_sink = result.success;
+    }
+
+    volatile std::size_t length_sink{ 0 };
+
+    /// <summary>
+    /// A stream buffer that counts what is written to it and throws it away, so the std::ostream rows
+    /// time the formatting and not the console.
+    /// </summary>
+    class DiscardBuffer : public std::streambuf
+    {
+    protected:
+        int_type overflow(int_type ch) override
+        {
+            length_sink = length_sink + 1;
+            return traits_type::not_eof(ch);
+        }
+
+        std::streamsize xsputn(const char* /*s*/, std::streamsize count) override
+        {
+            length_sink = length_sink + static_cast<std::size_t>(count);
+            return count;
+        }
+    };
+
+    /// <summary>
+    /// Runs body(iterations) with the number of iterations doubling until one batch takes at least min_ms,
+    /// and fills in the timing columns of row.
+    /// </summary>
+    template <typename Body>
+    void time_batches(BenchmarkRow& row, unsigned long min_ms, Body&& body)
+    {
+        using clock = std::chrono::steady_clock;
+
+        const auto min_time = std::chrono::milliseconds(min_ms);
+        for (std::uint64_t iterations = 1; ; iterations *= 2)
+        {
+            const clock::time_point begin = clock::now();
+            body(iterations);
+            const clock::duration elapsed = clock::now() - begin;
+
+            if (elapsed >= min_time || iterations >= (std::uint64_t{ 1 } << 40))
+            {
+                const double ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+                row.iterations = iterations;
+                row.ns_per_op = ns / static_cast<double>(iterations);
+                row.ops_per_sec = row.ns_per_op > 0.0 ? 1e9 / row.ns_per_op : 0.0;
+                return;
+            }
+        }
+    }
+
+    template <typename T, typename Backend>
+    CalcResult<T> run_once(bool subtract, T const& start, T const& amount, step_count_t steps)
+    {
+        if constexpr (std::is_same<Backend, stepwise_reference>::value)
+        {
+            return subtract ? subtract_numbers_stepwise<T>(start, amount, steps) : add_numbers_stepwise<T>(start, amount, steps);
+        }
+        else
+        {
+            return subtract ? subtract_numbers<T, Backend>(start, amount, steps) : add_numbers<T, Backend>(start, amount, steps);
+        }
+    }
+
+    /// <summary>
+    /// Times one call, doubling the number of iterations until a batch runs for at least min_ms.
+    /// </summary>
+    template <typename T, typename Backend>
+    BenchmarkRow measure(bool subtract, T const& start, T const& amount, step_count_t steps, unsigned long min_ms)
+    {
+        volatile T start_input = start;
+        volatile T amount_input = amount;
+
+        BenchmarkRow row{};
+        row.operation = subtract ? "subtract" : "add";
+        row.steps = steps;
+        row.success = run_once<T, Backend>(subtract, start, amount, steps).success;
+
+        time_batches(row, min_ms, [&](std::uint64_t iterations)
+        {
+            for (std::uint64_t i = 0; i < iterations; ++i)
+            {
+                consume(run_once<T, Backend>(subtract, read_input(start_input), read_input(amount_input), steps));
+            }
+        });
+        return row;
+    }
+
+    /// <summary>
+    /// Times turning the result of test_overflow's second call (refused after five steps) into report text,
+    /// through an std::ostream as std::cout would and with format_result into a stack buffer.
+    /// </summary>
+    template <typename T>
+    void bench_format(const char* type_name, const BenchmarkOptions& options, std::vector<BenchmarkRow>& rows)
+    {
+        const step_count_t steps = 6;
+        const CalcResult<T> result = add_numbers<T>(T{ 0 }, static_cast<T>(std::numeric_limits<T>::max() / 5), steps);
+        volatile T value_input = result.value;
+        volatile bool success_input = result.success;
+        volatile step_count_t step_input = result.failed_at_step;
+
+        const auto input = [&]()
+        {
+            CalcResult<T> r{};
+            r.value = read_input(value_input);
+            r.success = success_input;
+            r.failed_at_step = step_input;
+            return r;
+        };
+
+        DiscardBuffer discard;
+        std::ostream stream(&discard);
+
+        const char* const formatters[] = { "ostream", "to_chars", "shortest" };
+        for (int formatter = 0; formatter < 3; ++formatter)
+        {
+            BenchmarkRow row{};
+            row.type = type_name;
+            row.backend = formatters[formatter];
+            row.operation = "format";
+            row.input_case = "overflow_after_five";
+            row.steps = steps;
+            row.success = result.success;
+
+            time_batches(row, options.min_ms, [&](std::uint64_t iterations)
+            {
+                for (std::uint64_t i = 0; i < iterations; ++i)
+                {
+                    const CalcResult<T> r = input();
+                    if (formatter == 0)
+                    {
+                        stream << +r.value << ' ' << r.success << ' ' << r.failed_at_step << ' ' << r.precision_lost << '\n';
+                    }
+                    else
+                    {
+                        char line[result_text_capacity];
+                        const char* const end = format_result(line, line + sizeof(line), r, formatter == 2);
+                        length_sink = static_cast<std::size_t>(end - line);
+                    }
+                }
+            });
+            rows.push_back(row);
+        }
+    }
+
+    /// <summary>
+    /// Runs every operation, case and step count for one type through one backend.
+    /// </summary>
+    template <typename T, typename Backend>
+    void bench_backend(const char* type_name, const char* backend_name, const BenchmarkOptions& options,
+        std::vector<BenchmarkRow>& rows)
+    {
+        const T maxVal = std::numeric_limits<T>::max();
+        const T lowVal = std::numeric_limits<T>::lowest();
+        const T fifth = maxVal / 5;
+
+        struct InputCase
+        {
+            const char* name;
+            T start;
+            T amount;
+        };
+
+        for (const step_count_t steps : step_counts)
+        {
+            if (std::is_same<Backend, stepwise_reference>::value && steps > stepwise_step_limit)
+            {
+                continue;
+            }
+
+            // The largest step that still lands on (or just inside) the limit. Zero for small types
+            // with many steps, in which case that case says nothing and is left out.
+            T fill{ 0 };
+            if constexpr (std::is_integral<T>::value)
+            {
+                if (steps <= static_cast<step_count_t>(maxVal))
+                {
+                    fill = static_cast<T>(maxVal / static_cast<T>(steps));
+                }
+            }
+            else
+            {
+                fill = maxVal / static_cast<T>(steps);
+            }
+
+            for (const bool subtract : { false, true })
+            {
+                // Subtracting mirrors adding: start from the top and walk down, or start at the bottom.
+                const InputCase cases[] = {
+                    { "unit_step",           subtract ? maxVal : T{ 0 }, T{ 1 } },
+                    { "fill_to_limit",       subtract ? maxVal : T{ 0 }, fill },
+                    { "overflow_first_step", subtract ? lowVal : maxVal, fifth },
+                    { "overflow_after_five", subtract ? static_cast<T>(lowVal + fifth * 5) : T{ 0 }, fifth },
+                };
+
+                for (const InputCase& input : cases)
+                {
+                    if (input.amount == T{ 0 })
+                    {
+                        continue;
+                    }
+
+                    BenchmarkRow row = measure<T, Backend>(subtract, input.start, input.amount, steps, options.min_ms);
+                    row.type = type_name;
+                    row.backend = backend_name;
+                    row.input_case = input.name;
+                    rows.push_back(row);
+                }
+            }
+        }
+    }
+
+    template <typename T>
+    void bench_type(const char* type_name, const BenchmarkOptions& options, std::vector<BenchmarkRow>& rows)
+    {
+        bench_backend<T, portable_backend>(type_name, "portable", options, rows);
+        bench_backend<T, intrinsic_backend>(type_name, "intrinsic", options, rows);
+        bench_backend<T, wide_backend>(type_name, "wide", options, rows);
+        bench_backend<T, stepwise_reference>(type_name, "stepwise", options, rows);
+        bench_format<T>(type_name, options, rows);
+    }
+
+    void write_table(std::ostream& out, const std::vector<BenchmarkRow>& rows)
+    {
+        out << std::left
+            << std::setw(20) << "type" << std::setw(11) << "backend" << std::setw(10) << "operation"
+            << std::setw(21) << "case" << std::setw(15) << "steps" << std::setw(9) << "success"
+            << std::right << std::setw(14) << "ns/op" << std::setw(16) << "ops/sec" << std::endl;
+
+        for (const BenchmarkRow& row : rows)
+        {
+            out << std::left
+                << std::setw(20) << row.type << std::setw(11) << row.backend << std::setw(10) << row.operation
+                << std::setw(21) << row.input_case << std::setw(15) << row.steps << std::setw(9) << (row.success ? "yes" : "no")
+                << std::right << std::fixed << std::setprecision(3) << std::setw(14) << row.ns_per_op
+                << std::setprecision(0) << std::setw(16) << row.ops_per_sec << std::endl;
+        }
+    }
+
+    void write_json(std::ostream& out, const std::vector<BenchmarkRow>& rows, const BenchmarkOptions& options)
+    {
+        // Every string written here is one of our own identifiers, so nothing needs escaping.
+        out << "{\n  \"benchmark\": \"NumericBenchmarks\",\n  \"min_ms\": " << options.min_ms << ",\n  \"results\": [\n";
+        for (std::size_t i = 0; i < rows.size(); ++i)
+        {
+            const BenchmarkRow& row = rows[i];
+            out << "    {\"type\": \"" << row.type << "\", \"backend\": \"" << row.backend
+                << "\", \"operation\": \"" << row.operation << "\", \"case\": \"" << row.input_case
+                << "\", \"steps\": " << row.steps << ", \"success\": " << (row.success ? "true" : "false")
+                << ", \"iterations\": " << row.iterations
+                << std::fixed << std::setprecision(3) << ", \"ns_per_op\": " << row.ns_per_op
+                << std::setprecision(0) << ", \"ops_per_sec\": " << row.ops_per_sec << "}"
+                << (i + 1 < rows.size() ? ",\n" : "\n");
+        }
+        out << "  ]\n}" << std::endl;
+    }
+
+    bool parse_options(int argc, char* argv[], BenchmarkOptions& options)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            if (std::strcmp(argv[i], "--json") == 0)
+            {
+                options.json = true;
+            }
+            else if (std::strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+            {
+                options.out_path = argv[++i];
+            }
+            else if (std::strcmp(argv[i], "--min-ms") == 0 && i + 1 < argc)
+            {
+                try
+                {
+                    options.min_ms = std::stoul(argv[++i]);
+                }
+                catch (const std::exception&)
+                {
+                    return false;
+                }
+            }
+            else
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+/// <summary>
+/// Entry point into the benchmarks
+/// </summary>
+/// <returns>0 when complete, 1 for bad arguments or an output file that cannot be written</returns>
+int main(int argc, char* argv[])
+{
+    BenchmarkOptions options{};
+    if (!parse_options(argc, argv, options))
+    {
+        std::cerr << "Usage: NumericBenchmarks [--json] [--out <file>] [--min-ms <milliseconds>]" << std::endl;
+        return 1;
+    }
+
+    // The same types, in the same order, as do_overflow_tests() / do_underflow_tests().
+    std::vector<BenchmarkRow> rows;
+    for_each_type<tested_types>([&](auto tag)
+    {
+        using T = typename decltype(tag)::type;
+        bench_type<T>(std::string(type_name<T>()).c_str(), options, rows);
+    });
+
+    std::ofstream file;
+    if (!options.out_path.empty())
+    {
+        file.open(options.out_path);
+        if (!file)
+        {
+            std::cerr << "Cannot write " << options.out_path << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& out = options.out_path.empty() ? std::cout : file;
+
+    if (options.json)
+    {
+        write_json(out, rows, options);
+    }
+    else
+    {
+        write_table(out, rows);
+    }
+
+    return 0;
+}
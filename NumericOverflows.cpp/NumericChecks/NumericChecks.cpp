@@ -0,0 +1,1606 @@
+// NumericChecks.cpp : Fixed-input checks of the code static_assert cannot reach.
+//
+// The headers check what they can at compile time. This program covers the rest: code that needs
+// SIMD instructions, threads or the C++ library's run-time parsing. Every check runs fixed inputs (the
+// expression checks draw theirs from a fixed seed) and compares them with the scalar templates. The inputs
+// are the limits and their neighbours, 0 and +/-1, and step counts on both sides of the limits where the
+// kernels hand lanes over to the scalar engine.
+//   batch - every SIMD kernel set this CPU can run, called directly with a shared and with a per-lane
+//           step count, and add_numbers_batch / subtract_numbers_batch on top of them (NumericBatch.h)
+//   saturating - add_numbers_saturating_batch / subtract_numbers_saturating_batch against the scalar templates,
+//           8- and 16-bit lanes (their own AVX2 kernels) and wider ones, batch lengths off the vector widths
+//   block - CalcResultBlock (CalcResultBlock.h) filled by the batch functions and by set(), read back through
+//           operator[] and the iterators, fresh and after shrinking and growing again
+//   bulk  - the --bulk text parser (BulkCheck.h) on lines it has to refuse, numbers out of range among them,
+//           and on lines next to them that it has to accept
+//           and, on requests of every type next to the limits, process_binary_record against the text lines
+//           and run_bulk_pipeline (BulkPipeline.h) against run_bulk through files in the temporary directory,
+//           and run_columnar (ColumnarFile.h) on column files of the same requests, which has to refuse
+//           a result file that is the request file
+//   traits - the checked_fma of the __int128, unsigned __int128 and _Float16 overflow_traits (OverflowTraits.h),
+//           where the compiler has those types, against the stepwise loops on values next to their limits
+//   scaling - multiply_numbers on every backend, divide_numbers and shift_numbers (NumericScaling.h) against a
+//           stepwise loop, for every tested type: lowest() / -1, division by 0 and shifts by the width of T or more
+//   expressions - Checked<T> expressions (CheckedExpression.h) of random terms, evaluate() against the sum in the
+//           accumulator and the chain of add_numbers calls, and expressions that fail in the first or a later term
+//   parallel - parallel_checked_accumulate with several thread counts, and checked_accumulate with each
+//           execution policy, against the serial checked_accumulate on ranges that overflow on a
+//           chunk edge, next to one or not at all (ParallelAccumulate.h). libstdc++ runs the policies
+//           on TBB when it is installed, and the program then links with -ltbb
+// Each failed check prints one line. The result is the same on every run; for random inputs on every
+// backend, see NumericFuzzer.
+//
+// Usage: NumericChecks
+
+#include <algorithm>    // std::copy, std::fill, std::find_if, std::min
+#include <climits>      // CHAR_BIT
+#include <cmath>        // std::isinf, std::isnan, std::ldexp, std::signbit
+#include <cstddef>      // std::size_t
+#include <cstdint>      // std::uint64_t
+#include <cstring>      // std::memcmp, std::memcpy
+#include <filesystem>   // std::filesystem::path, std::filesystem::temp_directory_path
+#include <fstream>      // std::ifstream, std::ofstream
+#include <iostream>     // std::cout
+#include <limits>       // std::numeric_limits
+#include <ostream>      // std::ostream
+#include <random>       // std::mt19937_64
+#include <sstream>      // std::ostringstream
+#include <string>       // std::string
+#include <type_traits>  // std::is_integral, std::is_signed
+#include <utility>      // std::move
+#include <vector>       // std::vector
+
+#include "BulkCheck.h"
+#include "BulkPipeline.h"
+#include "CalcResultBlock.h"
+#include "CheckedAccumulate.h"
+#include "CheckedExpression.h"
+#include "ColumnarFile.h"
+#include "CpuDispatch.h"
+#include "NumericBatch.h"
+#include "NumericFunctions.h"
+#include "NumericScaling.h"
+#include "NumericTypeName.h"
+#include "OverflowTraits.h"
+#include "ParallelAccumulate.h"
+
+namespace
+{
+    /// <summary>
+    /// Counts checks and prints the ones that fail.
+    /// </summary>
+    class CheckLog
+    {
+    public:
+        explicit CheckLog(std::ostream& out) : out_(out) {}
+
+        /// <summary>
+        /// Records one check. what is only worked out (and printed) when the check fails.
+        /// </summary>
+        template <typename Describe>
+        void expect(bool ok, Describe const& what)
+        {
+            ++checks_;
+            if (!ok)
+            {
+                ++failures_;
+                out_ << "FAILED: " << what() << std::endl;
+            }
+        }
+
+        std::uint64_t checks() const { return checks_; }
+        std::uint64_t failures() const { return failures_; }
+
+    private:
+        std::ostream& out_;
+        std::uint64_t checks_{ 0 };
+        std::uint64_t failures_{ 0 };
+    };
+
+    /// <summary>
+    /// Whether a batch lane gave what the scalar template gave: the same value (bit for bit, with every
+    /// NaN as good as any other) and the same success.
+    /// </summary>
+    template <typename T>
+    bool same_lane(const CalcResult<T>& expected, T value, bool success)
+    {
+        if constexpr (std::is_integral<T>::value)
+        {
+            return expected.value == value && expected.success == success;
+        }
+        else
+        {
+            const bool same_value = std::isnan(expected.value) ? std::isnan(value) : std::memcmp(&expected.value, &value, sizeof(T)) == 0;
+            return same_value && expected.success == success;
+        }
+    }
+
+    /// <summary>
+    /// The values every start and increment is drawn from.
+    /// </summary>
+    template <typename T>
+    std::vector<T> edge_values()
+    {
+        using limits = std::numeric_limits<T>;
+        if constexpr (std::is_integral<T>::value)
+        {
+            std::vector<T> values = { limits::max(), static_cast<T>(limits::max() - 1), static_cast<T>(limits::max() / 2),
+                limits::lowest(), static_cast<T>(limits::lowest() + 1), T{ 0 }, T{ 1 }, T{ 2 } };
+            if constexpr (std::is_signed<T>::value)
+            {
+                values.insert(values.end(), { T{ -1 }, T{ -2 }, static_cast<T>(limits::lowest() / 2) });
+            }
+            return values;
+        }
+        else
+        {
+            return { limits::max(), limits::lowest(), T{ 1 }, T{ -1 }, T{ 0.5 }, T{ 0 }, -T{ 0 }, limits::min(), limits::denorm_min(),
+                T{ 1e30f }, T{ -1e30f }, limits::infinity(), -limits::infinity(), limits::quiet_NaN() };
+        }
+    }
+
+    /// <summary>
+    /// The step counts used. Integers: on both sides of 2^31 and 2^32, which the kernels cannot multiply by.
+    /// Floating point: on both sides of simd_float_step_limit.
+    /// </summary>
+    template <typename T>
+    std::vector<step_count_t> edge_steps()
+    {
+        if constexpr (std::is_integral<T>::value)
+        {
+            return { 0, 1, 2, 3, 1000, 0x7FFFFFFF, 0xFFFFFFFF, step_count_t{ 0x100000000 }, std::numeric_limits<step_count_t>::max() };
+        }
+        else
+        {
+            const step_count_t limit = numeric_batch_detail::simd_float_step_limit;
+            return { 0, 1, 2, 3, 100, limit, limit + 1, 100000 };
+        }
+    }
+
+    /// <summary>
+    /// Every start paired with every increment, and a per-lane step count for each pair. Neighbouring
+    /// lanes get different counts, so every SIMD group mixes lanes that fit, overflow and go to the scalar engine.
+    /// </summary>
+    template <typename T>
+    struct BatchInput
+    {
+        std::vector<T> starts;
+        std::vector<T> increments;
+        std::vector<step_count_t> lane_steps;
+
+        BatchInput()
+        {
+            const std::vector<T> values = edge_values<T>();
+            const std::vector<step_count_t> steps = edge_steps<T>();
+            for (const T& start : values)
+            {
+                for (const T& increment : values)
+                {
+                    starts.push_back(start);
+                    increments.push_back(increment);
+                    lane_steps.push_back(steps[(lane_steps.size() * 7) % steps.size()]);
+                }
+            }
+        }
+
+        std::size_t count() const { return starts.size(); }
+    };
+
+    template <typename T, bool Subtract>
+    CalcResult<T> scalar_result(T const& start, T const& amount, step_count_t steps)
+    {
+        return Subtract ? subtract_numbers<T>(start, amount, steps) : add_numbers<T>(start, amount, steps);
+    }
+
+    /// <summary>
+    /// Compares lanes [0, lanes) of a batch result with the scalar templates.
+    /// </summary>
+    template <typename T, bool Subtract, typename StepOf>
+    void compare_lanes(CheckLog& log, std::string const& what, const BatchInput<T>& input, std::size_t lanes,
+        StepOf const& step_of, const std::vector<T>& values, const std::vector<std::uint64_t>& mask)
+    {
+        for (std::size_t i = 0; i < lanes; ++i)
+        {
+            const step_count_t steps = step_of(i);
+            const CalcResult<T> expected = scalar_result<T, Subtract>(input.starts[i], input.increments[i], steps);
+            const bool success = batch_mask_test(mask.data(), i);
+            log.expect(same_lane(expected, values[i], success), [&]()
+            {
+                std::ostringstream text;
+                text.precision(std::numeric_limits<T>::max_digits10);
+                text << what << ", lane " << i << ": " << +input.starts[i] << (Subtract ? " - " : " + ") << +input.increments[i]
+                    << " * " << steps << " should give " << +expected.value << " " << expected.success
+                    << ", got " << +values[i] << " " << success;
+                return text.str();
+            });
+        }
+    }
+
+    /// <summary>
+    /// The batch checks for T and one operation.
+    /// </summary>
+    template <typename T, bool Subtract>
+    void check_batch(CheckLog& log, batch_isa detected)
+    {
+        const BatchInput<T> input;
+        const std::size_t count = input.count();
+        std::vector<T> values(count);
+        std::vector<std::uint64_t> mask(batch_mask_words(count));
+        const std::string name = std::string(type_name<T>()) + (Subtract ? " subtract" : " add");
+
+        // Every kernel set this CPU runs, called directly. A kernel leaves the lanes after its last whole group to the caller.
+        for (const batch_isa isa : { batch_isa::avx512, batch_isa::avx2, batch_isa::neon })
+        {
+            if (cpu_dispatch_detail::cap(detected, isa) != isa)
+            {
+                continue;
+            }
+            const std::string kernel = name + " on " + batch_isa_name(isa);
+
+            if (const auto walk = numeric_batch_detail::select_simd_walk<T, Subtract>(isa))
+            {
+                for (const step_count_t steps : edge_steps<T>())
+                {
+                    std::fill(mask.begin(), mask.end(), 0);
+                    const std::size_t lanes = walk(input.starts.data(), input.increments.data(), count, steps, values.data(), mask.data());
+                    compare_lanes<T, Subtract>(log, kernel + ", " + std::to_string(steps) + " steps", input, lanes,
+                        [&](std::size_t) { return steps; }, values, mask);
+                }
+            }
+            if (const auto walk = numeric_batch_detail::select_simd_walk_lanes<T, Subtract>(isa))
+            {
+                std::fill(mask.begin(), mask.end(), 0);
+                const std::size_t lanes = walk(input.starts.data(), input.increments.data(), input.lane_steps.data(), count, values.data(), mask.data());
+                compare_lanes<T, Subtract>(log, kernel + ", per-lane steps", input, lanes,
+                    [&](std::size_t i) { return input.lane_steps[i]; }, values, mask);
+            }
+        }
+
+        // The public forms, on whatever this run dispatches to, tail lanes included.
+        for (const step_count_t steps : edge_steps<T>())
+        {
+            if (Subtract)
+            {
+                subtract_numbers_batch<T>(input.starts.data(), input.increments.data(), count, steps, values.data(), mask.data());
+            }
+            else
+            {
+                add_numbers_batch<T>(input.starts.data(), input.increments.data(), count, steps, values.data(), mask.data());
+            }
+            compare_lanes<T, Subtract>(log, name + "_batch, " + std::to_string(steps) + " steps", input, count,
+                [&](std::size_t) { return steps; }, values, mask);
+        }
+        if (Subtract)
+        {
+            subtract_numbers_batch<T>(input.starts.data(), input.increments.data(), input.lane_steps.data(), count, values.data(), mask.data());
+        }
+        else
+        {
+            add_numbers_batch<T>(input.starts.data(), input.increments.data(), input.lane_steps.data(), count, values.data(), mask.data());
+        }
+        compare_lanes<T, Subtract>(log, name + "_batch, per-lane steps", input, count,
+            [&](std::size_t i) { return input.lane_steps[i]; }, values, mask);
+    }
+
+    /// <summary>
+    /// The batch checks for every type with a SIMD kernel.
+    /// </summary>
+    void check_batch_kernels(CheckLog& log)
+    {
+        const batch_isa detected = cpu_dispatch_detail::detect();
+        check_batch<int, false>(log, detected);
+        check_batch<int, true>(log, detected);
+        check_batch<unsigned int, false>(log, detected);
+        check_batch<unsigned int, true>(log, detected);
+        check_batch<long long, false>(log, detected);
+        check_batch<long long, true>(log, detected);
+        check_batch<unsigned long long, false>(log, detected);
+        check_batch<unsigned long long, true>(log, detected);
+        check_batch<float, false>(log, detected);
+        check_batch<float, true>(log, detected);
+        check_batch<double, false>(log, detected);
+        check_batch<double, true>(log, detected);
+    }
+
+    template <typename T, bool Subtract>
+    CalcResult<T> scalar_saturating(T const& start, T const& amount, step_count_t steps)
+    {
+        return Subtract ? subtract_numbers_saturating<T>(start, amount, steps) : add_numbers_saturating<T>(start, amount, steps);
+    }
+
+    /// <summary>
+    /// The saturating batch checks for T and one operation: add_numbers_saturating_batch /
+    /// subtract_numbers_saturating_batch against the scalar templates, on batches whose length is and is not
+    /// a multiple of every vector width. The inputs start on both limits and step towards them, so lanes clamp
+    /// at max() and lowest(); one step is the count the AVX2 kernels for 8- and 16-bit lanes take.
+    /// </summary>
+    template <typename T, bool Subtract>
+    void check_saturating(CheckLog& log)
+    {
+        const BatchInput<T> input;
+        const std::string name = std::string(type_name<T>()) + (Subtract ? " subtract" : " add") + "_saturating_batch";
+        std::vector<T> values(input.count());
+        std::vector<std::uint64_t> mask(batch_mask_words(input.count()));
+
+        auto compare = [&](std::string const& what, std::size_t count, auto const& step_of)
+        {
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                const step_count_t steps = step_of(i);
+                const CalcResult<T> expected = scalar_saturating<T, Subtract>(input.starts[i], input.increments[i], steps);
+                const bool success = batch_mask_test(mask.data(), i);
+                log.expect(same_lane(expected, values[i], success), [&]()
+                {
+                    std::ostringstream text;
+                    text.precision(std::numeric_limits<T>::max_digits10);
+                    text << what << ", lane " << i << " of " << count << ": " << +input.starts[i] << (Subtract ? " - " : " + ")
+                        << +input.increments[i] << " * " << steps << " should give " << +expected.value << " " << expected.success
+                        << ", got " << +values[i] << " " << success;
+                    return text.str();
+                });
+            }
+        };
+
+        for (const std::size_t count : { input.count(), input.count() - 1, input.count() / 2 + 3, std::size_t{ 33 }, std::size_t{ 17 }, std::size_t{ 1 } })
+        {
+            for (const step_count_t steps : edge_steps<T>())
+            {
+                if (Subtract)
+                {
+                    subtract_numbers_saturating_batch<T>(input.starts.data(), input.increments.data(), count, steps, values.data(), mask.data());
+                }
+                else
+                {
+                    add_numbers_saturating_batch<T>(input.starts.data(), input.increments.data(), count, steps, values.data(), mask.data());
+                }
+                compare(name + ", " + std::to_string(steps) + " steps", count, [&](std::size_t) { return steps; });
+            }
+
+            if (Subtract)
+            {
+                subtract_numbers_saturating_batch<T>(input.starts.data(), input.increments.data(), input.lane_steps.data(), count, values.data(), mask.data());
+            }
+            else
+            {
+                add_numbers_saturating_batch<T>(input.starts.data(), input.increments.data(), input.lane_steps.data(), count, values.data(), mask.data());
+            }
+            compare(name + ", per-lane steps", count, [&](std::size_t i) { return input.lane_steps[i]; });
+        }
+    }
+
+    /// <summary>
+    /// The saturating batch checks: the 8- and 16-bit lanes with their own AVX2 kernels, and wider types
+    /// that clamp the results of the ordinary kernels.
+    /// </summary>
+    void check_saturating_batch(CheckLog& log)
+    {
+        check_saturating<signed char, false>(log);
+        check_saturating<signed char, true>(log);
+        check_saturating<unsigned char, false>(log);
+        check_saturating<unsigned char, true>(log);
+        check_saturating<short, false>(log);
+        check_saturating<short, true>(log);
+        check_saturating<unsigned short, false>(log);
+        check_saturating<unsigned short, true>(log);
+        check_saturating<int, false>(log);
+        check_saturating<int, true>(log);
+        check_saturating<unsigned long long, false>(log);
+        check_saturating<unsigned long long, true>(log);
+        check_saturating<long long, false>(log);
+        check_saturating<long long, true>(log);
+        check_saturating<float, false>(log);
+        check_saturating<float, true>(log);
+    }
+
+    /// <summary>
+    /// Whether every lane of block holds the value and success expected(i) gives, read through operator[] and
+    /// through the iterators.
+    /// </summary>
+    template <typename T, typename Expected>
+    void compare_block(CheckLog& log, std::string const& what, const CalcResultBlock<T>& block, std::size_t count, Expected const& expected)
+    {
+        log.expect(block.size() == count, [&]()
+        {
+            return what + ": size should be " + std::to_string(count) + ", got " + std::to_string(block.size());
+        });
+        bool all = true;
+        std::size_t i = 0;
+        for (auto it = block.begin(); it != block.end() && i < count; ++it, ++i)
+        {
+            const BlockResult<T> want = expected(i);
+            const BlockResult<T> indexed = block[i];
+            const BlockResult<T> iterated = *it;
+            all = all && want.success;
+            CalcResult<T> expected_result{};
+            expected_result.value = want.value;
+            expected_result.success = want.success;
+            log.expect(same_lane(expected_result, indexed.value, indexed.success) && same_lane(expected_result, iterated.value, iterated.success)
+                && block.success(i) == want.success, [&]()
+            {
+                std::ostringstream text;
+                text << what << ", lane " << i << ": should give " << +want.value << " " << want.success
+                    << ", got " << +indexed.value << " " << indexed.success << " (iterator " << +iterated.value << " " << iterated.success << ")";
+                return text.str();
+            });
+        }
+        log.expect(block.all_succeeded() == all, [&]()
+        {
+            return what + ": all_succeeded() should be " + (all ? "true" : "false");
+        });
+    }
+
+    /// <summary>
+    /// The CalcResultBlock checks for T: the default state, filling it from the batch functions and from set(),
+    /// and shrinking then growing it again over lanes that had failed.
+    /// </summary>
+    template <typename T>
+    void check_block(CheckLog& log)
+    {
+        const std::string name = std::string(type_name<T>()) + " block";
+        const CalcResult<T> fresh{};
+
+        // New lanes read back like CalcResult<T>{}.
+        for (const std::size_t count : { std::size_t{ 0 }, std::size_t{ 3 }, std::size_t{ 64 }, std::size_t{ 130 } })
+        {
+            const CalcResultBlock<T> block(count);
+            compare_block<T>(log, name + " of " + std::to_string(count), block, count,
+                [&](std::size_t) { return BlockResult<T>{ fresh.value, fresh.success }; });
+        }
+
+        // Filled by the batch functions, the block reads back what the pointer forms write.
+        const BatchInput<T> input;
+        const std::size_t count = input.count();
+        std::vector<T> values(count);
+        std::vector<std::uint64_t> mask(batch_mask_words(count));
+        CalcResultBlock<T> block;
+        for (const step_count_t steps : { step_count_t{ 1 }, step_count_t{ 3 } })
+        {
+            add_numbers_batch<T>(input.starts.data(), input.increments.data(), count, steps, values.data(), mask.data());
+            add_numbers_batch<T>(input.starts.data(), input.increments.data(), count, steps, block);
+            compare_block<T>(log, name + ", add_numbers_batch " + std::to_string(steps) + " steps", block, count,
+                [&](std::size_t i) { return BlockResult<T>{ values[i], batch_mask_test(mask.data(), i) }; });
+        }
+
+        // Filled lane by lane with set(), with failures on both sides of a mask word edge.
+        const std::size_t lanes = 130;
+        const auto lane_result = [](std::size_t i)
+        {
+            return BlockResult<T>{ static_cast<T>(i % 100), i % 3 != 0 };
+        };
+        block.resize(lanes);
+        for (std::size_t i = 0; i < lanes; ++i)
+        {
+            CalcResult<T> result{};
+            result.value = lane_result(i).value;
+            result.success = lane_result(i).success;
+            block.set(i, result);
+        }
+        compare_block<T>(log, name + ", set", block, lanes, lane_result);
+
+        // Shrunk, then grown again: the lanes that come back start out fresh, the ones that stayed keep their results.
+        for (const std::size_t kept : { std::size_t{ 0 }, std::size_t{ 1 }, std::size_t{ 63 }, std::size_t{ 64 }, std::size_t{ 65 } })
+        {
+            block.resize(lanes);
+            for (std::size_t i = 0; i < lanes; ++i)
+            {
+                CalcResult<T> result{};
+                result.value = lane_result(i).value;
+                result.success = lane_result(i).success;
+                block.set(i, result);
+            }
+            block.resize(kept);
+            block.resize(lanes);
+            compare_block<T>(log, name + ", shrunk to " + std::to_string(kept) + " and grown", block, lanes, [&](std::size_t i)
+            {
+                return i < kept ? lane_result(i) : BlockResult<T>{ fresh.value, fresh.success };
+            });
+        }
+    }
+
+    /// <summary>
+    /// The CalcResultBlock checks for an integer and a floating-point type.
+    /// </summary>
+    void check_result_block(CheckLog& log)
+    {
+        check_block<int>(log);
+        check_block<double>(log);
+    }
+
+    /// <summary>
+    /// One --bulk text line and what process_text_line should make of it.
+    /// </summary>
+    struct BulkLineCase
+    {
+        const char* line;
+        const char* output;  // what is written for the line: a result line, "error\n", or nothing
+        bool valid;
+    };
+
+    const BulkLineCase bulk_line_cases[] = {
+        { "add int 0 1 5", "5 1 0 0\n", true },
+        { "add int 0 1 18446744073709551615", "2147483647 0 2147483647 0\n", true },
+        { "add int 0 1 18446744073709551616", "error\n", false },
+        { "add int 0 1 99999999999999999999999", "error\n", false },
+        { "sub double 0 1 99999999999999999999999", "error\n", false },
+        { "add int 0 1 -1", "error\n", false },
+        { "add int 0 1 5x", "error\n", false },
+        { "add int 0 1", "error\n", false },
+        { "add int 0 1 5 6", "error\n", false },
+        { "add int 2147483648 1 1", "error\n", false },
+        { "add uchar 0 256 1", "error\n", false },
+        { "add int +5 -1 +3", "2 1 0 0\n", true },
+        { "add double +2.5 1 1", "3.5 1 0 0\n", true },
+        { "add int +-5 1 1", "error\n", false },
+        { "add double +-2.5 1 1", "error\n", false },
+        { "add int ++5 1 1", "error\n", false },
+        { "add int + 1 1", "error\n", false },
+        { "add int 5 +-1 1", "error\n", false },
+        { "add int 0 1 +-3", "error\n", false },
+        { "add int 0 1 ++3", "error\n", false },
+        { "add int 0 1 +", "error\n", false },
+        { "# add int 0 1 99999999999999999999999", "", true },
+        { "", "", true },
+    };
+
+    /// <summary>
+    /// text with its line breaks spelled out, for a one-line report.
+    /// </summary>
+    std::string shown(std::string const& text)
+    {
+        std::string out;
+        for (const char c : text)
+        {
+            out += c == '\n' ? std::string("\\n") : std::string(1, c);
+        }
+        return out;
+    }
+
+    /// <summary>
+    /// The --bulk text checks. --bulk and --bulk --pipeline both write every line through process_text_line.
+    /// </summary>
+    void check_bulk_parser(CheckLog& log)
+    {
+        for (const BulkLineCase& c : bulk_line_cases)
+        {
+            char out[bulk_detail::text_line_capacity];
+            bool valid = true;
+            const std::string line = c.line;
+            const char* const end = bulk_detail::process_text_line(line.data(), line.data() + line.size(), out, valid);
+            const std::string written(static_cast<const char*>(out), end);
+            log.expect(written == c.output && valid == c.valid, [&]()
+            {
+                return "bulk line \"" + line + "\" should give \"" + shown(c.output) + "\" (" + (c.valid ? "valid" : "invalid")
+                    + "), got \"" + shown(written) + "\" (" + (valid ? "valid" : "invalid") + ")";
+            });
+        }
+    }
+
+    /// <summary>
+    /// The same fixed requests as text lines and as binary records, record i being line i.
+    /// </summary>
+    struct BulkInput
+    {
+        std::string text;
+        std::vector<unsigned char> binary;
+        std::vector<std::string> lines;  // without their line breaks
+    };
+
+    /// <summary>
+    /// Adds the requests for T: every pair of a few values next to T's limits and 0, with a few step counts,
+    /// each as an add and a subtract. The values are written the way results are, so they read back exactly.
+    /// </summary>
+    template <typename T>
+    void add_bulk_requests(BulkInput& input, bulk_type type)
+    {
+        using limits = std::numeric_limits<T>;
+        std::vector<T> values = { limits::max(), limits::lowest(), T{ 0 }, T{ 1 } };
+        if constexpr (std::is_signed<T>::value)
+        {
+            values.push_back(static_cast<T>(-1));
+        }
+        if constexpr (!std::is_integral<T>::value)
+        {
+            values.push_back(static_cast<T>(0.1));
+        }
+        const step_count_t step_counts[] = { 0, 1, 3, 1000, std::numeric_limits<step_count_t>::max() };
+
+        for (const T& start : values)
+        {
+            for (const T& amount : values)
+            {
+                for (const step_count_t steps : step_counts)
+                {
+                    for (const bulk_op op : { bulk_op::add, bulk_op::subtract })
+                    {
+                        char text[3 * number_text_capacity + 64];
+                        char* out = text;
+                        const char* const name = op == bulk_op::add ? "add " : "sub ";
+                        out = std::copy(name, name + 4, out);
+                        const char* const type_text = bulk_type_names[static_cast<std::size_t>(type)];
+                        out = std::copy(type_text, type_text + std::char_traits<char>::length(type_text), out);
+                        *out++ = ' ';
+                        out = write_number(out, text + sizeof(text), +start, true);
+                        *out++ = ' ';
+                        out = write_number(out, text + sizeof(text), +amount, true);
+                        *out++ = ' ';
+                        out = write_number(out, text + sizeof(text), steps);
+                        input.lines.emplace_back(text, out);
+                        input.text += input.lines.back() + "\n";
+
+                        unsigned char record[bulk_input_record_size] = {};
+                        record[0] = static_cast<unsigned char>(op);
+                        record[1] = static_cast<unsigned char>(type);
+                        std::memcpy(record + 8, &steps, sizeof(steps));
+                        std::memcpy(record + 16, &start, bulk_detail::value_bytes<T>());
+                        std::memcpy(record + 32, &amount, bulk_detail::value_bytes<T>());
+                        input.binary.insert(input.binary.end(), record, record + sizeof(record));
+                    }
+                }
+            }
+        }
+    }
+
+    /// <summary>
+    /// The requests for every bulk type, plus a line and a record that have to be refused.
+    /// </summary>
+    BulkInput bulk_input()
+    {
+        BulkInput input;
+        for (std::size_t type = 0; type < static_cast<std::size_t>(bulk_type::count); ++type)
+        {
+            dispatch_bulk_type(static_cast<bulk_type>(type), [&](auto tag)
+            {
+                add_bulk_requests<typename decltype(tag)::type>(input, static_cast<bulk_type>(type));
+            });
+        }
+        input.lines.push_back("add int +-5 1 1");
+        input.text += input.lines.back() + "\n";
+        unsigned char record[bulk_input_record_size] = {};
+        record[1] = static_cast<unsigned char>(bulk_type::count);
+        input.binary.insert(input.binary.end(), record, record + sizeof(record));
+        return input;
+    }
+
+    /// <summary>
+    /// The text line --bulk --binary wrote as the result record result: what text mode writes for the same request.
+    /// </summary>
+    std::string binary_result_text(const unsigned char* record, const unsigned char* result)
+    {
+        if (result[26] != 0)
+        {
+            return "error\n";
+        }
+        std::string text;
+        dispatch_bulk_type(static_cast<bulk_type>(record[1]), [&](auto tag)
+        {
+            using T = typename decltype(tag)::type;
+            CalcResult<T> r{};
+            std::memcpy(&r.value, result, bulk_detail::value_bytes<T>());
+            std::memcpy(&r.failed_at_step, result + 16, sizeof(r.failed_at_step));
+            r.success = result[24] != 0;
+            r.precision_lost = result[25] != 0;
+            char line[result_text_capacity];
+            text.assign(line, format_result(line, line + sizeof(line), r));
+            text += "\n";
+        });
+        return text;
+    }
+
+    /// <summary>
+    /// process_binary_record against process_text_line: every record has to give the text mode's line.
+    /// </summary>
+    void check_bulk_binary(CheckLog& log, const BulkInput& input)
+    {
+        for (std::size_t i = 0; i < input.lines.size(); ++i)
+        {
+            char out[bulk_detail::text_line_capacity];
+            bool text_valid = true;
+            const std::string& line = input.lines[i];
+            const char* const end = bulk_detail::process_text_line(line.data(), line.data() + line.size(), out, text_valid);
+            const std::string expected(static_cast<const char*>(out), end);
+
+            const unsigned char* const record = input.binary.data() + i * bulk_input_record_size;
+            unsigned char result[bulk_output_record_size];
+            const bool binary_valid = bulk_detail::process_binary_record(record, result);
+            const std::string actual = binary_result_text(record, result);
+            log.expect(actual == expected && binary_valid == text_valid, [&]()
+            {
+                return "binary record for \"" + line + "\" should give \"" + shown(expected) + "\", got \"" + shown(actual) + "\"";
+            });
+        }
+    }
+
+    std::string read_file(std::filesystem::path const& path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        std::ostringstream contents;
+        contents << in.rdbuf();
+        return contents.str();
+    }
+
+    /// <summary>
+    /// run_bulk_pipeline against run_bulk, through files in the temporary directory: the same bytes out, the same
+    /// messages and the same exit code, for text and binary input and several checker counts. The input spans
+    /// several pipeline batches.
+    /// </summary>
+    void check_bulk_pipeline(CheckLog& log, const BulkInput& input)
+    {
+        const std::filesystem::path directory = std::filesystem::temp_directory_path();
+        const std::filesystem::path in_path = directory / "NumericChecks-bulk-in";
+        const std::filesystem::path out_path = directory / "NumericChecks-bulk-out";
+
+        for (const bool binary : { false, true })
+        {
+            {
+                std::ofstream in(in_path, std::ios::binary | std::ios::trunc);
+                for (int copy = 0; copy < 3; ++copy)
+                {
+                    if (binary)
+                    {
+                        in.write(reinterpret_cast<const char*>(input.binary.data()), static_cast<std::streamsize>(input.binary.size()));
+                    }
+                    else
+                    {
+                        in.write(input.text.data(), static_cast<std::streamsize>(input.text.size()));
+                    }
+                }
+            }
+
+            BulkOptions options;
+            options.binary = binary;
+            options.in_path = in_path.string();
+            options.out_path = out_path.string();
+            std::ostringstream loop_errors;
+            const int loop_code = run_bulk(options, loop_errors);
+            const std::string loop_output = read_file(out_path);
+
+            for (const unsigned workers : { 1u, 2u, 4u })
+            {
+                options.pipeline = true;
+                options.workers = workers;
+                std::ostringstream pipeline_errors;
+                const int pipeline_code = run_bulk_pipeline(options, pipeline_errors);
+                const std::string pipeline_output = read_file(out_path);
+                log.expect(pipeline_output == loop_output && pipeline_code == loop_code && pipeline_errors.str() == loop_errors.str(), [&]()
+                {
+                    return std::string("--bulk") + (binary ? " --binary" : "") + " --pipeline " + std::to_string(workers) + ": wrote "
+                        + std::to_string(pipeline_output.size()) + " bytes, exit code " + std::to_string(pipeline_code) + ", messages \""
+                        + shown(pipeline_errors.str()) + "\"; the single loop wrote " + std::to_string(loop_output.size()) + " bytes, exit code "
+                        + std::to_string(loop_code) + ", messages \"" + shown(loop_errors.str()) + "\""
+                        + (pipeline_output.size() == loop_output.size() ? " (bytes differ)" : "");
+                });
+            }
+        }
+
+        std::error_code ignored;
+        std::filesystem::remove(in_path, ignored);
+        std::filesystem::remove(out_path, ignored);
+    }
+
+    /// <summary>
+    /// run_columnar on the requests records[i] of the input, all of type T and operation op, through files in the
+    /// temporary directory: each result's value and success bit against the first two fields of the text mode's line.
+    /// </summary>
+    template <typename T>
+    void check_columnar_file(CheckLog& log, const BulkInput& input, const std::vector<std::size_t>& records, bulk_op op, bulk_type type)
+    {
+        const std::filesystem::path directory = std::filesystem::temp_directory_path();
+        const std::filesystem::path in_path = directory / "NumericChecks-columnar-in";
+        const std::filesystem::path out_path = directory / "NumericChecks-columnar-out";
+
+        std::uint64_t in_size = 0;
+        const ColumnarHeader header = columnar_layout<T>(columnar_kind::requests, op, type, records.size(), in_size);
+        std::vector<char> requests(static_cast<std::size_t>(in_size));
+        std::memcpy(requests.data(), &header, sizeof(header));
+        for (std::size_t lane = 0; lane < records.size(); ++lane)
+        {
+            const unsigned char* const record = input.binary.data() + records[lane] * bulk_input_record_size;
+            std::memcpy(requests.data() + header.column[0] + lane * sizeof(T), record + 16, sizeof(T));
+            std::memcpy(requests.data() + header.column[1] + lane * sizeof(T), record + 32, sizeof(T));
+            std::memcpy(requests.data() + header.column[2] + lane * sizeof(step_count_t), record + 8, sizeof(step_count_t));
+        }
+        {
+            std::ofstream in(in_path, std::ios::binary | std::ios::trunc);
+            in.write(requests.data(), static_cast<std::streamsize>(requests.size()));
+        }
+
+        BulkOptions options;
+        options.columnar = true;
+        options.in_path = in_path.string();
+        options.out_path = out_path.string();
+        std::ostringstream errors;
+        const int code = run_columnar(options, errors);
+        const std::string results = read_file(out_path);
+
+        std::uint64_t out_size = 0;
+        const ColumnarHeader expected_header = columnar_layout<T>(columnar_kind::results, op, type, records.size(), out_size);
+        const bool written = code == 0 && results.size() == out_size && std::memcmp(results.data(), &expected_header, sizeof(expected_header)) == 0;
+        log.expect(written, [&]()
+        {
+            return std::string("--columnar on ") + std::to_string(records.size()) + " " + std::string(type_name<T>()) + " lanes: exit code "
+                + std::to_string(code) + ", " + std::to_string(results.size()) + " bytes, messages \"" + shown(errors.str()) + "\"";
+        });
+
+        for (std::size_t lane = 0; written && lane < records.size(); ++lane)
+        {
+            const std::string& line = input.lines[records[lane]];
+            char out[bulk_detail::text_line_capacity];
+            bool valid = true;
+            const char* const end = bulk_detail::process_text_line(line.data(), line.data() + line.size(), out, valid);
+            std::string expected(static_cast<const char*>(out), end);
+            expected.erase(expected.find(' ', expected.find(' ') + 1));
+
+            T value{};
+            std::uint64_t success_word = 0;
+            std::memcpy(&value, results.data() + expected_header.column[0] + lane * sizeof(T), sizeof(T));
+            std::memcpy(&success_word, results.data() + expected_header.column[1] + lane / 64 * sizeof(std::uint64_t), sizeof(success_word));
+            char text[number_text_capacity + 2];
+            char* out_end = write_number(text, text + sizeof(text), +value, true);
+            *out_end++ = ' ';
+            *out_end++ = (success_word >> (lane % 64) & 1) != 0 ? '1' : '0';
+            const char* const text_end = out_end;
+            const std::string actual(static_cast<const char*>(text), text_end);
+
+            log.expect(actual == expected, [&]()
+            {
+                return "--columnar lane for \"" + line + "\" should give \"" + expected + "\", got \"" + actual + "\"";
+            });
+        }
+
+        // The result file may not replace the request file, which is still mapped while the results are written.
+        const std::string before = read_file(in_path);
+        options.out_path = options.in_path;
+        std::ostringstream same_errors;
+        const int same_code = run_columnar(options, same_errors);
+        log.expect(same_code == 1 && !same_errors.str().empty() && read_file(in_path) == before, [&]()
+        {
+            return "--columnar with --in and --out the same file should be refused, got exit code " + std::to_string(same_code)
+                + " and messages \"" + shown(same_errors.str()) + "\"";
+        });
+
+        std::error_code ignored;
+        std::filesystem::remove(in_path, ignored);
+        std::filesystem::remove(out_path, ignored);
+    }
+
+    /// <summary>
+    /// run_columnar against process_text_line: for every type and operation, a file of all its requests, so the
+    /// step counts differ from lane to lane, and a file for each step count, so they are all the same.
+    /// </summary>
+    void check_bulk_columnar(CheckLog& log, const BulkInput& input)
+    {
+        for (std::size_t type = 0; type < static_cast<std::size_t>(bulk_type::count); ++type)
+        {
+            for (const bulk_op op : { bulk_op::add, bulk_op::subtract })
+            {
+                std::vector<std::size_t> records;
+                for (std::size_t i = 0; i < input.lines.size(); ++i)
+                {
+                    const unsigned char* const record = input.binary.data() + i * bulk_input_record_size;
+                    if (record[0] == static_cast<unsigned char>(op) && record[1] == type)
+                    {
+                        records.push_back(i);
+                    }
+                }
+
+                std::vector<std::vector<std::size_t>> files = { records };
+                for (const std::size_t i : records)
+                {
+                    const auto same_steps = [&](const std::vector<std::size_t>& file)
+                    {
+                        return std::memcmp(input.binary.data() + file.front() * bulk_input_record_size + 8,
+                            input.binary.data() + i * bulk_input_record_size + 8, sizeof(step_count_t)) == 0;
+                    };
+                    const auto file = std::find_if(files.begin() + 1, files.end(), same_steps);
+                    if (file == files.end())
+                    {
+                        files.push_back({ i });
+                    }
+                    else
+                    {
+                        file->push_back(i);
+                    }
+                }
+
+                dispatch_bulk_type(static_cast<bulk_type>(type), [&](auto tag)
+                {
+                    for (const std::vector<std::size_t>& file : files)
+                    {
+                        check_columnar_file<typename decltype(tag)::type>(log, input, file, op, static_cast<bulk_type>(type));
+                    }
+                });
+            }
+        }
+    }
+
+    /// <summary>
+    /// The binary record, pipeline and columnar checks, on one fixed input.
+    /// </summary>
+    void check_bulk_modes(CheckLog& log)
+    {
+        const BulkInput input = bulk_input();
+        check_bulk_binary(log, input);
+        check_bulk_pipeline(log, input);
+        check_bulk_columnar(log, input);
+    }
+
+    /// <summary>
+    /// v as text, for the types operator<< does not print.
+    /// </summary>
+    template <typename T>
+    std::string traits_value_text(T const& v)
+    {
+        std::ostringstream text;
+        if constexpr (sizeof(T) == 16)
+        {
+            const unsigned __int128 bits = static_cast<unsigned __int128>(v);
+            text << std::hex << "0x" << static_cast<std::uint64_t>(bits >> 64) << "_" << static_cast<std::uint64_t>(bits);
+        }
+        else
+        {
+            text << static_cast<float>(v);
+        }
+        return text.str();
+    }
+
+    /// <summary>
+    /// overflow_traits<T>::checked_fma against the stepwise loops on every pair of values, both ways: the same
+    /// value (any NaN as good as another), success and failed_at_step.
+    /// </summary>
+    template <typename T>
+    void check_checked_fma(CheckLog& log, const char* name, std::vector<T> const& values)
+    {
+        for (const T& start : values)
+        {
+            for (const T& amount : values)
+            {
+                for (const step_count_t steps : { 0, 1, 2, 3, 7, 100 })
+                {
+                    for (const bool subtract : { false, true })
+                    {
+                        const CalcResult<T> expected = subtract ? subtract_numbers_stepwise<T>(start, amount, steps) : add_numbers_stepwise<T>(start, amount, steps);
+                        const CalcResult<T> actual = overflow_traits<T>::checked_fma(start, amount, steps, subtract);
+                        const bool same_value = expected.value == actual.value || (expected.value != expected.value && actual.value != actual.value);
+                        log.expect(same_value && expected.success == actual.success && expected.failed_at_step == actual.failed_at_step, [&]()
+                        {
+                            return std::string(name) + " checked_fma " + traits_value_text(start) + (subtract ? " - " : " + ") + traits_value_text(amount)
+                                + " * " + std::to_string(steps) + " should give " + traits_value_text(expected.value) + " " + std::to_string(expected.success)
+                                + " " + std::to_string(expected.failed_at_step) + ", got " + traits_value_text(actual.value) + " "
+                                + std::to_string(actual.success) + " " + std::to_string(actual.failed_at_step);
+                        });
+                    }
+                }
+            }
+        }
+    }
+
+    /// <summary>
+    /// The checked_fma of every overflow_traits specialization OverflowTraits.h has for this compiler.
+    /// </summary>
+    void check_overflow_traits(CheckLog& log)
+    {
+#if defined(__SIZEOF_INT128__)
+        {
+            using traits = overflow_traits<__int128>;
+            check_checked_fma<__int128>(log, "__int128", { traits::max(), traits::max() - 1, traits::max() / 2, traits::lowest(),
+                traits::lowest() + 1, traits::lowest() / 2, 0, 1, 2, -1, -2, 3, -3 });
+        }
+        {
+            using traits = overflow_traits<unsigned __int128>;
+            check_checked_fma<unsigned __int128>(log, "unsigned __int128", { traits::max(), traits::max() - 1, traits::max() / 2,
+                traits::max() / 3, 0, 1, 2, 3 });
+        }
+#endif
+#if defined(__FLT16_MAX__)
+        {
+            using traits = overflow_traits<_Float16>;
+            std::vector<_Float16> values = { traits::max(), traits::lowest(), traits::zero(), -traits::zero() };
+            for (const float v : { 1.0f, -1.0f, 0.5f, -0.5f, 100.0f, -100.0f, 2048.0f, -2048.0f, 65000.0f, -65000.0f, 0.0001f })
+            {
+                values.push_back(static_cast<_Float16>(v));
+            }
+            values.push_back(static_cast<_Float16>(std::numeric_limits<float>::quiet_NaN()));
+            check_checked_fma<_Float16>(log, "_Float16", values);
+        }
+#endif
+        (void)log;
+    }
+
+    /// <summary>
+    /// The value one step of multiply_numbers takes value to, in next; false when it leaves T.
+    /// </summary>
+    template <typename T>
+    bool multiply_step(T value, T factor, T& next)
+    {
+        using limits = std::numeric_limits<T>;
+        if constexpr (std::is_integral<T>::value)
+        {
+            bool fits = true;
+            if (value != T{ 0 } && factor != T{ 0 })
+            {
+                if constexpr (std::is_signed<T>::value)
+                {
+                    if (value > T{ 0 })
+                    {
+                        fits = factor > T{ 0 } ? value <= limits::max() / factor : factor >= limits::lowest() / value;
+                    }
+                    else
+                    {
+                        fits = factor > T{ 0 } ? value >= limits::lowest() / factor : value >= limits::max() / factor;
+                    }
+                }
+                else
+                {
+                    fits = value <= limits::max() / factor;
+                }
+            }
+            if (fits)
+            {
+                next = static_cast<T>(value * factor);
+            }
+            return fits;
+        }
+        else
+        {
+            next = value * factor;
+            return !std::isinf(next);
+        }
+    }
+
+    template <typename T>
+    bool divide_step(T value, T divisor, T& next)
+    {
+        if constexpr (std::is_integral<T>::value)
+        {
+            if (divisor == T{ 0 } || (std::is_signed<T>::value && value == std::numeric_limits<T>::lowest() && divisor == static_cast<T>(-1)))
+            {
+                return false;
+            }
+            next = static_cast<T>(value / divisor);
+            return true;
+        }
+        else
+        {
+            next = value / divisor;
+            return divisor != T{ 0 } && !std::isinf(next);
+        }
+    }
+
+    template <typename T>
+    bool shift_step(T value, unsigned int shift, T& next)
+    {
+        if (shift >= sizeof(T) * CHAR_BIT)
+        {
+            return false;
+        }
+        if constexpr (std::is_integral<T>::value)
+        {
+            next = value;
+            for (unsigned int i = 0; i < shift; ++i)
+            {
+                if (!multiply_step(next, T{ 2 }, next))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+        else
+        {
+            next = std::ldexp(value, static_cast<int>(shift));
+            return !std::isinf(next);
+        }
+    }
+
+    /// <summary>
+    /// Whether a and b are the same value: NaN as good as any other NaN, and 0 and -0 told apart.
+    /// </summary>
+    template <typename T>
+    bool same_value(T a, T b)
+    {
+        if constexpr (std::is_integral<T>::value)
+        {
+            return a == b;
+        }
+        else
+        {
+            return std::isnan(a) ? std::isnan(b) : a == b && std::signbit(a) == std::signbit(b);
+        }
+    }
+
+    /// <summary>
+    /// The stepwise loop the scaling functions are checked against: step(value, next) takes every step in turn.
+    /// Once the walk comes back to the value of two steps before, it repeats every two steps (a value that stopped
+    /// changing, a sign flipping back and forth), and the steps left pick the one it ends on. A NaN stays NaN.
+    /// </summary>
+    template <typename T, typename Step>
+    CalcResult<T> scaling_stepwise(T const& start, step_count_t steps, Step const& step)
+    {
+        CalcResult<T> out{};
+        out.value = start;
+        T before = start;
+        for (step_count_t i = 0; i < steps; ++i)
+        {
+            T next{};
+            if (!step(out.value, next))
+            {
+                out.success = false;
+                out.failed_at_step = i;
+                return out;
+            }
+            if (!same_value(next, next) || (i > 0 && same_value(next, before)))
+            {
+                out.value = !same_value(next, next) || (steps - i - 1) % 2 == 0 ? next : out.value;
+                return out;
+            }
+            before = out.value;
+            out.value = next;
+        }
+        return out;
+    }
+
+    /// <summary>
+    /// One scaling check: the same value, success and, for a failure, failed_at_step. name(), operand and steps say
+    /// which call it was when it fails.
+    /// </summary>
+    template <typename T, typename Operand, typename Name>
+    void expect_scaling(CheckLog& log, Name const& name, T const& start, Operand const& operand, step_count_t steps,
+        const CalcResult<T>& expected, const CalcResult<T>& actual)
+    {
+        log.expect(same_value(expected.value, actual.value) && expected.success == actual.success
+            && (expected.success || expected.failed_at_step == actual.failed_at_step), [&]()
+        {
+            std::ostringstream text;
+            text << name() << "<" << type_name<T>() << ">(" << +start << ", " << +operand << ", " << steps << ") should give "
+                << +expected.value << " " << expected.success << " " << expected.failed_at_step
+                << ", got " << +actual.value << " " << actual.success << " " << actual.failed_at_step;
+            return text.str();
+        });
+    }
+
+    /// <summary>
+    /// multiply_numbers on every backend, divide_numbers and shift_numbers against the stepwise loop for T: every
+    /// pair of edge values, lowest() / -1 and division by 0 among them, and shifts up to past the width of T.
+    /// </summary>
+    template <typename T>
+    void check_scaling_type(CheckLog& log)
+    {
+        std::vector<T> values = edge_values<T>();
+        values.push_back(T{ 3 });
+        values.push_back(T{ 10 });
+        const unsigned int width = sizeof(T) * CHAR_BIT;
+        const unsigned int shifts[] = { 0, 1, 2, 3, width / 2, width - 1, width, width + 1, 1000 };
+
+        for (const T& start : values)
+        {
+            for (const step_count_t steps : edge_steps<T>())
+            {
+                for (const T& operand : values)
+                {
+                    const CalcResult<T> product = scaling_stepwise<T>(start, steps, [&](T v, T& next) { return multiply_step(v, operand, next); });
+                    expect_scaling(log, []() { return "multiply_numbers (portable)"; }, start, operand, steps, product,
+                        multiply_numbers<T, portable_backend>(start, operand, steps));
+                    expect_scaling(log, []() { return "multiply_numbers (intrinsic)"; }, start, operand, steps, product,
+                        multiply_numbers<T, intrinsic_backend>(start, operand, steps));
+                    expect_scaling(log, []() { return "multiply_numbers (wide)"; }, start, operand, steps, product,
+                        multiply_numbers<T, wide_backend>(start, operand, steps));
+
+                    const CalcResult<T> quotient = scaling_stepwise<T>(start, steps, [&](T v, T& next) { return divide_step(v, operand, next); });
+                    expect_scaling(log, []() { return "divide_numbers"; }, start, operand, steps, quotient, divide_numbers<T>(start, operand, steps));
+                }
+                for (const unsigned int shift : shifts)
+                {
+                    const CalcResult<T> shifted = scaling_stepwise<T>(start, steps, [&](T v, T& next) { return shift_step(v, shift, next); });
+                    expect_scaling(log, []() { return "shift_numbers"; }, start, shift, steps, shifted, shift_numbers<T>(start, shift, steps));
+                }
+            }
+        }
+    }
+
+    /// <summary>
+    /// The NumericScaling.h checks, for every tested type.
+    /// </summary>
+    void check_scaling(CheckLog& log)
+    {
+        for_each_type<tested_types>([&log](auto tag) { check_scaling_type<typename decltype(tag)::type>(log); });
+    }
+
+    /// <summary>
+    /// One term of a Checked<T> expression as the chain of add_numbers calls sees it.
+    /// </summary>
+    template <typename T>
+    struct ExpressionTerm
+    {
+        T amount;
+        step_count_t steps;
+        bool subtract;
+    };
+
+    /// <summary>
+    /// The terms run through add_numbers / subtract_numbers one after the other from 0, as an expression of them
+    /// has to report when its value does not fit: the last safe value and the failing term and step.
+    /// </summary>
+    template <typename T>
+    CheckedResult<T> expression_chain(std::vector<ExpressionTerm<T>> const& terms)
+    {
+        CheckedResult<T> result{};
+        result.value = T{ 0 };
+        for (std::size_t i = 0; i < terms.size(); ++i)
+        {
+            const ExpressionTerm<T>& term = terms[i];
+            const CalcResult<T> step = term.subtract ? subtract_numbers<T>(result.value, term.amount, term.steps)
+                : add_numbers<T>(result.value, term.amount, term.steps);
+            result.value = step.value;
+            result.precision_lost = result.precision_lost || step.precision_lost;
+            if (!step.success)
+            {
+                result.success = false;
+                result.failed_at_step = step.failed_at_step;
+                result.failed_term = i;
+                break;
+            }
+        }
+        return result;
+    }
+
+    template <typename T>
+    void expect_expression(CheckLog& log, const char* what, std::vector<ExpressionTerm<T>> const& terms,
+        const CheckedResult<T>& expected, const CheckedResult<T>& actual)
+    {
+        log.expect(same_value(expected.value, actual.value) && expected.success == actual.success && expected.failed_at_step == actual.failed_at_step
+            && expected.failed_term == actual.failed_term && expected.precision_lost == actual.precision_lost, [&]()
+        {
+            std::ostringstream text;
+            text << what << "<" << type_name<T>() << "> of 0";
+            for (const ExpressionTerm<T>& term : terms)
+            {
+                text << (term.subtract ? " - " : " + ") << +term.amount << " * " << term.steps;
+            }
+            text << " should give " << +expected.value << " " << expected.success << " " << expected.failed_at_step << " " << expected.precision_lost
+                << " term " << expected.failed_term << ", got " << +actual.value << " " << actual.success << " " << actual.failed_at_step << " "
+                << actual.precision_lost << " term " << actual.failed_term;
+            return text.str();
+        });
+    }
+
+    /// <summary>
+    /// evaluate() and the chain path of expression, whose terms are terms. Where T has an exact accumulator, the
+    /// fused check has to give the sum worked out in it whenever that fits in T, and the chain's report when it
+    /// does not; elsewhere (floating point, and 64-bit integers without __int128) evaluate() is the chain.
+    /// checked_detail::chain, the path every type falls back on, has to match the chain of add_numbers calls.
+    /// </summary>
+    template <typename T, typename Expression>
+    void check_expression(CheckLog& log, Expression const& expression, std::vector<ExpressionTerm<T>> const& terms)
+    {
+        const CheckedResult<T> chained = expression_chain(terms);
+        expect_expression(log, "checked_detail::chain", terms, chained, checked_detail::chain<T>(expression));
+
+        CheckedResult<T> expected = chained;
+        if constexpr (overflow_traits<T>::accumulator::exact)
+        {
+            // The step counts stay below 2^21, so the accumulator cannot overflow here.
+            using W = typename overflow_traits<T>::accumulator::type;
+            W total{ 0 };
+            for (const ExpressionTerm<T>& term : terms)
+            {
+                const W product = static_cast<W>(term.amount) * static_cast<W>(term.steps);
+                total = term.subtract ? total - product : total + product;
+            }
+            if (total <= static_cast<W>(std::numeric_limits<T>::max()) && total >= static_cast<W>(std::numeric_limits<T>::lowest()))
+            {
+                expected = CheckedResult<T>{};
+                expected.value = static_cast<T>(total);
+            }
+        }
+        expect_expression(log, "evaluate", terms, expected, expression.evaluate());
+    }
+
+    /// <summary>
+    /// A random amount of T: an edge value, a small value or (integers) random bits / (floating point) a value a few
+    /// doublings below max(), either sign.
+    /// </summary>
+    template <typename T>
+    T random_amount(std::mt19937_64& random, std::vector<T> const& edges)
+    {
+        const std::uint64_t bits = random();
+        switch (bits % 4)
+        {
+        case 0:
+            return edges[(bits >> 8) % edges.size()];
+        case 1:
+            return static_cast<T>((bits >> 8) % 7);
+        default:
+            if constexpr (std::is_integral<T>::value)
+            {
+                T value{};
+                const std::uint64_t raw = random();
+                std::memcpy(&value, &raw, std::min(sizeof(T), sizeof(raw)));
+                return value;
+            }
+            else
+            {
+                const T fraction = static_cast<T>(random() >> 11) / static_cast<T>(std::uint64_t{ 1 } << 53);
+                const T value = std::ldexp(fraction, std::numeric_limits<T>::max_exponent - static_cast<int>((bits >> 8) % 8));
+                return (bits >> 16) % 2 == 0 ? value : -value;
+            }
+        }
+    }
+
+    step_count_t random_steps(std::mt19937_64& random)
+    {
+        const std::uint64_t bits = random();
+        const step_count_t small[] = { 0, 1, 2, 3 };
+        return bits % 2 == 0 ? small[(bits >> 8) % 4] : (bits >> 8) % (step_count_t{ 1 } << ((bits >> 40) % 21));
+    }
+
+    /// <summary>
+    /// Random expressions of T in three shapes: a + b * k - c * l + d * m; a - (b * k - c * l) + d, whose inner
+    /// subtraction flips the signs of its terms; and a + b * k - b * k + d * m, which often leaves the range on
+    /// the way and comes back, where only the fused check succeeds.
+    /// </summary>
+    template <typename T>
+    void check_random_expressions(CheckLog& log, std::mt19937_64& random)
+    {
+        const std::vector<T> edges = edge_values<T>();
+        for (int i = 0; i < 2000; ++i)
+        {
+            const T a = random_amount(random, edges);
+            const T b = random_amount(random, edges);
+            const T c = random_amount(random, edges);
+            const T d = random_amount(random, edges);
+            const step_count_t k = random_steps(random);
+            const step_count_t l = random_steps(random);
+            const step_count_t m = random_steps(random);
+
+            check_expression<T>(log, Checked<T>(a) + Checked<T>(b) * k - Checked<T>(c) * l + Checked<T>(d) * m,
+                { { a, 1, false }, { b, k, false }, { c, l, true }, { d, m, false } });
+            check_expression<T>(log, Checked<T>(a) - (Checked<T>(b) * k - Checked<T>(c) * l) + Checked<T>(d),
+                { { a, 1, false }, { b, k, true }, { c, l, false }, { d, 1, false } });
+            check_expression<T>(log, Checked<T>(a) + Checked<T>(b) * k - Checked<T>(b) * k + Checked<T>(d) * m,
+                { { a, 1, false }, { b, k, false }, { b, k, true }, { d, m, false } });
+        }
+    }
+
+    /// <summary>
+    /// Fixed expressions that fail in the first term and in a later one, with the failing term, step and value
+    /// written out.
+    /// </summary>
+    template <typename T>
+    void check_expression_failures(CheckLog& log)
+    {
+        using limits = std::numeric_limits<T>;
+        const auto expect_failure = [&](std::vector<ExpressionTerm<T>> const& terms, const CheckedResult<T>& actual,
+            T value, step_count_t step, std::size_t term)
+        {
+            CheckedResult<T> expected{};
+            expected.value = value;
+            expected.success = false;
+            expected.failed_at_step = step;
+            expected.failed_term = term;
+            expected.precision_lost = actual.precision_lost;
+            expect_expression(log, "evaluate", terms, expected, actual);
+        };
+
+        if constexpr (std::is_integral<T>::value)
+        {
+            // (max / 2 + 1) * 3 leaves the range on its second step; so does the 2 + max / 2 * 3 after a first term.
+            const T half = static_cast<T>(limits::max() / 2 + 1);
+            expect_failure({ { half, 3, false }, { T{ 1 }, 1, false } },
+                (Checked<T>(half) * 3u + Checked<T>(T{ 1 })).evaluate(), half, 1, 0);
+            expect_failure({ { T{ 2 }, 1, false }, { static_cast<T>(limits::max() / 2), 3, false }, { T{ 1 }, 1, false } },
+                (Checked<T>(T{ 2 }) + Checked<T>(static_cast<T>(limits::max() / 2)) * 3u + Checked<T>(T{ 1 })).evaluate(),
+                static_cast<T>(2 + limits::max() / 2), 1, 1);
+            expect_failure({ { limits::lowest(), 1, false }, { T{ 5 }, 1, false }, { T{ 3 }, 4, true }, { T{ 1 }, 1, true } },
+                (Checked<T>(limits::lowest()) + Checked<T>(T{ 5 }) - Checked<T>(T{ 3 }) * 4u - Checked<T>(T{ 1 })).evaluate(),
+                static_cast<T>(limits::lowest() + 2), 1, 2);
+        }
+        else
+        {
+            expect_failure({ { limits::max(), 2, false }, { T{ 1 }, 1, false } },
+                (Checked<T>(limits::max()) * 2u + Checked<T>(T{ 1 })).evaluate(), limits::max(), 1, 0);
+            expect_failure({ { limits::lowest(), 1, false }, { limits::max(), 1, false }, { limits::max(), 3, true } },
+                (Checked<T>(limits::lowest()) + Checked<T>(limits::max()) - Checked<T>(limits::max()) * 3u).evaluate(), limits::lowest(), 1, 2);
+        }
+    }
+
+    /// <summary>
+    /// The CheckedExpression.h checks, for every tested type. The random inputs come from a fixed seed.
+    /// </summary>
+    void check_checked_expressions(CheckLog& log)
+    {
+        std::mt19937_64 random(0x436865636B6564ULL);
+        for_each_type<tested_types>([&](auto tag)
+        {
+            using T = typename decltype(tag)::type;
+            check_random_expressions<T>(log, random);
+            check_expression_failures<T>(log);
+        });
+    }
+
+    // Long enough for three parallel_min_elements, so every thread count gets several chunks.
+    constexpr std::size_t accumulate_range_elements = 3 * accumulate_detail::parallel_min_elements + 1234;
+    constexpr std::size_t never_fails = std::numeric_limits<std::size_t>::max();
+
+    /// <summary>
+    /// One range to sum, and the index of the element checked_accumulate has to refuse (never_fails for none).
+    /// </summary>
+    template <typename T>
+    struct AccumulateCase
+    {
+        std::string what;
+        T init;
+        std::vector<T> elements;
+        std::size_t fails_at;
+    };
+
+    /// <summary>
+    /// Ranges that run along one of T's limits. The elements are small, and for signed T every five of them add
+    /// up to 0, so the running total stays about 2^16 inside the limit (8 for signed char), where whole chunks
+    /// still fit, until one planted element crosses it: at the first element, on both sides of a block and a
+    /// chunk edge, or at the last element. 64-bit signed ranges also get a pair of elements too big for the
+    /// chunk bounds, which forces the walk.
+    /// </summary>
+    template <typename T>
+    std::vector<AccumulateCase<T>> accumulate_cases()
+    {
+        using limits = std::numeric_limits<T>;
+        const std::size_t n = accumulate_range_elements;
+        const std::size_t block = accumulate_detail::chunk_elements;
+        const std::size_t chunk = accumulate_detail::parallel_min_elements;
+        const std::size_t big_at = chunk + 4464;
+
+        std::vector<T> calm(n);
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            if constexpr (std::is_signed<T>::value)
+            {
+                calm[i] = static_cast<T>(static_cast<int>((i * 3) % 5) - 2);
+            }
+            else
+            {
+                calm[i] = static_cast<T>(i % 1000 == 0 ? 1 : 0);
+            }
+        }
+
+        struct Edge
+        {
+            const char* name;
+            T init;
+            T over;  // planted to cross the limit
+            T big;   // the big pair moves away from the limit by this, then back
+        };
+        const T room = static_cast<T>(sizeof(T) == 1 ? 8 : 1 << 16);
+        std::vector<Edge> edges;
+        if constexpr (std::is_signed<T>::value)
+        {
+            const T big = sizeof(T) == 8 ? static_cast<T>(limits::max() / 8) : T{ 0 };
+            edges.push_back({ "max", static_cast<T>(limits::max() - room), static_cast<T>(room + 4), static_cast<T>(-big) });
+            edges.push_back({ "lowest", static_cast<T>(limits::lowest() + room), static_cast<T>(-room - 4), big });
+        }
+        else
+        {
+            edges.push_back({ "max", static_cast<T>(limits::max() - room), static_cast<T>(room + 4), T{ 0 } });
+        }
+
+        std::vector<AccumulateCase<T>> cases;
+        for (const Edge& edge : edges)
+        {
+            std::vector<T> elements = calm;
+            if (edge.big != T{ 0 })
+            {
+                elements[big_at] = edge.big;
+                elements[big_at + 1] = static_cast<T>(-edge.big);
+            }
+            for (const std::size_t at : { never_fails, std::size_t{ 0 }, block - 1, block, chunk - 1, chunk, big_at + 2, 2 * chunk + 1, n - 1 })
+            {
+                AccumulateCase<T> c{ std::string("near ") + edge.name, edge.init, elements, at };
+                if (at != never_fails)
+                {
+                    c.elements[at] = edge.over;
+                    c.what += ", over at " + std::to_string(at);
+                }
+                cases.push_back(std::move(c));
+            }
+        }
+        if constexpr (!std::is_signed<T>::value)
+        {
+            // No planted element: the 101st 1 (at 100000) is the one past max.
+            cases.push_back({ "near max, over at 100000 unplanted", static_cast<T>(limits::max() - 100), calm, 100000 });
+        }
+        return cases;
+    }
+
+    template <typename T>
+    bool same_result(const CalcResult<T>& expected, const CalcResult<T>& actual)
+    {
+        return expected.value == actual.value && expected.success == actual.success && expected.failed_at_step == actual.failed_at_step;
+    }
+
+    template <typename T>
+    std::string result_text(const CalcResult<T>& r)
+    {
+        std::ostringstream text;
+        text << +r.value << " " << r.success << " " << r.failed_at_step;
+        return text.str();
+    }
+
+    /// <summary>
+    /// The parallel checks for T.
+    /// </summary>
+    template <typename T>
+    void check_parallel(CheckLog& log)
+    {
+        for (const AccumulateCase<T>& c : accumulate_cases<T>())
+        {
+            const std::string name = std::string(type_name<T>()) + " " + c.what;
+            const CalcResult<T> expected = checked_accumulate(c.elements.begin(), c.elements.end(), c.init);
+            log.expect(c.fails_at == never_fails ? expected.success : !expected.success && expected.failed_at_step == c.fails_at, [&]()
+            {
+                return name + ": checked_accumulate gave " + result_text(expected);
+            });
+
+            for (const unsigned threads : { 0u, 1u, 2u, 3u, 4u, 8u })
+            {
+                const CalcResult<T> actual = parallel_checked_accumulate(c.elements.begin(), c.elements.end(), c.init, threads);
+                log.expect(same_result(expected, actual), [&]()
+                {
+                    return name + ", " + std::to_string(threads) + " threads: should give " + result_text(expected) + ", got " + result_text(actual);
+                });
+            }
+#if defined(__cpp_lib_execution)
+            const auto check_policy = [&](auto&& policy, const char* policy_name)
+            {
+                const CalcResult<T> actual = checked_accumulate(policy, c.elements.begin(), c.elements.end(), c.init);
+                log.expect(same_result(expected, actual), [&]()
+                {
+                    return name + ", " + policy_name + ": should give " + result_text(expected) + ", got " + result_text(actual);
+                });
+            };
+            check_policy(std::execution::seq, "seq");
+            check_policy(std::execution::par, "par");
+            check_policy(std::execution::par_unseq, "par_unseq");
+#endif
+        }
+    }
+
+    /// <summary>
+    /// The parallel checks for every type the chunks can sum.
+    /// </summary>
+    void check_parallel_accumulate(CheckLog& log)
+    {
+        check_parallel<signed char>(log);
+        check_parallel<int>(log);
+        check_parallel<unsigned int>(log);
+        check_parallel<long long>(log);
+        check_parallel<unsigned long long>(log);
+    }
+}
+
+
+/// <summary>
+/// Entry point into the checks
+/// </summary>
+/// <returns>0 when every check passed, 1 otherwise</returns>
+int main(int argc, char* argv[])
+{
+    (void)argv;
+    if (argc > 1)
+    {
+        std::cerr << "Usage: NumericChecks" << std::endl;
+        return 1;
+    }
+
+    CheckLog log(std::cout);
+    check_batch_kernels(log);
+    check_saturating_batch(log);
+    check_result_block(log);
+    check_bulk_parser(log);
+    check_bulk_modes(log);
+    check_overflow_traits(log);
+    check_scaling(log);
+    check_checked_expressions(log);
+    check_parallel_accumulate(log);
+
+    std::cout << log.checks() << " checks, " << log.failures() << " failed" << std::endl;
+    return log.failures() == 0 ? 0 : 1;
+}
@@ -0,0 +1,762 @@
+// NumericFuzzer.cpp : Differential fuzzing of every add_numbers / subtract_numbers backend against the stepwise loop.
+//
+// Worker threads generate blocks of random requests for the 14 types used by do_overflow_tests(). The
+// values lean hard on the edges: the limits and their neighbours, 0 and +/-1, powers of two, negative
+// amounts, starts a few steps from a limit, and for floating point types -0, the smallest normal and
+// subnormal values, infinities and NaN. Each block shares one operation and one step count, so the batch
+// kernels see a full batch. Every request then goes through every backend:
+//   portable, intrinsic, wide - add_numbers / subtract_numbers on each CheckedArithmetic.h backend (floating
+//                               point types ignore the backend, so they only run as "portable")
+//   deferred                  - add_numbers_deferred / subtract_numbers_deferred (DeferredChecks.h)
+//   batch                     - add_numbers_batch / subtract_numbers_batch (NumericBatch.h)
+//   avx512, avx2, neon        - each SIMD kernel set this CPU can run, called directly
+// and is compared with add_numbers_stepwise / subtract_numbers_stepwise, the reference loop. Values must
+// match bit for bit (any two NaNs count as equal), and so must success, failed_at_step and precision_lost;
+// the batch forms only report the value and success. An integer walk the loop would take too long over (more
+// than reference_step_budget steps) is compared with the portable engine instead. Floating point walks are
+// capped at float_step_limit steps, which is within that budget: floating point types ignore the backend, so
+// the portable engine is the code under test there, and every float walk goes through the loop.
+// Each mismatch is shrunk to a simpler request that still fails (fewer steps, values closer to 0) and
+// written out as a --bulk text request, after a comment saying which backend gave what, so
+//     NumericOverflows --bulk --in <file>
+// replays it. One case is kept for each type, operation and backend.
+//
+// Usage: NumericFuzzer [--seconds <n>] [--threads <n>] [--seed <n>] [--out <file>]
+
+#include <algorithm>    // std::min
+#include <atomic>       // std::atomic_uint64_t
+#include <chrono>       // std::chrono::steady_clock
+#include <cmath>        // std::ldexp, std::isnan, std::signbit
+#include <cstddef>      // std::size_t
+#include <cstdint>      // std::uint64_t
+#include <cstring>      // std::strcmp, std::memcmp
+#include <fstream>      // std::ofstream
+#include <iostream>     // std::cout, std::cerr
+#include <limits>       // std::numeric_limits
+#include <mutex>        // std::mutex, std::lock_guard
+#include <ostream>      // std::ostream
+#include <random>       // std::mt19937_64
+#include <stdexcept>    // std::exception
+#include <string>       // std::string, std::stoul, std::stoull
+#include <system_error> // std::system_error
+#include <thread>       // std::thread
+#include <type_traits>  // std::is_integral
+#include <vector>       // std::vector
+
+#include "BulkCheck.h"
+#include "CpuDispatch.h"
+#include "DeferredChecks.h"
+#include "NumericBatch.h"
+#include "NumericFunctions.h"
+#include "NumericTypeList.h"
+#include "ResultFormat.h"
+
+namespace
+{
+    // Requests in one block. A multiple of every SIMD width, so the kernels handle whole blocks.
+    constexpr std::size_t block_lanes = 256;
+
+    // The reference loop takes one add per step, so integer walks past this many steps are checked against the portable engine.
+    constexpr step_count_t reference_step_budget = step_count_t{ 1 } << 14;
+
+    // Floating point walks are kept to this many steps, so every one of them is checked against the reference loop.
+    // That is still far past skip_ahead_min_steps, so the engine's skipped runs of equal steps are checked too.
+    constexpr step_count_t float_step_limit = reference_step_budget;
+
+    // How many times a failing request is made simpler before the shrinking stops.
+    constexpr int shrink_rounds = 4096;
+
+    /// <summary>
+    /// Command line settings.
+    /// </summary>
+    struct FuzzOptions
+    {
+        unsigned long seconds{ 10 };
+        unsigned threads{ 0 };          // 0 = one per core
+        std::uint64_t seed{ 0 };        // 0 = pick one from the clock
+        std::string out_path;           // empty = print to the console
+    };
+
+    enum class backend : std::size_t
+    {
+        portable,
+        intrinsic,
+        wide,
+        deferred,
+        batch,
+        avx512,
+        avx2,
+        neon,
+        count
+    };
+
+    constexpr const char* backend_names[] = { "portable", "intrinsic", "wide", "deferred", "batch", "avx512", "avx2", "neon" };
+
+    constexpr std::size_t backend_count = static_cast<std::size_t>(backend::count);
+
+    /// <summary>
+    /// One request: start +/- amount * steps.
+    /// </summary>
+    template <typename T>
+    struct FuzzCase
+    {
+        bool subtract{ false };
+        T start{};
+        T amount{};
+        step_count_t steps{ 0 };
+    };
+
+    /// <summary>
+    /// Whether a backend's answer counts as the same as the expected one. The batch forms
+    /// only give the value and success, and every NaN is as good as any other.
+    /// </summary>
+    template <typename T>
+    bool same_result(const CalcResult<T>& expected, const CalcResult<T>& actual, bool value_and_success_only)
+    {
+        bool same_value = false;
+        if constexpr (std::is_integral<T>::value)
+        {
+            same_value = expected.value == actual.value;
+        }
+        else
+        {
+            same_value = std::isnan(expected.value)
+                ? std::isnan(actual.value)
+                : std::memcmp(&expected.value, &actual.value, bulk_detail::value_bytes<T>()) == 0;
+        }
+        return same_value && expected.success == actual.success
+            && (value_and_success_only
+                || (expected.failed_at_step == actual.failed_at_step && expected.precision_lost == actual.precision_lost));
+    }
+
+    /// <summary>
+    /// A rough count of the steps the reference loop takes for c: it stops at the first refused step.
+    /// </summary>
+    template <typename T>
+    step_count_t reference_cost(const FuzzCase<T>& c)
+    {
+        if constexpr (std::is_integral<T>::value)
+        {
+            if (c.amount == T{ 0 })
+            {
+                return c.steps;
+            }
+            const bool upward = (c.amount > T{ 0 }) != c.subtract;
+            const long double start = static_cast<long double>(c.start);
+            const long double room = upward ? static_cast<long double>(std::numeric_limits<T>::max()) - start
+                : start - static_cast<long double>(std::numeric_limits<T>::lowest());
+            const long double amount = static_cast<long double>(c.amount);
+            const long double until_refused = room / (amount < 0 ? -amount : amount) + 2;
+            return until_refused < static_cast<long double>(c.steps) ? static_cast<step_count_t>(until_refused) : c.steps;
+        }
+        else
+        {
+            return c.steps;
+        }
+    }
+
+    /// <summary>
+    /// What c should give: the reference loop's answer, or the portable engine's for integer walks the loop would take
+    /// too long over (never for floating point, see float_step_limit). The loop never reports precision_lost, so for
+    /// floating point types that is worked out here: the walk completed and its last step left the value as it was
+    /// (once one step is absorbed, so is every step after it).
+    /// </summary>
+    template <typename T>
+    CalcResult<T> expected_result(const FuzzCase<T>& c, bool& from_reference)
+    {
+        from_reference = !std::is_integral<T>::value || reference_cost(c) <= reference_step_budget;
+        if (from_reference)
+        {
+            auto reference = [&c](step_count_t steps)
+            {
+                return c.subtract ? subtract_numbers_stepwise<T>(c.start, c.amount, steps) : add_numbers_stepwise<T>(c.start, c.amount, steps);
+            };
+            if constexpr (!std::is_integral<T>::value)
+            {
+                // All the steps but the last, then the last one, so its value before comes without a second walk.
+                if (c.steps != 0)
+                {
+                    CalcResult<T> result = reference(c.steps - 1);
+                    if (!result.success)
+                    {
+                        return result;
+                    }
+                    const T before = result.value;
+                    const CalcResult<T> last = c.subtract ? subtract_numbers_stepwise<T>(before, c.amount, 1) : add_numbers_stepwise<T>(before, c.amount, 1);
+                    result.value = last.value;
+                    result.success = last.success;
+                    result.failed_at_step = last.success ? 0 : c.steps - 1;
+                    result.precision_lost = last.success && c.amount != T{ 0 } && (c.subtract ? before - c.amount : before + c.amount) == before;
+                    return result;
+                }
+            }
+            return reference(c.steps);
+        }
+        return c.subtract ? subtract_numbers<T, portable_backend>(c.start, c.amount, c.steps) : add_numbers<T, portable_backend>(c.start, c.amount, c.steps);
+    }
+
+    /// <summary>
+    /// Whether backend b has anything of its own to run for T on this CPU.
+    /// </summary>
+    template <typename T>
+    bool backend_applies(backend b, batch_isa detected)
+    {
+        switch (b)
+        {
+        case backend::portable:
+            return true;
+        case backend::intrinsic:
+        case backend::wide:
+            // Floating point types ignore the Backend parameter; "portable" covers them.
+            return std::is_integral<T>::value;
+        case backend::deferred:
+            return overflow_traits<T>::accumulator::wider && overflow_traits<T>::accumulator::exact;
+        case backend::batch:
+            return true;
+        case backend::avx512:
+            return numeric_batch_detail::has_simd_kernel<T> && detected == batch_isa::avx512;
+        case backend::avx2:
+            return numeric_batch_detail::has_simd_kernel<T> && (detected == batch_isa::avx2 || detected == batch_isa::avx512);
+        case backend::neon:
+            return numeric_batch_detail::has_simd_kernel<T> && detected == batch_isa::neon;
+        default:
+            return false;
+        }
+    }
+
+    constexpr batch_isa backend_isa(backend b)
+    {
+        return b == backend::avx512 ? batch_isa::avx512 : b == backend::avx2 ? batch_isa::avx2 : batch_isa::neon;
+    }
+
+    /// <summary>
+    /// The SIMD kernel of isa over lanes [0, count), all with the same operation and step count.
+    /// </summary>
+    /// <returns>The number of leading lanes the kernel handled (0 when it has none for T or these steps)</returns>
+    template <typename T>
+    std::size_t run_kernel(batch_isa isa, bool subtract, const T* starts, const T* amounts, std::size_t count,
+        step_count_t steps, T* values, std::uint64_t* success_mask)
+    {
+        if constexpr (numeric_batch_detail::has_simd_kernel<T>)
+        {
+            const numeric_batch_detail::simd_walk_fn<T> walk = subtract
+                ? numeric_batch_detail::select_simd_walk<T, true>(isa)
+                : numeric_batch_detail::select_simd_walk<T, false>(isa);
+            for (std::size_t w = 0; w < batch_mask_words(count); ++w)
+            {
+                success_mask[w] = 0;
+            }
+            return walk != nullptr ? walk(starts, amounts, count, steps, values, success_mask) : 0;
+        }
+        else
+        {
+            (void)isa; (void)subtract; (void)starts; (void)amounts; (void)count; (void)steps; (void)values; (void)success_mask;
+            return 0;
+        }
+    }
+
+    /// <summary>
+    /// Runs one request through a scalar backend, or through a batch backend as a block of identical lanes.
+    /// </summary>
+    /// <returns>false when the backend did not handle the request (a SIMD kernel leaving it to the scalar engine)</returns>
+    template <typename T>
+    bool run_backend(backend b, const FuzzCase<T>& c, CalcResult<T>& result)
+    {
+        result = CalcResult<T>{};
+        switch (b)
+        {
+        case backend::portable:
+            result = c.subtract ? subtract_numbers<T, portable_backend>(c.start, c.amount, c.steps) : add_numbers<T, portable_backend>(c.start, c.amount, c.steps);
+            return true;
+        case backend::intrinsic:
+            result = c.subtract ? subtract_numbers<T, intrinsic_backend>(c.start, c.amount, c.steps) : add_numbers<T, intrinsic_backend>(c.start, c.amount, c.steps);
+            return true;
+        case backend::wide:
+            result = c.subtract ? subtract_numbers<T, wide_backend>(c.start, c.amount, c.steps) : add_numbers<T, wide_backend>(c.start, c.amount, c.steps);
+            return true;
+        case backend::deferred:
+            result = c.subtract ? subtract_numbers_deferred<T>(c.start, c.amount, c.steps) : add_numbers_deferred<T>(c.start, c.amount, c.steps);
+            return true;
+        default:
+            break;
+        }
+
+        // The batch forms, on a block of copies of c.
+        T starts[block_lanes];
+        T amounts[block_lanes];
+        T values[block_lanes];
+        std::uint64_t success_mask[batch_mask_words(block_lanes)];
+        for (std::size_t i = 0; i < block_lanes; ++i)
+        {
+            starts[i] = c.start;
+            amounts[i] = c.amount;
+        }
+        if (b == backend::batch)
+        {
+            if (c.subtract)
+            {
+                subtract_numbers_batch<T>(starts, amounts, block_lanes, c.steps, values, success_mask);
+            }
+            else
+            {
+                add_numbers_batch<T>(starts, amounts, block_lanes, c.steps, values, success_mask);
+            }
+        }
+        else if (run_kernel<T>(backend_isa(b), c.subtract, starts, amounts, block_lanes, c.steps, values, success_mask) == 0)
+        {
+            return false;
+        }
+        result.value = values[0];
+        result.success = batch_mask_test(success_mask, 0);
+        return true;
+    }
+
+    constexpr bool value_and_success_only(backend b)
+    {
+        return b == backend::batch || b == backend::avx512 || b == backend::avx2 || b == backend::neon;
+    }
+
+    template <typename T>
+    bool fails(backend b, const FuzzCase<T>& c)
+    {
+        bool from_reference = false;
+        const CalcResult<T> expected = expected_result(c, from_reference);
+        CalcResult<T> actual{};
+        return run_backend(b, c, actual) && !same_result(expected, actual, value_and_success_only(b));
+    }
+
+    /// <summary>
+    /// A value closer to 0 than value (NaN and infinities come down to the limits first), or value itself at 0.
+    /// </summary>
+    template <typename T>
+    T smaller(T value, bool halve)
+    {
+        if constexpr (std::is_integral<T>::value)
+        {
+            return halve ? static_cast<T>(value / 2) : value > T{ 0 } ? static_cast<T>(value - 1) : value < T{ 0 } ? static_cast<T>(value + 1) : value;
+        }
+        else
+        {
+            if (std::isnan(value))
+            {
+                return halve ? T{ 0 } : std::numeric_limits<T>::max();
+            }
+            if (value == std::numeric_limits<T>::infinity() || value == -std::numeric_limits<T>::infinity())
+            {
+                return std::signbit(value) ? std::numeric_limits<T>::lowest() : std::numeric_limits<T>::max();
+            }
+            return halve ? value / 2 : T{ 0 };
+        }
+    }
+
+    /// <summary>
+    /// Makes a failing request simpler for as long as it keeps failing on b: fewer steps, then values closer to 0.
+    /// </summary>
+    template <typename T>
+    FuzzCase<T> shrink(backend b, FuzzCase<T> c)
+    {
+        for (int round = 0; round < shrink_rounds; ++round)
+        {
+            FuzzCase<T> candidates[8] = { c, c, c, c, c, c, c, c };
+            candidates[0].steps = c.steps / 2;
+            candidates[1].steps = c.steps - (c.steps != 0 ? 1 : 0);
+            candidates[2].start = smaller(c.start, false);
+            candidates[3].start = smaller(c.start, true);
+            candidates[4].amount = smaller(c.amount, false);
+            candidates[5].amount = smaller(c.amount, true);
+            candidates[6].subtract = false;
+            candidates[6].amount = smaller(c.amount, true);
+            candidates[7].start = T{ 0 };
+
+            bool shrunk = false;
+            for (const FuzzCase<T>& candidate : candidates)
+            {
+                const bool simpler = candidate.steps < c.steps
+                    || std::memcmp(&candidate.start, &c.start, sizeof(T)) != 0
+                    || std::memcmp(&candidate.amount, &c.amount, sizeof(T)) != 0
+                    || candidate.subtract != c.subtract;
+                if (simpler && fails(b, candidate))
+                {
+                    c = candidate;
+                    shrunk = true;
+                    break;
+                }
+            }
+            if (!shrunk)
+            {
+                break;
+            }
+        }
+        return c;
+    }
+
+    /// <summary>
+    /// Collects the shrunk mismatches from every worker, one for each type, operation and backend.
+    /// </summary>
+    class FailureLog
+    {
+    public:
+        FailureLog() : reported_(tested_types::size * 2 * backend_count, false) {}
+
+        /// <summary>
+        /// Counts a mismatch. Returns true when it is the first for its type, operation and backend,
+        /// in which case the caller shrinks it and hands it to report().
+        /// </summary>
+        bool first(std::size_t type, bool subtract, backend b)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ++mismatches_[static_cast<std::size_t>(b)];
+            const std::size_t key = (type * 2 + (subtract ? 1 : 0)) * backend_count + static_cast<std::size_t>(b);
+            const bool is_first = !reported_[key];
+            reported_[key] = true;
+            return is_first;
+        }
+
+        template <typename T>
+        void report(backend b, const FuzzCase<T>& c)
+        {
+            bool from_reference = false;
+            const CalcResult<T> expected = expected_result(c, from_reference);
+            CalcResult<T> actual{};
+            run_backend(b, c, actual);
+
+            // The bulk request first, so the comment can say what every part of it gave.
+            char start[number_text_capacity];
+            char amount[number_text_capacity];
+            char expected_text[result_text_capacity];
+            char actual_text[result_text_capacity];
+            const std::string request = std::string(c.subtract ? "sub " : "add ") + bulk_type_names[type_index<T, tested_types>::value] + ' '
+                + std::string(start, write_number(start, start + sizeof(start), +c.start, true)) + ' '
+                + std::string(amount, write_number(amount, amount + sizeof(amount), +c.amount, true)) + ' '
+                + std::to_string(c.steps);
+            const std::string text = std::string("# ") + backend_names[static_cast<std::size_t>(b)] + " differs from "
+                + (from_reference ? "the stepwise reference" : "the portable engine") + ": expected "
+                + std::string(expected_text, format_result(expected_text, expected_text + sizeof(expected_text), expected))
+                + ", got " + std::string(actual_text, format_result(actual_text, actual_text + sizeof(actual_text), actual))
+                + (value_and_success_only(b) ? " (value and success only)" : "") + '\n' + request + '\n';
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            reports_.push_back(text);
+        }
+
+        std::uint64_t mismatches(backend b) const { return mismatches_[static_cast<std::size_t>(b)]; }
+
+        const std::vector<std::string>& reports() const { return reports_; }
+
+    private:
+        std::mutex mutex_;
+        std::vector<bool> reported_;
+        std::uint64_t mismatches_[backend_count]{};
+        std::vector<std::string> reports_;
+    };
+
+    /// <summary>
+    /// A random value of T, most of the time one of the edge values.
+    /// </summary>
+    template <typename T>
+    T edge_value(std::mt19937_64& rng)
+    {
+        using limits = std::numeric_limits<T>;
+        const std::uint64_t bits = rng();
+        if constexpr (std::is_integral<T>::value)
+        {
+            switch (bits % 12)
+            {
+            case 0: return limits::max();
+            case 1: return static_cast<T>(limits::max() - 1);
+            case 2: return limits::lowest();
+            case 3: return static_cast<T>(limits::lowest() + 1);
+            case 4: return T{ 0 };
+            case 5: return T{ 1 };
+            case 6: return static_cast<T>(-1);
+            case 7: return static_cast<T>(limits::max() / 2 + static_cast<T>((bits >> 8) % 3) - 1);
+            case 8: return static_cast<T>((std::uint64_t{ 1 } << ((bits >> 8) % limits::digits)) + (bits >> 16) % 3 - 1);
+            case 9: return static_cast<T>(static_cast<long long>((bits >> 8) % 201) - 100);
+            default: return static_cast<T>(bits >> 4);
+            }
+        }
+        else
+        {
+            switch (bits % 18)
+            {
+            case 0: return limits::max();
+            case 1: return limits::lowest();
+            case 2: return T{ 0 };
+            case 3: return -T{ 0 };
+            case 4: return T{ 1 };
+            case 5: return T{ -1 };
+            case 6: return (bits & 0x100) ? limits::min() : -limits::min();
+            case 7: return (bits & 0x100) ? limits::denorm_min() : -limits::denorm_min();
+            case 8: return limits::denorm_min() * static_cast<T>((bits >> 8) % 1000);
+            case 9: return (bits & 0x100) ? limits::infinity() : -limits::infinity();
+            case 10: return limits::quiet_NaN();
+            case 11: return (bits & 0x100) ? limits::epsilon() : limits::epsilon() / 2;
+            case 12: return limits::max() / 2;
+            case 13: return static_cast<T>(static_cast<long long>((bits >> 8) % 2001) - 1000) / 8;
+            default:
+            {
+                // Any sign and magnitude, subnormal to near the limit.
+                const int span = limits::max_exponent - limits::min_exponent + limits::digits;
+                const T mantissa = static_cast<T>(static_cast<double>(bits >> 11) / 9007199254740992.0);
+                const int exponent = static_cast<int>((bits >> 3) % static_cast<std::uint64_t>(span)) + limits::min_exponent - limits::digits;
+                const T value = std::ldexp(mantissa, exponent);
+                return (bits & 4) ? -value : value;
+            }
+            }
+        }
+    }
+
+    /// <summary>
+    /// A step count for a block, often one of the edges: 0 and 1, powers of two and their neighbours, the
+    /// 32-bit limit the integer kernels stop at, and the largest count there is.
+    /// </summary>
+    inline step_count_t edge_steps(std::mt19937_64& rng)
+    {
+        const std::uint64_t bits = rng();
+        switch (bits % 8)
+        {
+        case 0: return (bits >> 8) % 4;
+        case 1:
+        case 2: return (bits >> 8) % 300;
+        case 3: return (bits >> 8) % 5000;
+        case 4: return (step_count_t{ 1 } << ((bits >> 8) % 64)) + (bits >> 16) % 3 - 1;
+        case 5: return (bits & 0x100) ? 0xFFFFFFFFu : step_count_t{ 0x100000000 };
+        case 6: return std::numeric_limits<step_count_t>::max();
+        default: return bits >> ((bits >> 8) % 64);
+        }
+    }
+
+    /// <summary>
+    /// Fills a block of requests and checks every one on every backend that applies.
+    /// </summary>
+    /// <returns>The number of requests checked</returns>
+    template <typename T>
+    std::uint64_t fuzz_block(bool subtract, std::mt19937_64& rng, batch_isa detected, FailureLog& log)
+    {
+        step_count_t steps = edge_steps(rng);
+        if constexpr (!std::is_integral<T>::value)
+        {
+            steps = std::min(steps, float_step_limit);
+        }
+
+        T starts[block_lanes];
+        T amounts[block_lanes];
+        for (std::size_t i = 0; i < block_lanes; ++i)
+        {
+            amounts[i] = edge_value<T>(rng);
+            starts[i] = edge_value<T>(rng);
+            if (rng() % 4 == 0)
+            {
+                // Start just short of (or just past) the limit the walk heads for.
+                const T limit = (amounts[i] > T{ 0 }) != subtract ? std::numeric_limits<T>::max() : std::numeric_limits<T>::lowest();
+                const CalcResult<T> back = subtract ? add_numbers<T, portable_backend>(limit, amounts[i], steps)
+                    : subtract_numbers<T, portable_backend>(limit, amounts[i], steps);
+                if (back.success)
+                {
+                    const std::uint64_t nudge = rng() % 3;
+                    starts[i] = nudge == 0 ? back.value
+                        : nudge == 1 ? add_numbers<T, portable_backend>(back.value, T{ 1 }, 1).value
+                        : subtract_numbers<T, portable_backend>(back.value, T{ 1 }, 1).value;
+                }
+            }
+        }
+
+        const std::size_t type = type_index<T, tested_types>::value;
+        std::vector<CalcResult<T>> expected(block_lanes);
+        for (std::size_t i = 0; i < block_lanes; ++i)
+        {
+            bool from_reference = false;
+            expected[i] = expected_result(FuzzCase<T>{ subtract, starts[i], amounts[i], steps }, from_reference);
+        }
+
+        for (std::size_t b = 0; b < backend_count; ++b)
+        {
+            const backend id = static_cast<backend>(b);
+            if (!backend_applies<T>(id, detected))
+            {
+                continue;
+            }
+
+            // The batch forms run the whole block at once; the scalar ones one request at a time.
+            T values[block_lanes];
+            std::uint64_t success_mask[batch_mask_words(block_lanes)]{};
+            std::size_t handled = 0;
+            if (id == backend::batch)
+            {
+                if (subtract)
+                {
+                    subtract_numbers_batch<T>(starts, amounts, block_lanes, steps, values, success_mask);
+                }
+                else
+                {
+                    add_numbers_batch<T>(starts, amounts, block_lanes, steps, values, success_mask);
+                }
+                handled = block_lanes;
+            }
+            else if (value_and_success_only(id))
+            {
+                handled = run_kernel<T>(backend_isa(id), subtract, starts, amounts, block_lanes, steps, values, success_mask);
+            }
+
+            for (std::size_t i = 0; i < block_lanes; ++i)
+            {
+                const FuzzCase<T> c{ subtract, starts[i], amounts[i], steps };
+                CalcResult<T> actual{};
+                if (value_and_success_only(id))
+                {
+                    if (i >= handled)
+                    {
+                        break;
+                    }
+                    actual.value = values[i];
+                    actual.success = batch_mask_test(success_mask, i);
+                }
+                else
+                {
+                    run_backend(id, c, actual);
+                }
+
+                if (!same_result(expected[i], actual, value_and_success_only(id)) && log.first(type, subtract, id))
+                {
+                    // Shrinking needs the request to fail on its own too; if it does not, it is reported as drawn.
+                    log.report(id, fails(id, c) ? shrink(id, c) : c);
+                }
+            }
+        }
+        return block_lanes;
+    }
+
+    bool parse_options(int argc, char* argv[], FuzzOptions& options)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            try
+            {
+                if (std::strcmp(argv[i], "--seconds") == 0 && i + 1 < argc)
+                {
+                    options.seconds = std::stoul(argv[++i]);
+                }
+                else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+                {
+                    options.threads = static_cast<unsigned>(std::stoul(argv[++i]));
+                }
+                else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+                {
+                    options.seed = std::stoull(argv[++i]);
+                }
+                else if (std::strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+                {
+                    options.out_path = argv[++i];
+                }
+                else
+                {
+                    return false;
+                }
+            }
+            catch (const std::exception&)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+/// <summary>
+/// Entry point into the fuzzer
+/// </summary>
+/// <returns>0 when every backend agreed, 1 for a mismatch, bad arguments or an output file that cannot be written</returns>
+int main(int argc, char* argv[])
+{
+    FuzzOptions options{};
+    if (!parse_options(argc, argv, options))
+    {
+        std::cerr << "Usage: NumericFuzzer [--seconds <n>] [--threads <n>] [--seed <n>] [--out <file>]" << std::endl;
+        return 1;
+    }
+    if (options.seed == 0)
+    {
+        options.seed = static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count()) | 1;
+    }
+    if (options.threads == 0)
+    {
+        options.threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    std::ofstream file;
+    if (!options.out_path.empty())
+    {
+        file.open(options.out_path);
+        if (!file)
+        {
+            std::cerr << "Cannot write " << options.out_path << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& out = options.out_path.empty() ? std::cout : file;
+
+    const batch_isa detected = cpu_dispatch_detail::detect();
+    const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::seconds(options.seconds);
+    FailureLog log;
+    std::atomic_uint64_t checked{ 0 };
+
+    // Every worker draws its own stream of blocks, each one a random type and operation.
+    auto worker = [&](unsigned index)
+    {
+        std::mt19937_64 rng(options.seed + index);
+        std::uint64_t count = 0;
+        do
+        {
+            const std::size_t type = static_cast<std::size_t>(rng() % tested_types::size);
+            const bool subtract = (rng() & 1) != 0;
+            dispatch_type<tested_types>(type, [&](auto tag)
+            {
+                count += fuzz_block<typename decltype(tag)::type>(subtract, rng, detected, log);
+            });
+        } while (std::chrono::steady_clock::now() < deadline);
+        checked += count;
+    };
+
+    std::vector<std::thread> pool;
+    try
+    {
+        for (unsigned t = 0; t < options.threads; ++t)
+        {
+            pool.emplace_back(worker, t);
+        }
+    }
+    catch (const std::system_error&)
+    {
+        // Out of threads: the ones that did start share the work, or this thread does it all.
+        if (pool.empty())
+        {
+            worker(0);
+        }
+    }
+    for (std::thread& thread : pool)
+    {
+        thread.join();
+    }
+
+    for (const std::string& report : log.reports())
+    {
+        out << report;
+    }
+    out.flush();
+
+    std::uint64_t mismatches = 0;
+    std::cerr << "Checked " << checked.load() << " requests on " << std::max<std::size_t>(pool.size(), 1) << " threads in "
+        << options.seconds << " s, seed " << options.seed << ", batch kernels up to " << batch_isa_name(detected) << std::endl;
+    for (std::size_t b = 0; b < backend_count; ++b)
+    {
+        const std::uint64_t count = log.mismatches(static_cast<backend>(b));
+        mismatches += count;
+        if (count != 0)
+        {
+            std::cerr << "  " << backend_names[b] << ": " << count << " mismatches" << std::endl;
+        }
+    }
+    std::cerr << (mismatches == 0 ? "No mismatches" : "Shrunk failing requests are in the output, one per type, operation and backend")
+        << std::endl;
+    return mismatches == 0 ? 0 : 1;
+}
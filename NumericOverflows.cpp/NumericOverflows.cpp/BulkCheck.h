@@ -0,0 +1,678 @@
+// BulkCheck.h : Streams add / subtract requests through add_numbers and subtract_numbers in bulk.
+//
+// Records are read from stdin or a file in fixed-size chunks and every result is written through a ReportSink,
+// so memory stays constant however long the stream is. Each record names its operation and type and is
+// dispatched to the matching add_numbers<T> / subtract_numbers<T> instantiation. BulkPipeline.h runs the same
+// per-record code on reader, checker and writer threads.
+//
+// Text format, one request per line (blank lines and lines starting with '#' are skipped):
+//     <add|sub> <type> <start> <amount> <steps>         e.g.  add int 2147483000 100 6
+// and one result line per request:
+//     <value> <success 0|1> <failed_at_step> <precision_lost 0|1>     or "error" for a line that does not parse
+// Types are char, wchar_t, short, int, long, longlong, uchar, ushort, uint, ulong, ulonglong, float, double
+// and longdouble. Floating point results are written with every digit needed to read them back exactly.
+// Start, amount and steps may each begin with one '+', as long as no other sign follows it.
+//
+// Binary format, native byte order, 48 bytes in:
+//     [0] op (0 = add, 1 = subtract)   [1] type (bulk_type)   [2..7] zero   [8..15] steps (uint64)
+//     [16..31] start   [32..47] amount  (the value's own bytes, then zero padding)
+// and 32 bytes out:
+//     [0..15] value   [16..23] failed_at_step (uint64)   [24] success   [25] precision_lost
+//     [26] 1 when the record was invalid   [27..31] zero
+
+#pragma once
+
+#include <charconv>     // std::from_chars
+#include <cstddef>      // std::size_t
+#include <cstdint>      // std::uint8_t, std::uint64_t
+#include <cstdio>       // std::FILE, std::fopen, std::fread, std::fclose
+#include <cstdlib>      // std::strtold, std::strtoul
+#include <cstring>      // std::memcpy, std::memchr, std::memmove, std::memset, std::strcmp
+#include <limits>       // std::numeric_limits
+#include <memory>       // std::unique_ptr, std::make_unique
+#include <ostream>      // std::ostream
+#include <string>       // std::string
+#include <system_error> // std::errc
+#include <type_traits>  // std::is_integral, std::is_signed, std::is_same
+#include <vector>       // std::vector
+
+#if defined(_WIN32)
+#include <fcntl.h>      // _O_BINARY
+#include <io.h>         // _setmode, _fileno
+#endif
+
+#include "NumericFunctions.h"
+#include "NumericTypeList.h"
+#include "ReportSink.h"
+#include "ResultFormat.h"
+
+
+/// <summary>
+/// The types a bulk record can name: the position of each type in tested_types, fixed here because
+/// it is part of the binary record and columnar file formats.
+/// </summary>
+enum class bulk_type : std::uint8_t
+{
+    char_type,
+    wchar_type,
+    short_type,
+    int_type,
+    long_type,
+    long_long_type,
+    unsigned_char_type,
+    unsigned_short_type,
+    unsigned_int_type,
+    unsigned_long_type,
+    unsigned_long_long_type,
+    float_type,
+    double_type,
+    long_double_type,
+    count
+};
+
+/// <summary>
+/// The operation a bulk record asks for.
+/// </summary>
+enum class bulk_op : std::uint8_t
+{
+    add,
+    subtract,
+    count
+};
+
+/// <summary>
+/// The names bulk text records use for each bulk_type.
+/// </summary>
+constexpr const char* bulk_type_names[] = {
+    "char", "wchar_t", "short", "int", "long", "longlong",
+    "uchar", "ushort", "uint", "ulong", "ulonglong",
+    "float", "double", "longdouble"
+};
+
+static_assert(sizeof(bulk_type_names) / sizeof(bulk_type_names[0]) == tested_types::size, "one bulk name per tested type");
+
+constexpr std::size_t bulk_input_record_size = 48;
+constexpr std::size_t bulk_output_record_size = 32;
+
+static_assert(static_cast<std::size_t>(bulk_type::count) == tested_types::size, "every tested type needs a bulk_type");
+static_assert(static_cast<std::size_t>(bulk_type::char_type) == type_index<char, tested_types>::value
+    && static_cast<std::size_t>(bulk_type::long_long_type) == type_index<long long, tested_types>::value
+    && static_cast<std::size_t>(bulk_type::unsigned_char_type) == type_index<unsigned char, tested_types>::value
+    && static_cast<std::size_t>(bulk_type::unsigned_long_long_type) == type_index<unsigned long long, tested_types>::value
+    && static_cast<std::size_t>(bulk_type::float_type) == type_index<float, tested_types>::value
+    && static_cast<std::size_t>(bulk_type::long_double_type) == type_index<long double, tested_types>::value,
+    "bulk_type must follow the order of tested_types");
+
+/// <summary>
+/// Calls f(type_tag<T>{}) for the type that type names, through the tested_types dispatch table.
+/// </summary>
+/// <returns>false (without calling f) when type is not a valid bulk_type</returns>
+template <typename F>
+bool dispatch_bulk_type(bulk_type type, F&& f)
+{
+    return dispatch_type<tested_types>(static_cast<std::size_t>(type), f);
+}
+
+/// <summary>
+/// Command line settings for the bulk mode.
+/// </summary>
+struct BulkOptions
+{
+    bool binary{ false };
+    bool columnar{ false };  // memory-mapped columnar files (ColumnarFile.h) instead of a record stream
+    bool pipeline{ false };  // reader, checker and writer threads (BulkPipeline.h) instead of one loop
+    unsigned workers{ 0 };   // checker threads for the pipeline; 0 = one per core, less one
+    std::string in_path;    // empty = stdin
+    std::string out_path;   // empty = stdout
+};
+
+
+namespace bulk_detail
+{
+    /// <summary>
+    /// Bytes of a T that carry its value. x87 long double keeps 10 bytes in a 12 or 16 byte object;
+    /// the rest is padding with no defined contents, so it is never copied into a record.
+    /// </summary>
+    template <typename T>
+    constexpr std::size_t value_bytes()
+    {
+        return std::is_same<T, long double>::value && std::numeric_limits<long double>::digits == 64 && sizeof(long double) > 10
+            ? 10
+            : sizeof(T);
+    }
+
+    /// <summary>
+    /// Reads a file (or stdin) through one buffer that is refilled as it is consumed.
+    /// </summary>
+    class ChunkedInput
+    {
+    public:
+        static constexpr std::size_t capacity = 1024 * 1024;
+
+        explicit ChunkedInput(std::FILE* file) : file_(file), buffer_(capacity) {}
+
+        /// <summary>
+        /// Makes at least count bytes available from data(), unless the input ends first.
+        /// </summary>
+        /// <returns>the number of bytes available, less than count only at the end of the input</returns>
+        std::size_t require(std::size_t count)
+        {
+            if (end_ - begin_ < count && !eof_)
+            {
+                refill();
+            }
+            return end_ - begin_;
+        }
+
+        /// <summary>
+        /// Finds the next line, without its line break (a trailing '\r' is dropped too).
+        /// </summary>
+        /// <returns>false at the end of the input, or when a line does not fit in the buffer (too_long())</returns>
+        bool next_line(const char*& first, const char*& last)
+        {
+            for (;;)
+            {
+                const char* const start = buffer_.data() + begin_;
+                const std::size_t available = end_ - begin_;
+                const void* const newline = std::memchr(start, '\n', available);
+                if (newline != nullptr || (eof_ && available != 0))
+                {
+                    first = start;
+                    last = newline != nullptr ? static_cast<const char*>(newline) : start + available;
+                    begin_ += static_cast<std::size_t>(last - start) + (newline != nullptr ? 1 : 0);
+                    if (last != first && last[-1] == '\r')
+                    {
+                        --last;
+                    }
+                    return true;
+                }
+                if (eof_)
+                {
+                    return false;
+                }
+                if (available == buffer_.size())
+                {
+                    too_long_ = true;
+                    return false;
+                }
+                refill();
+            }
+        }
+
+        const char* data() const { return buffer_.data() + begin_; }
+
+        void consume(std::size_t count) { begin_ += count; }
+
+        bool too_long() const { return too_long_; }
+
+    private:
+        void refill()
+        {
+            // Keep what is left at the front of the buffer and read in behind it.
+            const std::size_t left = end_ - begin_;
+            std::memmove(buffer_.data(), buffer_.data() + begin_, left);
+            begin_ = 0;
+            end_ = left;
+            while (end_ < buffer_.size() && !eof_)
+            {
+                const std::size_t read = std::fread(buffer_.data() + end_, 1, buffer_.size() - end_, file_);
+                end_ += read;
+                eof_ = read == 0;
+            }
+        }
+
+        std::FILE* file_;
+        std::vector<char> buffer_;
+        std::size_t begin_{ 0 };
+        std::size_t end_{ 0 };
+        bool eof_{ false };
+        bool too_long_{ false };
+    };
+
+    /// <summary>
+    /// Splits off the next space or tab separated token from [cursor, last).
+    /// </summary>
+    inline bool next_token(const char*& cursor, const char* last, const char*& first, const char*& token_last)
+    {
+        while (cursor != last && (*cursor == ' ' || *cursor == '\t'))
+        {
+            ++cursor;
+        }
+        first = cursor;
+        while (cursor != last && *cursor != ' ' && *cursor != '\t')
+        {
+            ++cursor;
+        }
+        token_last = cursor;
+        return first != token_last;
+    }
+
+    inline bool token_is(const char* first, const char* last, const char* text)
+    {
+        const std::size_t size = static_cast<std::size_t>(last - first);
+        return std::char_traits<char>::length(text) == size && std::memcmp(first, text, size) == 0;
+    }
+
+    /// <summary>
+    /// Skips the '+' a number may start with. std::from_chars takes no '+' but does take a '-', so a sign
+    /// right after the '+' (or nothing at all) is refused here rather than read as part of the number.
+    /// </summary>
+    /// <returns>false when the token is "+" alone or "+" followed by another sign</returns>
+    inline bool skip_plus(const char*& first, const char* last)
+    {
+        if (first == last || *first != '+')
+        {
+            return true;
+        }
+        ++first;
+        return first != last && *first != '+' && *first != '-';
+    }
+
+    /// <summary>
+    /// Parses a whole token as a T. Integers must be in T's range; a leading '+' is allowed, as in the steps field.
+    /// </summary>
+    template <typename T>
+    bool parse_value(const char* first, const char* last, T& value)
+    {
+        if (!skip_plus(first, last))
+        {
+            return false;
+        }
+
+        if constexpr (std::is_integral<T>::value)
+        {
+            // Parsed as the widest type of the same signedness, so char and wchar_t work too.
+            using wide = typename std::conditional<std::is_signed<T>::value, long long, unsigned long long>::type;
+            wide parsed{ 0 };
+            const std::from_chars_result r = std::from_chars(first, last, parsed);
+            if (r.ec != std::errc() || r.ptr != last
+                || parsed < static_cast<wide>(std::numeric_limits<T>::lowest())
+                || parsed > static_cast<wide>(std::numeric_limits<T>::max()))
+            {
+                return false;
+            }
+            value = static_cast<T>(parsed);
+            return true;
+        }
+        else
+        {
+#if defined(__cpp_lib_to_chars)
+            const std::from_chars_result r = std::from_chars(first, last, value);
+            if (r.ec == std::errc() || r.ptr != last)
+            {
+                return r.ec == std::errc() && r.ptr == last;
+            }
+            // Out of range leaves value alone, and some libraries count subnormals as out of range.
+            // strtold below gives the nearest value instead (the subnormal, zero or infinity).
+#endif
+            {
+                // strtold needs a terminated string; no number worth reading is longer than this.
+                char text[128];
+                const std::size_t size = static_cast<std::size_t>(last - first);
+                if (size == 0 || size >= sizeof(text))
+                {
+                    return false;
+                }
+                std::memcpy(text, first, size);
+                text[size] = '\0';
+                char* end = nullptr;
+                const long double parsed = std::strtold(text, &end);
+                if (end != text + size)
+                {
+                    return false;
+                }
+                value = static_cast<T>(parsed);
+                return true;
+            }
+        }
+    }
+
+    template <typename T>
+    CalcResult<T> run_check(bulk_op op, T const& start, T const& amount, step_count_t steps)
+    {
+        return op == bulk_op::subtract ? subtract_numbers<T>(start, amount, steps) : add_numbers<T>(start, amount, steps);
+    }
+
+    // Room for the text any one input line produces: its result line, or "error".
+    constexpr std::size_t text_line_capacity = result_text_capacity + 1;
+
+    /// <summary>
+    /// Checks one text request, writing its result line (with the line break) to out.
+    /// </summary>
+    /// <returns>One past the line written, or nullptr (with nothing written) when the request does not parse</returns>
+    inline char* check_text_request(const char* cursor, const char* last, char* out)
+    {
+        const char* first = nullptr;
+        const char* token_last = nullptr;
+
+        if (!next_token(cursor, last, first, token_last))
+        {
+            return nullptr;
+        }
+        bulk_op op = bulk_op::count;
+        if (token_is(first, token_last, "add") || token_is(first, token_last, "+"))
+        {
+            op = bulk_op::add;
+        }
+        else if (token_is(first, token_last, "sub") || token_is(first, token_last, "-"))
+        {
+            op = bulk_op::subtract;
+        }
+        else
+        {
+            return nullptr;
+        }
+
+        if (!next_token(cursor, last, first, token_last))
+        {
+            return nullptr;
+        }
+        std::size_t type = 0;
+        while (type < static_cast<std::size_t>(bulk_type::count) && !token_is(first, token_last, bulk_type_names[type]))
+        {
+            ++type;
+        }
+
+        const char* start_first = nullptr;
+        const char* start_last = nullptr;
+        const char* amount_first = nullptr;
+        const char* amount_last = nullptr;
+        const char* steps_first = nullptr;
+        const char* steps_last = nullptr;
+        step_count_t steps{ 0 };
+        if (!next_token(cursor, last, start_first, start_last)
+            || !next_token(cursor, last, amount_first, amount_last)
+            || !next_token(cursor, last, steps_first, steps_last)
+            || next_token(cursor, last, first, token_last)
+            || *steps_first == '-'
+            || !skip_plus(steps_first, steps_last))
+        {
+            return nullptr;
+        }
+        // A count too large for step_count_t is out of range, not 0.
+        const std::from_chars_result parsed_steps = std::from_chars(steps_first, steps_last, steps);
+        if (parsed_steps.ec != std::errc() || parsed_steps.ptr != steps_last)
+        {
+            return nullptr;
+        }
+
+        char* written = nullptr;
+        dispatch_bulk_type(static_cast<bulk_type>(type), [&](auto tag)
+        {
+            using T = typename decltype(tag)::type;
+
+            T start{};
+            T amount{};
+            if (!parse_value(start_first, start_last, start) || !parse_value(amount_first, amount_last, amount))
+            {
+                return;
+            }
+
+            // result_text_capacity always holds the result, so format_result cannot fail here.
+            char* const end = format_result(out, out + result_text_capacity, run_check<T>(op, start, amount, steps));
+            *end = '\n';
+            written = end + 1;
+        });
+        return written;
+    }
+
+    /// <summary>
+    /// Handles one line of text input: blank lines and comments write nothing, a request writes its result
+    /// line and anything else writes "error". out needs room for text_line_capacity characters.
+    /// </summary>
+    /// <param name="valid">Set to false for a line that is not a valid request</param>
+    /// <returns>One past the text written</returns>
+    inline char* process_text_line(const char* first, const char* last, char* out, bool& valid)
+    {
+        valid = true;
+        while (first != last && (*first == ' ' || *first == '\t'))
+        {
+            ++first;
+        }
+        if (first == last || *first == '#')
+        {
+            return out;
+        }
+        char* const end = check_text_request(first, last, out);
+        if (end != nullptr)
+        {
+            return end;
+        }
+        valid = false;
+        std::memcpy(out, "error\n", 6);
+        return out + 6;
+    }
+
+    /// <summary>
+    /// Handles one binary request record, writing its bulk_output_record_size byte result record to result.
+    /// </summary>
+    inline bool process_binary_record(const unsigned char* record, unsigned char* result)
+    {
+        std::memset(result, 0, bulk_output_record_size);
+
+        const bulk_op op = static_cast<bulk_op>(record[0]);
+        step_count_t steps{ 0 };
+        std::memcpy(&steps, record + 8, sizeof(steps));
+
+        const bool valid = op < bulk_op::count && dispatch_bulk_type(static_cast<bulk_type>(record[1]), [&](auto tag)
+        {
+            using T = typename decltype(tag)::type;
+
+            T start{};
+            T amount{};
+            std::memcpy(&start, record + 16, value_bytes<T>());
+            std::memcpy(&amount, record + 32, value_bytes<T>());
+
+            const CalcResult<T> r = run_check<T>(op, start, amount, steps);
+            std::memcpy(result, &r.value, value_bytes<T>());
+            std::memcpy(result + 16, &r.failed_at_step, sizeof(r.failed_at_step));
+            result[24] = r.success ? 1 : 0;
+            result[25] = r.precision_lost ? 1 : 0;
+        });
+
+        result[26] = valid ? 0 : 1;
+        return valid;
+    }
+
+    inline void set_binary_mode(std::FILE* file)
+    {
+#if defined(_WIN32)
+        _setmode(_fileno(file), _O_BINARY);
+#else
+        (void)file;
+#endif
+    }
+
+    /// <summary>
+    /// The input and output of a bulk run, opened as BulkOptions says and closed again on destruction.
+    /// </summary>
+    class BulkFiles
+    {
+    public:
+        BulkFiles() = default;
+
+        ~BulkFiles()
+        {
+            if (in_ != nullptr && in_ != stdin)
+            {
+                std::fclose(in_);
+            }
+        }
+
+        BulkFiles(const BulkFiles&) = delete;
+        BulkFiles& operator=(const BulkFiles&) = delete;
+
+        /// <summary>
+        /// Opens options.in_path (or stdin) and options.out_path (or stdout).
+        /// </summary>
+        /// <returns>false, after telling errors which, when a file cannot be opened</returns>
+        bool open(const BulkOptions& options, std::ostream& errors)
+        {
+            in_ = stdin;
+            if (!options.in_path.empty())
+            {
+#if defined(_MSC_VER)
+                if (fopen_s(&in_, options.in_path.c_str(), "rb") != 0)
+                {
+                    in_ = nullptr;
+                }
+#else
+                in_ = std::fopen(options.in_path.c_str(), "rb");
+#endif
+                if (in_ == nullptr)
+                {
+                    errors << "Cannot read " << options.in_path << std::endl;
+                    return false;
+                }
+            }
+            else if (options.binary)
+            {
+                set_binary_mode(stdin);
+            }
+
+            if (!options.out_path.empty())
+            {
+                file_ = std::make_unique<FileReportBackend>(options.out_path);
+                if (!file_->is_open())
+                {
+                    errors << "Cannot write " << options.out_path << std::endl;
+                    return false;
+                }
+            }
+            else if (options.binary)
+            {
+                set_binary_mode(stdout);
+            }
+            return true;
+        }
+
+        std::FILE* in() const { return in_; }
+
+        ReportBackend& out() { return file_ ? static_cast<ReportBackend&>(*file_) : console_; }
+
+    private:
+        std::FILE* in_{ nullptr };
+        ConsoleReportBackend console_;
+        std::unique_ptr<FileReportBackend> file_;
+    };
+
+    /// <summary>
+    /// The body of run_bulk: every request in files.in(), one after the other, answered on files.out().
+    /// </summary>
+    inline int run_records(BulkFiles& files, bool binary, std::ostream& errors)
+    {
+        ReportSink out(files.out(), 1024 * 1024);
+        ChunkedInput input(files.in());
+        std::uint64_t record = 0;
+        std::uint64_t invalid = 0;
+
+        if (binary)
+        {
+            unsigned char result[bulk_output_record_size];
+            while (input.require(bulk_input_record_size) >= bulk_input_record_size)
+            {
+                ++record;
+                if (!process_binary_record(reinterpret_cast<const unsigned char*>(input.data()), result))
+                {
+                    ++invalid;
+                }
+                out.write(reinterpret_cast<const char*>(result), sizeof(result));
+                input.consume(bulk_input_record_size);
+            }
+            if (input.require(1) != 0)
+            {
+                errors << "The input ends in the middle of a record" << std::endl;
+                ++invalid;
+            }
+        }
+        else
+        {
+            char line[text_line_capacity];
+            const char* first = nullptr;
+            const char* last = nullptr;
+            while (input.next_line(first, last))
+            {
+                ++record;
+                bool valid = true;
+                const char* const end = process_text_line(first, last, line, valid);
+                out.write(line, static_cast<std::size_t>(end - line));
+                if (!valid && invalid++ == 0)
+                {
+                    errors << "Line " << record << " is not a valid request" << std::endl;
+                }
+            }
+            if (input.too_long())
+            {
+                errors << "Line " << record + 1 << " is longer than the input buffer" << std::endl;
+                ++invalid;
+            }
+        }
+
+        out.flush();
+        return invalid == 0 ? 0 : 1;
+    }
+}
+
+
+/// <summary>
+/// Reads the bulk options that follow "--bulk" on the command line:
+/// [--binary | --columnar] [--pipeline [<workers>]] [--in <file>] [--out <file>].
+/// </summary>
+/// <returns>false for anything it does not understand</returns>
+inline bool parse_bulk_options(int argc, char* argv[], int first, BulkOptions& options)
+{
+    for (int i = first; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--binary") == 0)
+        {
+            options.binary = true;
+        }
+        else if (std::strcmp(argv[i], "--columnar") == 0)
+        {
+            options.columnar = true;
+        }
+        else if (std::strcmp(argv[i], "--pipeline") == 0)
+        {
+            options.pipeline = true;
+            if (i + 1 < argc && argv[i + 1][0] >= '0' && argv[i + 1][0] <= '9')
+            {
+                char* end = nullptr;
+                const unsigned long workers = std::strtoul(argv[++i], &end, 10);
+                if (*end != '\0' || workers == 0 || workers > 1024)
+                {
+                    return false;
+                }
+                options.workers = static_cast<unsigned>(workers);
+            }
+        }
+        else if (std::strcmp(argv[i], "--in") == 0 && i + 1 < argc)
+        {
+            options.in_path = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+        {
+            options.out_path = argv[++i];
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return !(options.columnar && (options.binary || options.pipeline));
+}
+
+/// <summary>
+/// Runs every request in the input and writes one result for each, in order.
+/// </summary>
+/// <param name="options">Input, output and format</param>
+/// <param name="errors">Where problems with the input are reported</param>
+/// <returns>0 when every request was valid, 1 otherwise (or when a file cannot be opened)</returns>
+inline int run_bulk(const BulkOptions& options, std::ostream& errors)
+{
+    bulk_detail::BulkFiles files;
+    if (!files.open(options, errors))
+    {
+        return 1;
+    }
+    return bulk_detail::run_records(files, options.binary, errors);
+}
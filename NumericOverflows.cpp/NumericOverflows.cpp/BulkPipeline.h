@@ -0,0 +1,388 @@
+// BulkPipeline.h : --bulk --pipeline, the bulk checks of BulkCheck.h spread over a reader, checkers and a writer.
+//
+// A reader thread cuts the input into batches of whole records (binary) or lines (text), a pool of checker
+// threads runs every batch through the same per-record code run_bulk uses, and the calling thread writes the
+// batches out in input order. The stages hand batches to each other through BoundedQueues, and a fixed set of
+// batches goes round and round: the writer gives every batch it has written back to the reader. Once the
+// batches have grown to fit the input (a text line longer than any before it), nothing is allocated per
+// record or per batch. The output, and what is reported on errors, is byte for byte what run_bulk gives.
+
+#pragma once
+
+#include <algorithm>          // std::max, std::min
+#include <atomic>             // std::atomic_uint
+#include <condition_variable> // std::condition_variable
+#include <cstddef>            // std::size_t
+#include <cstdint>            // std::uint64_t
+#include <cstdio>             // std::FILE
+#include <cstring>            // std::memcpy, std::memchr
+#include <mutex>              // std::mutex, std::unique_lock, std::lock_guard
+#include <ostream>            // std::ostream
+#include <system_error>       // std::system_error
+#include <thread>             // std::thread
+#include <utility>            // std::move
+#include <vector>             // std::vector
+
+#include "BulkCheck.h"
+#include "ReportSink.h"
+
+
+/// <summary>
+/// A fixed-size ring of values shared by any number of producer and consumer threads.
+/// push() waits while the ring is full and pop() while it is empty; close() wakes everyone up for good.
+/// </summary>
+template <typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(std::size_t capacity) : slots_(std::max<std::size_t>(capacity, 1)) {}
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    /// <summary>
+    /// Adds value at the back, once there is room.
+    /// </summary>
+    /// <returns>false (dropping value) when the queue has been closed</returns>
+    bool push(T value)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_full_.wait(lock, [&]() { return size_ < slots_.size() || closed_; });
+        if (closed_)
+        {
+            return false;
+        }
+        slots_[(head_ + size_) % slots_.size()] = std::move(value);
+        ++size_;
+        lock.unlock();
+        not_empty_.notify_one();
+        return true;
+    }
+
+    /// <summary>
+    /// Takes the value at the front, once there is one.
+    /// </summary>
+    /// <returns>false when the queue has been closed and everything in it taken</returns>
+    bool pop(T& value)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_empty_.wait(lock, [&]() { return size_ != 0 || closed_; });
+        if (size_ == 0)
+        {
+            return false;
+        }
+        value = std::move(slots_[head_]);
+        head_ = (head_ + 1) % slots_.size();
+        --size_;
+        lock.unlock();
+        not_full_.notify_one();
+        return true;
+    }
+
+    /// <summary>
+    /// Refuses any further push(); pop() still hands out what is left.
+    /// </summary>
+    void close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+        }
+        not_full_.notify_all();
+        not_empty_.notify_all();
+    }
+
+private:
+    std::vector<T> slots_;
+    std::size_t head_{ 0 };
+    std::size_t size_{ 0 };
+    bool closed_{ false };
+    std::mutex mutex_;
+    std::condition_variable not_full_;
+    std::condition_variable not_empty_;
+};
+
+
+namespace bulk_pipeline_detail
+{
+    // Records (or text lines) in one batch.
+    constexpr std::size_t batch_records = 4096;
+
+    // Bytes of text a batch starts out with room for; a batch grows when one line alone needs more.
+    constexpr std::size_t batch_text_bytes = 256 * 1024;
+
+    /// <summary>
+    /// Some consecutive records of the input and, once checked, their results.
+    /// </summary>
+    struct Batch
+    {
+        std::uint64_t sequence{ 0 };      // how many batches came before this one
+        std::uint64_t first_record{ 0 };  // the record (line) number of the first record, counting from 1
+        std::size_t records{ 0 };
+        std::vector<char> input;          // binary records back to back, or text lines each ending in '\n'
+        std::size_t input_size{ 0 };
+        std::vector<char> output;
+        std::size_t output_size{ 0 };
+        std::uint64_t invalid{ 0 };
+        std::uint64_t first_invalid{ 0 }; // the record number of the first invalid record, when invalid != 0
+    };
+
+    /// <summary>
+    /// Sizes a batch for binary records or text lines, once, before it first goes round.
+    /// </summary>
+    inline void prepare(Batch& batch, bool binary)
+    {
+        batch.input.resize(binary ? batch_records * bulk_input_record_size : batch_text_bytes);
+        batch.output.resize(batch_records * (binary ? bulk_output_record_size : bulk_detail::text_line_capacity));
+    }
+
+    /// <summary>
+    /// The checker stage: runs every record of batch, the way run_records does.
+    /// </summary>
+    inline void check(Batch& batch, bool binary)
+    {
+        batch.output_size = 0;
+        batch.invalid = 0;
+        if (binary)
+        {
+            const unsigned char* const input = reinterpret_cast<const unsigned char*>(batch.input.data());
+            unsigned char* const output = reinterpret_cast<unsigned char*>(batch.output.data());
+            for (std::size_t i = 0; i < batch.records; ++i)
+            {
+                if (!bulk_detail::process_binary_record(input + i * bulk_input_record_size, output + i * bulk_output_record_size))
+                {
+                    ++batch.invalid;
+                }
+            }
+            batch.output_size = batch.records * bulk_output_record_size;
+            return;
+        }
+
+        const char* first = batch.input.data();
+        char* out = batch.output.data();
+        for (std::size_t i = 0; i < batch.records; ++i)
+        {
+            const char* const last = static_cast<const char*>(std::memchr(first, '\n', batch.input.data() + batch.input_size - first));
+            bool valid = true;
+            out = bulk_detail::process_text_line(first, last, out, valid);
+            if (!valid && batch.invalid++ == 0)
+            {
+                batch.first_invalid = batch.first_record + i;
+            }
+            first = last + 1;
+        }
+        batch.output_size = static_cast<std::size_t>(out - batch.output.data());
+    }
+
+    /// <summary>
+    /// What the reader stage found wrong with the input as a whole, for the calling thread to report.
+    /// </summary>
+    struct ReadSummary
+    {
+        std::uint64_t records{ 0 };
+        bool truncated{ false };  // binary input that ends in the middle of a record
+        bool too_long{ false };   // a text line that does not fit in ChunkedInput's buffer
+    };
+
+    /// <summary>
+    /// The reader stage: fills batches from recycled and hands them on to filled, then closes filled.
+    /// </summary>
+    inline void read(std::FILE* in, bool binary, BoundedQueue<Batch*>& recycled, BoundedQueue<Batch*>& filled, ReadSummary& summary)
+    {
+        bulk_detail::ChunkedInput input(in);
+        std::uint64_t sequence = 0;
+        Batch* batch = nullptr;
+
+        auto hand_on = [&]()
+        {
+            if (batch != nullptr && batch->records != 0)
+            {
+                filled.push(batch);
+                batch = nullptr;
+            }
+        };
+        auto start = [&]()
+        {
+            if (batch == nullptr && recycled.pop(batch))
+            {
+                batch->sequence = sequence++;
+                batch->first_record = summary.records + 1;
+                batch->records = 0;
+                batch->input_size = 0;
+            }
+            return batch != nullptr;
+        };
+
+        if (binary)
+        {
+            std::size_t available = 0;
+            while ((available = input.require(bulk_input_record_size)) >= bulk_input_record_size && start())
+            {
+                const std::size_t count = std::min(available / bulk_input_record_size, batch_records - batch->records);
+                std::memcpy(batch->input.data() + batch->input_size, input.data(), count * bulk_input_record_size);
+                input.consume(count * bulk_input_record_size);
+                batch->input_size += count * bulk_input_record_size;
+                batch->records += count;
+                summary.records += count;
+                if (batch->records == batch_records)
+                {
+                    hand_on();
+                }
+            }
+            summary.truncated = input.require(1) != 0;
+        }
+        else
+        {
+            const char* first = nullptr;
+            const char* last = nullptr;
+            while (input.next_line(first, last) && start())
+            {
+                const std::size_t size = static_cast<std::size_t>(last - first);
+                if (batch->input.size() - batch->input_size <= size)
+                {
+                    hand_on();
+                    if (!start())
+                    {
+                        break;
+                    }
+                    if (batch->input.size() <= size)
+                    {
+                        batch->input.resize(size + 1);
+                    }
+                }
+                std::memcpy(batch->input.data() + batch->input_size, first, size);
+                batch->input[batch->input_size + size] = '\n';
+                batch->input_size += size + 1;
+                ++batch->records;
+                ++summary.records;
+                if (batch->records == batch_records)
+                {
+                    hand_on();
+                }
+            }
+            summary.too_long = input.too_long();
+        }
+
+        hand_on();
+        filled.close();
+    }
+}
+
+
+/// <summary>
+/// run_bulk on a pipeline of threads (see the top of this file): one reader, options.workers checkers
+/// (0 = one per core, less one) and the calling thread as the writer. Falls back to run_bulk's single
+/// loop when the threads cannot be started.
+/// </summary>
+/// <returns>0 when every request was valid, 1 otherwise (or when a file cannot be opened)</returns>
+inline int run_bulk_pipeline(const BulkOptions& options, std::ostream& errors)
+{
+    using namespace bulk_pipeline_detail;
+
+    bulk_detail::BulkFiles files;
+    if (!files.open(options, errors))
+    {
+        return 1;
+    }
+
+    const unsigned workers = options.workers != 0 ? options.workers : std::max(2u, std::thread::hardware_concurrency()) - 1;
+    // Enough batches for every checker to have one in hand and one waiting, plus one each for the reader and the writer.
+    const std::size_t batch_count = 2 * static_cast<std::size_t>(workers) + 2;
+
+    std::vector<Batch> batches(batch_count);
+    BoundedQueue<Batch*> recycled(batch_count);
+    BoundedQueue<Batch*> filled(batch_count);
+    BoundedQueue<Batch*> checked(batch_count);
+    for (Batch& batch : batches)
+    {
+        prepare(batch, options.binary);
+        recycled.push(&batch);
+    }
+
+    std::atomic_uint running{ 0 };
+    auto checker = [&]()
+    {
+        Batch* batch = nullptr;
+        while (filled.pop(batch))
+        {
+            check(*batch, options.binary);
+            checked.push(batch);
+        }
+        // The last checker out tells the writer there is nothing more to come.
+        if (--running == 0)
+        {
+            checked.close();
+        }
+    };
+
+    ReadSummary summary;
+    std::vector<std::thread> pool;
+    std::thread reader;
+    try
+    {
+        pool.reserve(workers);
+        for (unsigned t = 0; t < workers; ++t)
+        {
+            ++running;
+            pool.emplace_back(checker);
+        }
+        reader = std::thread([&]() { read(files.in(), options.binary, recycled, filled, summary); });
+    }
+    catch (const std::system_error&)
+    {
+        // Out of threads before the reader started, so nothing has been read and the single loop can do it all.
+        if (pool.size() < workers)
+        {
+            --running;
+        }
+        filled.close();
+        for (std::thread& thread : pool)
+        {
+            thread.join();
+        }
+        return bulk_detail::run_records(files, options.binary, errors);
+    }
+
+    // The writer stage: batches come out of the checkers in any order and go out in input order.
+    // At most batch_count are about, so the one due next is always within batch_count of the last written.
+    ReportSink out(files.out(), 1024 * 1024);
+    std::vector<Batch*> pending(batch_count, nullptr);
+    std::uint64_t next = 0;
+    std::uint64_t invalid = 0;
+    Batch* batch = nullptr;
+    while (checked.pop(batch))
+    {
+        pending[batch->sequence % batch_count] = batch;
+        while ((batch = pending[next % batch_count]) != nullptr)
+        {
+            pending[next++ % batch_count] = nullptr;
+            out.write(batch->output.data(), batch->output_size);
+            if (!options.binary && batch->invalid != 0 && invalid == 0)
+            {
+                errors << "Line " << batch->first_invalid << " is not a valid request" << std::endl;
+            }
+            invalid += batch->invalid;
+            recycled.push(batch);
+        }
+    }
+
+    reader.join();
+    for (std::thread& thread : pool)
+    {
+        thread.join();
+    }
+
+    if (summary.truncated)
+    {
+        errors << "The input ends in the middle of a record" << std::endl;
+        ++invalid;
+    }
+    if (summary.too_long)
+    {
+        errors << "Line " << summary.records + 1 << " is longer than the input buffer" << std::endl;
+        ++invalid;
+    }
+
+    out.flush();
+    return invalid == 0 ? 0 : 1;
+}
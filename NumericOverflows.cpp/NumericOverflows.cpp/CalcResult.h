@@ -0,0 +1,23 @@
+// CalcResult.h : CalcResult<T>, what every overflow-safe operation returns, and step_count_t.
+
+#pragma once
+
+#include <cstdint>      // std::uint64_t
+
+// The type of every step count. unsigned long is only 32 bits on Windows, so it is spelled out as 64 bits.
+using step_count_t = std::uint64_t;
+
+// We need a clean way to send two things back to the test code:
+//  1) the number we ended up with, and
+//  2) whether the operation finished safely.
+// This avoids using "special" return values like -1, which can be a real value or behave
+// differently for unsigned types, chars, and floating-point numbers.
+template <typename T>
+struct CalcResult
+{
+    T value{};            // The result (or the last safe value if we had to stop early)
+    bool success{ true }; // true = all steps completed safely, false = we prevented overflow/underflow
+    step_count_t failed_at_step{ 0 }; // 0-based index of the step we refused (= steps completed); 0 on success
+    bool precision_lost{ false }; // true = (floating point) the increment became too small to change the value,
+                                  // so the remaining steps were skipped; value and success are unaffected
+};
@@ -0,0 +1,178 @@
+// CalcResultBlock.h : Structure-of-arrays storage for many CalcResult<T> values.
+//
+// An array of CalcResult<T> pays padding for every bool (CalcResult<char> doubles in size, CalcResult<long double>
+// carries 16 bytes of data in 32). CalcResultBlock<T> keeps the values in one contiguous array and the success
+// flags in a packed bitmask, the same layout the batch kernels in NumericBatch.h write.
+
+#pragma once
+
+#include <cstddef>      // std::size_t, std::ptrdiff_t
+#include <cstdint>      // std::uint64_t
+#include <iterator>     // std::random_access_iterator_tag
+#include <vector>       // std::vector
+
+#include "NumericFunctions.h"
+
+
+/// <summary>
+/// Number of 64-bit words needed for the success bitmask of a batch of count lanes.
+/// </summary>
+constexpr std::size_t batch_mask_words(std::size_t count)
+{
+    return (count + 63) / 64;
+}
+
+/// <summary>
+/// Reads the success flag of lane i from a batch bitmask.
+/// </summary>
+inline bool batch_mask_test(const std::uint64_t* success_mask, std::size_t i)
+{
+    return ((success_mask[i / 64] >> (i % 64)) & 1u) != 0;
+}
+
+
+/// <summary>
+/// One result read back from a CalcResultBlock: the value and the success flag, the two fields the block stores.
+/// It is not a CalcResult<T>, so code that reads failed_at_step or precision_lost from a block stops compiling
+/// instead of reading 0 / false for a lane that failed.
+/// </summary>
+template <typename T>
+struct BlockResult
+{
+    T value{};
+    bool success{ true };
+};
+
+
+/// <summary>
+/// A block of results stored as a value column plus a success bitset.
+/// Reading an element (operator[] or an iterator) gives back a BlockResult<T> by value.
+/// New lanes start out like CalcResult<T>{}: value T{} and success true.
+/// </summary>
+/// <typeparam name="T">The value type of the results</typeparam>
+template <typename T>
+class CalcResultBlock
+{
+public:
+    class const_iterator
+    {
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = BlockResult<T>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = BlockResult<T>; // results are assembled on the fly, so they come back by value
+
+        const_iterator() = default;
+        const_iterator(const CalcResultBlock* block, std::size_t index) : block_(block), index_(index) {}
+
+        reference operator*() const { return (*block_)[index_]; }
+        reference operator[](difference_type n) const { return (*block_)[index_ + n]; }
+
+        const_iterator& operator++() { ++index_; return *this; }
+        const_iterator operator++(int) { const_iterator old = *this; ++index_; return old; }
+        const_iterator& operator--() { --index_; return *this; }
+        const_iterator operator--(int) { const_iterator old = *this; --index_; return old; }
+        const_iterator& operator+=(difference_type n) { index_ += n; return *this; }
+        const_iterator& operator-=(difference_type n) { index_ -= n; return *this; }
+
+        friend const_iterator operator+(const_iterator it, difference_type n) { return it += n; }
+        friend const_iterator operator+(difference_type n, const_iterator it) { return it += n; }
+        friend const_iterator operator-(const_iterator it, difference_type n) { return it -= n; }
+        friend difference_type operator-(const const_iterator& a, const const_iterator& b)
+        {
+            return static_cast<difference_type>(a.index_) - static_cast<difference_type>(b.index_);
+        }
+
+        friend bool operator==(const const_iterator& a, const const_iterator& b) { return a.index_ == b.index_; }
+        friend bool operator!=(const const_iterator& a, const const_iterator& b) { return a.index_ != b.index_; }
+        friend bool operator<(const const_iterator& a, const const_iterator& b) { return a.index_ < b.index_; }
+        friend bool operator>(const const_iterator& a, const const_iterator& b) { return a.index_ > b.index_; }
+        friend bool operator<=(const const_iterator& a, const const_iterator& b) { return a.index_ <= b.index_; }
+        friend bool operator>=(const const_iterator& a, const const_iterator& b) { return a.index_ >= b.index_; }
+
+    private:
+        const CalcResultBlock* block_{ nullptr };
+        std::size_t index_{ 0 };
+    };
+
+    using iterator = const_iterator;
+
+    CalcResultBlock() = default;
+    explicit CalcResultBlock(std::size_t count) { resize(count); }
+
+    /// <summary>
+    /// Resizes the block to count results. Existing capacity is reused, so a block can be
+    /// handed to the batch functions over and over without reallocating. Lanes added by growing
+    /// read back as value T{} and success true, whatever a lane at that index held before a shrink.
+    /// </summary>
+    void resize(std::size_t count)
+    {
+        const std::size_t old_count = values_.size();
+        values_.resize(count);
+        mask_.resize(batch_mask_words(count));
+        for (std::size_t i = old_count; i < count;)
+        {
+            const std::size_t bit = i % 64;
+            const std::size_t lanes = count - i < 64 - bit ? count - i : 64 - bit;
+            const std::uint64_t ones = lanes == 64 ? ~std::uint64_t{ 0 } : (std::uint64_t{ 1 } << lanes) - 1;
+            mask_[i / 64] |= ones << bit;
+            i += lanes;
+        }
+    }
+
+    std::size_t size() const { return values_.size(); }
+    bool empty() const { return values_.empty(); }
+
+    // Raw columns, in the layout the batch kernels read and write.
+    T* values() { return values_.data(); }
+    const T* values() const { return values_.data(); }
+    std::uint64_t* success_mask() { return mask_.data(); }
+    const std::uint64_t* success_mask() const { return mask_.data(); }
+
+    bool success(std::size_t i) const { return batch_mask_test(mask_.data(), i); }
+
+    BlockResult<T> operator[](std::size_t i) const
+    {
+        return BlockResult<T>{ values_[i], success(i) };
+    }
+
+    /// <summary>
+    /// Stores one result (its failed_at_step and precision_lost are not kept).
+    /// </summary>
+    void set(std::size_t i, const CalcResult<T>& result)
+    {
+        values_[i] = result.value;
+        const std::uint64_t bit = std::uint64_t{ 1 } << (i % 64);
+        mask_[i / 64] = result.success ? (mask_[i / 64] | bit) : (mask_[i / 64] & ~bit);
+    }
+
+    /// <summary>
+    /// true when every result in the block completed safely.
+    /// </summary>
+    bool all_succeeded() const
+    {
+        const std::size_t full_words = size() / 64;
+        for (std::size_t w = 0; w < full_words; ++w)
+        {
+            if (mask_[w] != ~std::uint64_t{ 0 })
+            {
+                return false;
+            }
+        }
+
+        // Bits past size() may be left over from a larger block, so only the live ones are compared.
+        const std::size_t tail = size() % 64;
+        const std::uint64_t live = (std::uint64_t{ 1 } << tail) - 1;
+        return tail == 0 || (mask_[full_words] & live) == live;
+    }
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, size()); }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const { return end(); }
+
+private:
+    std::vector<T> values_;
+    std::vector<std::uint64_t> mask_;
+};
@@ -0,0 +1,251 @@
+// CheckedAccumulate.h : Overflow-checked sums of whole ranges, the range counterpart of add_numbers.
+//
+// checked_accumulate(first, last, init) adds every element to init, left to right, and stops before the first
+// element that would take the running total outside the range of T, like add_numbers_stepwise does per step.
+// Integer ranges with random access are summed a chunk at a time in the wider accumulator from
+// accumulator_traits (OverflowTraits.h): four unrolled 64-bit lanes add up the positive and the negative elements
+// separately, which bounds every running total inside the chunk, so one compare per chunk proves it safe.
+// Only a chunk that might leave the range is walked again element by element to find where it stops.
+// Floating point ranges (every add rounds) and types without a wider accumulator are walked element by element.
+
+#pragma once
+
+#include <cstddef>      // std::size_t, std::ptrdiff_t
+#include <cstdint>      // std::uint64_t
+#include <iterator>     // std::iterator_traits, std::random_access_iterator_tag, std::begin, std::end
+#include <limits>       // std::numeric_limits
+#include <type_traits>  // std::is_integral, std::is_signed, std::is_same, std::is_base_of, std::decay_t
+#include <utility>      // std::declval
+
+#include "DeferredChecks.h"
+#include "NumericFunctions.h"
+
+
+namespace accumulate_detail
+{
+    // Elements summed per chunk. Small enough that a failing chunk is cheap to walk again, and
+    // 2^10 elements below 2^53 in size never overflow a 64-bit lane.
+    constexpr std::size_t chunk_elements = 1024;
+    constexpr int lane_magnitude_bits = 53;
+
+    template <typename T>
+    constexpr bool use_wide_chunks = std::is_integral<T>::value && accumulator_traits<T>::wider && accumulator_traits<T>::exact;
+
+    /// <summary>
+    /// Stops the build when It does not iterate over values of type T. Every checked_accumulate overload calls this.
+    /// </summary>
+    template <typename It, typename T>
+    constexpr void require_elements_of()
+    {
+        static_assert(std::is_same<std::decay_t<decltype(*std::declval<It&>())>, T>::value,
+            "checked_accumulate adds elements of type T; convert them first rather than let them narrow silently");
+    }
+
+    /// <summary>
+    /// Adds elements to total one at a time with the same check add_numbers_stepwise makes before every add.
+    /// index counts the elements added; on failure it is the index of the element that was refused.
+    /// </summary>
+    template <typename T, typename It>
+    constexpr bool exact_walk(It first, It last, T& total, step_count_t& index)
+    {
+        const T maxVal = std::numeric_limits<T>::max();
+        const T lowVal = std::numeric_limits<T>::lowest();
+
+        for (; first != last; ++first, ++index)
+        {
+            const T x = *first;
+            if (x > T{ 0 } ? total > maxVal - x : x < T{ 0 } && total < lowVal - x)
+            {
+                return false;
+            }
+            total = static_cast<T>(total + x);
+        }
+        return true;
+    }
+
+    /// <summary>
+    /// exact_walk in the accumulator type W, which holds every total of T plus one more element.
+    /// </summary>
+    template <typename T, typename W, typename It>
+    constexpr bool exact_walk_wide(It first, It last, W& total, step_count_t& index)
+    {
+        const W maxVal = static_cast<W>(std::numeric_limits<T>::max());
+        const W lowVal = static_cast<W>(std::numeric_limits<T>::lowest());
+
+        for (; first != last; ++first, ++index)
+        {
+            const W next = total + static_cast<W>(*first);
+            if (next > maxVal || next < lowVal)
+            {
+                return false;
+            }
+            total = next;
+        }
+        return true;
+    }
+
+    /// <summary>
+    /// Sums the magnitudes of the positive (up) and the negative (down) elements of first[0, n) in
+    /// four unrolled 64-bit lanes: every running total over the block then lies in [start - down, start + up].
+    /// n is at most chunk_elements.
+    /// </summary>
+    /// <returns>false when an element was too big for the lanes to stay exact (up and down are then meaningless)</returns>
+    template <typename T, typename It>
+    constexpr bool block_bounds(It first, std::size_t n, std::uint64_t& up, std::uint64_t& down)
+    {
+        // Unsigned lanes wrap instead of overflowing; bits records whether any element was too big for them.
+        std::uint64_t up0 = 0, up1 = 0, up2 = 0, up3 = 0;
+        std::uint64_t down0 = 0, down1 = 0, down2 = 0, down3 = 0;
+        std::uint64_t bits = 0;
+        const auto lane = [&bits](T x, std::uint64_t& lane_up, std::uint64_t& lane_down)
+        {
+            const std::uint64_t ux = static_cast<std::uint64_t>(x);
+            if constexpr (std::is_signed<T>::value)
+            {
+                const std::uint64_t magnitude = x < 0 ? std::uint64_t{ 0 } - ux : ux;
+                lane_up += x > 0 ? magnitude : 0;
+                lane_down += x < 0 ? magnitude : 0;
+                bits |= magnitude;
+            }
+            else
+            {
+                lane_up += ux;
+                bits |= ux;
+                (void)lane_down;
+            }
+        };
+        std::size_t i = 0;
+        for (; i + 4 <= n; i += 4)
+        {
+            lane(first[i], up0, down0);
+            lane(first[i + 1], up1, down1);
+            lane(first[i + 2], up2, down2);
+            lane(first[i + 3], up3, down3);
+        }
+        for (; i < n; ++i)
+        {
+            lane(first[i], up0, down0);
+        }
+
+        up = (up0 + up1) + (up2 + up3);
+        down = (down0 + down1) + (down2 + down3);
+        // Elements of 32 bits or less always fit; 64-bit ones are checked against lane_magnitude_bits.
+        return sizeof(T) <= 4 || (bits >> lane_magnitude_bits) == 0;
+    }
+
+    /// <summary>
+    /// The chunked sum for integer ranges with random access (see the top of this file).
+    /// </summary>
+    template <typename T, typename It>
+    constexpr CalcResult<T> chunked_accumulate(It first, It last, T init)
+    {
+        using W = typename accumulator_traits<T>::type;
+        const W maxVal = static_cast<W>(std::numeric_limits<T>::max());
+        const W lowVal = static_cast<W>(std::numeric_limits<T>::lowest());
+
+        W total = static_cast<W>(init);
+        step_count_t index = 0;
+        while (first != last)
+        {
+            const std::size_t remaining = static_cast<std::size_t>(last - first);
+            const std::size_t n = remaining < chunk_elements ? remaining : chunk_elements;
+
+            std::uint64_t up = 0;
+            std::uint64_t down = 0;
+            const bool lanes_exact = block_bounds<T>(first, n, up, down);
+            if (lanes_exact && total + static_cast<W>(up) <= maxVal && total - static_cast<W>(down) >= lowVal)
+            {
+                total += static_cast<W>(up) - static_cast<W>(down);
+                index += n;
+            }
+            else if (!exact_walk_wide<T>(first, first + static_cast<std::ptrdiff_t>(n), total, index))
+            {
+                CalcResult<T> out{};
+                out.value = static_cast<T>(total);
+                out.success = false;
+                out.failed_at_step = index;
+                return out;
+            }
+            first += static_cast<std::ptrdiff_t>(n);
+        }
+
+        CalcResult<T> out{};
+        out.value = static_cast<T>(total);
+        return out;
+    }
+}
+
+
+/// <summary>
+/// Adds up [first, last) starting from init, checking T's limits like add_numbers:
+///   init + first[0] + first[1] + ... + first[n - 1]
+/// </summary>
+/// <typeparam name="InputIt">An input iterator over values of type T</typeparam>
+/// <typeparam name="T">A type that with basic math functions</typeparam>
+/// <param name="first">The first element to add</param>
+/// <param name="last">One past the last element to add</param>
+/// <param name="init">The number to start with</param>
+/// <returns>The sum with success = true, or the last safe total with success = false and
+/// failed_at_step = the index (from first) of the element that would have overflowed</returns>
+template <typename InputIt, typename T>
+constexpr CalcResult<T> checked_accumulate(InputIt first, InputIt last, T init)
+{
+    accumulate_detail::require_elements_of<InputIt, T>();
+
+    using category = typename std::iterator_traits<InputIt>::iterator_category;
+    if constexpr (accumulate_detail::use_wide_chunks<T> && std::is_base_of<std::random_access_iterator_tag, category>::value)
+    {
+        return accumulate_detail::chunked_accumulate<T>(first, last, init);
+    }
+    else
+    {
+        CalcResult<T> out{};
+        out.value = init;
+        step_count_t index = 0;
+        if (!accumulate_detail::exact_walk(first, last, out.value, index))
+        {
+            out.success = false;
+            out.failed_at_step = index;
+        }
+        return out;
+    }
+}
+
+/// <summary>
+/// checked_accumulate starting from zero.
+/// </summary>
+template <typename InputIt>
+constexpr CalcResult<std::decay_t<decltype(*std::declval<InputIt>())>> checked_accumulate(InputIt first, InputIt last)
+{
+    using T = std::decay_t<decltype(*first)>;
+    return checked_accumulate(first, last, T{ 0 });
+}
+
+
+namespace accumulate_detail
+{
+    constexpr int example_ints[] = { 40, -2, 5, 1 };
+    constexpr int example_falling_ints[] = { -1, -2, -1 };
+    constexpr unsigned char example_bytes[] = { 200, 50, 10 };
+    constexpr double example_doubles[] = { 1e308, 1e308, -1e308 };
+}
+
+static_assert(checked_accumulate(std::begin(accumulate_detail::example_ints), std::end(accumulate_detail::example_ints)).value == 44
+    && checked_accumulate(std::begin(accumulate_detail::example_ints), std::end(accumulate_detail::example_ints)).success,
+    "checked_accumulate adds up the whole range");
+static_assert(!checked_accumulate(std::begin(accumulate_detail::example_ints), std::end(accumulate_detail::example_ints), std::numeric_limits<int>::max() - 43).success
+    && checked_accumulate(std::begin(accumulate_detail::example_ints), std::end(accumulate_detail::example_ints), std::numeric_limits<int>::max() - 43).value == std::numeric_limits<int>::max()
+    && checked_accumulate(std::begin(accumulate_detail::example_ints), std::end(accumulate_detail::example_ints), std::numeric_limits<int>::max() - 43).failed_at_step == 3,
+    "checked_accumulate stops on the last safe total, before the element that overflows");
+static_assert(!checked_accumulate(std::begin(accumulate_detail::example_falling_ints), std::end(accumulate_detail::example_falling_ints), std::numeric_limits<int>::lowest() + 3).success
+    && checked_accumulate(std::begin(accumulate_detail::example_falling_ints), std::end(accumulate_detail::example_falling_ints), std::numeric_limits<int>::lowest() + 3).value == std::numeric_limits<int>::lowest()
+    && checked_accumulate(std::begin(accumulate_detail::example_falling_ints), std::end(accumulate_detail::example_falling_ints), std::numeric_limits<int>::lowest() + 3).failed_at_step == 2,
+    "underflow stops the same way");
+static_assert(!checked_accumulate(std::begin(accumulate_detail::example_bytes), std::end(accumulate_detail::example_bytes)).success
+    && checked_accumulate(std::begin(accumulate_detail::example_bytes), std::end(accumulate_detail::example_bytes)).value == 250
+    && checked_accumulate(std::begin(accumulate_detail::example_bytes), std::end(accumulate_detail::example_bytes)).failed_at_step == 2,
+    "small integers are checked against their own limits, not int's");
+static_assert(!checked_accumulate(std::begin(accumulate_detail::example_doubles), std::end(accumulate_detail::example_doubles)).success
+    && checked_accumulate(std::begin(accumulate_detail::example_doubles), std::end(accumulate_detail::example_doubles)).value == 1e308
+    && checked_accumulate(std::begin(accumulate_detail::example_doubles), std::end(accumulate_detail::example_doubles)).failed_at_step == 1,
+    "floating point stops before the first element that overflows, even if a later one would bring it back");
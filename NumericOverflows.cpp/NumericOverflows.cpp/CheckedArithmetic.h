@@ -0,0 +1,153 @@
+// CheckedArithmetic.h : Interchangeable backends for the one checked multiply the closed-form engine needs.
+//
+// add_numbers / subtract_numbers take a Backend template parameter. Each backend answers the same question:
+// does magnitude * steps fit in the room left before the limit, and if so what is the product?
+//   portable_backend  - plain C++ compare-before-multiply (one division), works everywhere
+//   intrinsic_backend - single-instruction overflow detection from the compiler
+//   wide_backend      - multiply in a type twice as wide, then one compare
+// default_backend is the intrinsic backend wherever the toolchain has the intrinsics, otherwise portable.
+// Every backend is constexpr; during constant evaluation the intrinsic paths step aside for the portable math.
+
+#pragma once
+
+#include <cstdint>      // std::uint64_t
+#include <limits>       // std::numeric_limits
+#include <type_traits>  // std::is_constant_evaluated (C++20)
+
+#if defined(_MSC_VER) && !defined(__clang__) && defined(_M_X64)
+#include <intrin.h>     // _umul128, _subborrow_u64
+#define NUMERIC_MSVC_X64_INTRINSICS 1
+#endif
+
+#if defined(__GNUC__) || defined(__clang__) || defined(NUMERIC_MSVC_X64_INTRINSICS)
+#define NUMERIC_HAS_OVERFLOW_INTRINSICS 1
+#endif
+
+// true while the compiler is evaluating a constant expression, where intrinsics cannot be used.
+#if defined(__cpp_lib_is_constant_evaluated)
+#define NUMERIC_IS_CONSTANT_EVALUATED() std::is_constant_evaluated()
+#elif defined(__GNUC__) || defined(__clang__) || (defined(_MSC_VER) && _MSC_VER >= 1925)
+#define NUMERIC_IS_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#else
+#define NUMERIC_IS_CONSTANT_EVALUATED() false
+#endif
+
+
+/// <summary>
+/// Compare-before-multiply checks written in plain C++. Works on every compiler.
+/// </summary>
+struct portable_backend
+{
+    /// <summary>
+    /// Works out magnitude * steps and whether it fits within room.
+    /// </summary>
+    /// <param name="magnitude">The size of one step, never 0</param>
+    /// <param name="steps">The number of steps</param>
+    /// <param name="room">How far the value may move before leaving its range</param>
+    /// <param name="total">Receives the product when it fits</param>
+    /// <returns>true when the whole walk fits in room</returns>
+    template <typename U>
+    static constexpr bool walk_fits(U magnitude, std::uint64_t steps, U room, U& total)
+    {
+        if (steps > std::numeric_limits<U>::max())
+        {
+            return false; // magnitude is at least 1, so the product cannot fit in U, let alone in room
+        }
+
+        const U count = static_cast<U>(steps);
+        if (count != 0 && magnitude > std::numeric_limits<U>::max() / count)
+        {
+            return false;
+        }
+
+        total = static_cast<U>(magnitude * count);
+        return total <= room;
+    }
+};
+
+
+/// <summary>
+/// Uses the compiler's overflow-detecting multiply (__builtin_mul_overflow on GCC/Clang,
+/// _umul128 plus _subborrow_u64 on MSVC x64). Falls back to portable_backend elsewhere.
+/// </summary>
+struct intrinsic_backend
+{
+    template <typename U>
+    static constexpr bool walk_fits(U magnitude, std::uint64_t steps, U room, U& total)
+    {
+        if (NUMERIC_IS_CONSTANT_EVALUATED())
+        {
+            return portable_backend::walk_fits(magnitude, steps, room, total);
+        }
+
+#if defined(__GNUC__) || defined(__clang__)
+        // Product is checked against U in infinite precision; the compare against room is a single cmp.
+        const bool overflowed = __builtin_mul_overflow(magnitude, steps, &total);
+        return !overflowed & (total <= room);
+#elif defined(NUMERIC_MSVC_X64_INTRINSICS)
+        // 64 x 64 -> 128-bit multiply: the high half tells us about overflow, and the borrow out of
+        // room - low tells us whether the product fits in the room left.
+        unsigned long long high = 0;
+        const unsigned long long low = _umul128(magnitude, steps, &high);
+        unsigned long long left = 0;
+        const unsigned char borrow = _subborrow_u64(0, room, low, &left);
+        total = static_cast<U>(low);
+        return (high == 0) & (borrow == 0);
+#else
+        return portable_backend::walk_fits(magnitude, steps, room, total);
+#endif
+    }
+};
+
+
+/// <summary>
+/// Multiplies in a type twice as wide as U so the product can never wrap, then does one compare.
+/// 64-bit values need unsigned __int128 or _umul128; without them this uses portable_backend.
+/// </summary>
+struct wide_backend
+{
+    template <typename U>
+    static constexpr bool walk_fits(U magnitude, std::uint64_t steps, U room, U& total)
+    {
+        // magnitude is at least 1, so more steps than room can never fit. Past this point
+        // steps fits in U and the double-width product cannot overflow.
+        if (steps > room)
+        {
+            return false;
+        }
+
+        if constexpr (sizeof(U) <= 4)
+        {
+            const std::uint64_t product = static_cast<std::uint64_t>(magnitude) * static_cast<std::uint64_t>(steps);
+            total = static_cast<U>(product);
+            return product <= room;
+        }
+        else
+        {
+#if defined(__SIZEOF_INT128__)
+            const unsigned __int128 product = static_cast<unsigned __int128>(magnitude) * steps;
+            total = static_cast<U>(product);
+            return product <= room;
+#elif defined(NUMERIC_MSVC_X64_INTRINSICS)
+            if (NUMERIC_IS_CONSTANT_EVALUATED())
+            {
+                return portable_backend::walk_fits(magnitude, steps, room, total);
+            }
+
+            unsigned long long high = 0;
+            const unsigned long long low = _umul128(magnitude, steps, &high);
+            total = static_cast<U>(low);
+            return (high == 0) & (low <= room);
+#else
+            return portable_backend::walk_fits(magnitude, steps, room, total);
+#endif
+        }
+    }
+};
+
+
+#if defined(NUMERIC_HAS_OVERFLOW_INTRINSICS)
+using default_backend = intrinsic_backend;
+#else
+using default_backend = portable_backend;
+#endif
@@ -0,0 +1,312 @@
+// CheckedExpression.h : Checked<T>, values whose sums and step products are checked once for the whole expression.
+//
+// With a, b and c Checked<T> and k an unsigned step count, a + b * k - c works nothing out yet: it builds a small
+// expression tree, held by value so it can be kept in an auto. evaluate() adds the terms up in the wider
+// accumulator overflow_traits gives T (OverflowTraits.h), keeping one sticky overflow flag instead of a
+// CalcResult per term, and checks T's range once at the end. Only the final value has to fit, so
+// max() + 1 - 1 succeeds where chained add_numbers calls would stop at the + 1.
+// A failed expression is walked again as the chain of add_numbers / subtract_numbers calls it stands for
+// (0 + a, then + b * k, then - c) and reports like they do: the last safe value, failed_at_step within the term
+// that left the range, and failed_term, the position of that term in the expression counting from 0.
+// Types whose accumulator is not exact (floating point, and 64-bit integers where there is no __int128) are
+// always evaluated as that chain, so their results match add_numbers bit for bit.
+
+#pragma once
+
+#include <cstddef>      // std::size_t
+#include <limits>       // std::numeric_limits
+#include <type_traits>  // std::enable_if_t, std::is_unsigned, std::make_unsigned_t, std::void_t
+#include <utility>      // std::declval
+
+#include "NumericFunctions.h"
+
+
+/// <summary>
+/// What evaluating a Checked<T> expression gives: a CalcResult<T>, plus which term failed.
+/// </summary>
+template <typename T>
+struct CheckedResult : CalcResult<T>
+{
+    std::size_t failed_term{ 0 }; // 0-based position in the expression of the term that left the range; 0 on success
+};
+
+
+namespace checked_detail
+{
+    /// <summary>
+    /// amount * steps in the accumulator W (a signed integer type).
+    /// </summary>
+    /// <returns>false when the product does not fit in W</returns>
+    template <typename W>
+    constexpr bool multiply(W amount, step_count_t steps, W& product)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        return !__builtin_mul_overflow(amount, steps, &product);
+#else
+        using U = std::make_unsigned_t<W>;
+        if (amount == 0 || steps == 0)
+        {
+            product = 0;
+            return true;
+        }
+        // The magnitude of a negative product may be one more than max().
+        const U magnitude = amount < 0 ? U{ 0 } - static_cast<U>(amount) : static_cast<U>(amount);
+        const U limit = static_cast<U>(std::numeric_limits<W>::max()) + (amount < 0 ? 1 : 0);
+        if (steps > limit / magnitude)
+        {
+            return false;
+        }
+        const U total = magnitude * static_cast<U>(steps);
+        product = amount < 0 ? static_cast<W>(U{ 0 } - total) : static_cast<W>(total);
+        return true;
+#endif
+    }
+
+    /// <summary>
+    /// total + amount (total - amount when subtract) in the accumulator W (a signed integer type).
+    /// </summary>
+    /// <returns>false when the sum does not fit in W</returns>
+    template <typename W>
+    constexpr bool accumulate(W& total, W amount, bool subtract)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        return subtract ? !__builtin_sub_overflow(total, amount, &total) : !__builtin_add_overflow(total, amount, &total);
+#else
+        constexpr W max = std::numeric_limits<W>::max();
+        constexpr W lowest = std::numeric_limits<W>::lowest();
+        const bool upward = (amount < 0) == subtract;
+        if (upward ? total > (subtract ? max + amount : max - amount) : total < (subtract ? lowest + amount : lowest - amount))
+        {
+            return false;
+        }
+        total = subtract ? total - amount : total + amount;
+        return true;
+#endif
+    }
+
+    /// <summary>
+    /// Works out expression in T's exact accumulator, checking T's range once at the end.
+    /// </summary>
+    /// <returns>false when the value does not fit in T (or the accumulator overflowed on the way)</returns>
+    template <typename T, typename Expression>
+    constexpr bool fused(Expression const& expression, T& value)
+    {
+        using W = typename overflow_traits<T>::accumulator::type;
+
+        W total{ 0 };
+        bool fits = true;
+        auto term = [&](T const& amount, step_count_t steps, bool subtract)
+        {
+            W product{ 0 };
+            const bool product_fits = multiply<W>(static_cast<W>(amount), steps, product);
+            const bool sum_fits = accumulate<W>(total, product, subtract);
+            fits = fits && product_fits && sum_fits;
+        };
+        expression.for_each_term(term, false);
+
+        if (!fits || total > static_cast<W>(overflow_traits<T>::max()) || total < static_cast<W>(overflow_traits<T>::lowest()))
+        {
+            return false;
+        }
+        value = static_cast<T>(total);
+        return true;
+    }
+
+    /// <summary>
+    /// Works out expression as the add_numbers / subtract_numbers calls it stands for, starting from zero.
+    /// </summary>
+    template <typename T, typename Expression>
+    constexpr CheckedResult<T> chain(Expression const& expression)
+    {
+        CheckedResult<T> result{};
+        result.value = overflow_traits<T>::zero();
+        std::size_t index = 0;
+        auto term = [&](T const& amount, step_count_t steps, bool subtract)
+        {
+            if (!result.success)
+            {
+                return;
+            }
+            const CalcResult<T> step = subtract ? subtract_numbers<T>(result.value, amount, steps) : add_numbers<T>(result.value, amount, steps);
+            result.value = step.value;
+            result.success = step.success;
+            result.failed_at_step = step.failed_at_step;
+            result.precision_lost = result.precision_lost || step.precision_lost;
+            result.failed_term = step.success ? 0 : index;
+            ++index;
+        };
+        expression.for_each_term(term, false);
+        return result;
+    }
+}
+
+
+/// <summary>
+/// The base of every node of a Checked<T> expression (see the top of this file). Derived is the node itself.
+/// Every node has a count of terms and for_each_term(f, subtract), which calls f(amount, steps, subtract)
+/// for each term in the order they are written.
+/// </summary>
+template <typename Derived, typename T>
+class CheckedExpression
+{
+public:
+    using value_type = T;
+
+    constexpr Derived const& derived() const
+    {
+        return static_cast<Derived const&>(*this);
+    }
+
+    /// <summary>
+    /// Works out the expression, with the fused check where T has an exact accumulator.
+    /// </summary>
+    constexpr CheckedResult<T> evaluate() const
+    {
+        if constexpr (overflow_traits<T>::accumulator::exact)
+        {
+            CheckedResult<T> result{};
+            if (checked_detail::fused<T>(derived(), result.value))
+            {
+                return result;
+            }
+        }
+        return checked_detail::chain<T>(derived());
+    }
+};
+
+
+/// <summary>
+/// A value of T that takes part in checked expressions.
+/// </summary>
+template <typename T>
+class Checked : public CheckedExpression<Checked<T>, T>
+{
+public:
+    static constexpr std::size_t terms = 1;
+
+    constexpr Checked() : value_(overflow_traits<T>::zero()) {}
+
+    constexpr explicit Checked(T const& value) : value_(value) {}
+
+    constexpr T const& value() const { return value_; }
+
+    template <typename F>
+    constexpr void for_each_term(F& f, bool subtract) const
+    {
+        f(value_, step_count_t{ 1 }, subtract);
+    }
+
+private:
+    T value_;
+};
+
+/// <summary>
+/// value * steps: one term that add_numbers(start, value, steps) would add.
+/// </summary>
+template <typename T>
+class CheckedProduct : public CheckedExpression<CheckedProduct<T>, T>
+{
+public:
+    static constexpr std::size_t terms = 1;
+
+    constexpr CheckedProduct(T const& value, step_count_t steps) : value_(value), steps_(steps) {}
+
+    template <typename F>
+    constexpr void for_each_term(F& f, bool subtract) const
+    {
+        f(value_, steps_, subtract);
+    }
+
+private:
+    T value_;
+    step_count_t steps_;
+};
+
+/// <summary>
+/// lhs + rhs, or lhs - rhs when Subtract is true.
+/// </summary>
+template <typename L, typename R, bool Subtract>
+class CheckedSum : public CheckedExpression<CheckedSum<L, R, Subtract>, typename L::value_type>
+{
+public:
+    static constexpr std::size_t terms = L::terms + R::terms;
+
+    constexpr CheckedSum(L const& lhs, R const& rhs) : lhs_(lhs), rhs_(rhs) {}
+
+    template <typename F>
+    constexpr void for_each_term(F& f, bool subtract) const
+    {
+        lhs_.for_each_term(f, subtract);
+        rhs_.for_each_term(f, Subtract ? !subtract : subtract);
+    }
+
+private:
+    L lhs_;
+    R rhs_;
+};
+
+
+template <typename L, typename R, typename T>
+constexpr CheckedSum<L, R, false> operator+(CheckedExpression<L, T> const& lhs, CheckedExpression<R, T> const& rhs)
+{
+    return CheckedSum<L, R, false>(lhs.derived(), rhs.derived());
+}
+
+template <typename L, typename R, typename T>
+constexpr CheckedSum<L, R, true> operator-(CheckedExpression<L, T> const& lhs, CheckedExpression<R, T> const& rhs)
+{
+    return CheckedSum<L, R, true>(lhs.derived(), rhs.derived());
+}
+
+/// <summary>
+/// value * steps. steps has to be unsigned: a signed count such as -3 would turn into a step count near 2^64 and
+/// give a believable but wrong result, so those overloads are deleted.
+/// </summary>
+template <typename T, typename K, std::enable_if_t<std::is_integral<K>::value && std::is_unsigned<K>::value && !std::is_same<K, bool>::value, int> = 0>
+constexpr CheckedProduct<T> operator*(Checked<T> const& value, K steps)
+{
+    return CheckedProduct<T>(value.value(), static_cast<step_count_t>(steps));
+}
+
+template <typename T, typename K, std::enable_if_t<std::is_integral<K>::value && std::is_unsigned<K>::value && !std::is_same<K, bool>::value, int> = 0>
+constexpr CheckedProduct<T> operator*(K steps, Checked<T> const& value)
+{
+    return CheckedProduct<T>(value.value(), static_cast<step_count_t>(steps));
+}
+
+template <typename T, typename K, std::enable_if_t<std::is_signed<K>::value || std::is_same<K, bool>::value, int> = 0>
+CheckedProduct<T> operator*(Checked<T> const& value, K steps) = delete;
+
+template <typename T, typename K, std::enable_if_t<std::is_signed<K>::value || std::is_same<K, bool>::value, int> = 0>
+CheckedProduct<T> operator*(K steps, Checked<T> const& value) = delete;
+
+
+namespace checked_detail
+{
+    template <typename L, typename R, typename = void>
+    struct can_multiply : std::false_type {};
+
+    template <typename L, typename R>
+    struct can_multiply<L, R, std::void_t<decltype(std::declval<L>() * std::declval<R>())>> : std::true_type {};
+}
+
+static_assert((Checked<int>(100) + Checked<int>(7) * 3u - Checked<int>(1)).evaluate().value == 120, "a + b * k - c");
+static_assert((Checked<int>(std::numeric_limits<int>::max()) + Checked<int>(1) - Checked<int>(1)).evaluate().success,
+    "only the value of the whole expression has to fit");
+static_assert((Checked<unsigned int>(1) - Checked<unsigned int>(2) + Checked<unsigned int>(5)).evaluate().value == 4u,
+    "unsigned terms may dip below zero on the way");
+static_assert(!(Checked<signed char>(100) + Checked<signed char>(10) * 3u + Checked<signed char>(1)).evaluate().success
+    && (Checked<signed char>(100) + Checked<signed char>(10) * 3u + Checked<signed char>(1)).evaluate().value == 120
+    && (Checked<signed char>(100) + Checked<signed char>(10) * 3u + Checked<signed char>(1)).evaluate().failed_at_step == 2
+    && (Checked<signed char>(100) + Checked<signed char>(10) * 3u + Checked<signed char>(1)).evaluate().failed_term == 1,
+    "a failed expression reports like the chain of add_numbers calls");
+static_assert((Checked<double>(1.5) + 2u * Checked<double>(0.25)).evaluate().value == 2.0, "floating point runs the chain");
+#if defined(__SIZEOF_INT128__)
+static_assert((Checked<long long>(std::numeric_limits<long long>::max()) * 2u - Checked<long long>(std::numeric_limits<long long>::max()))
+    .evaluate().value == std::numeric_limits<long long>::max(), "64-bit integers add up in __int128");
+#endif
+static_assert(checked_detail::can_multiply<Checked<int>, unsigned int>::value && checked_detail::can_multiply<step_count_t, Checked<int>>::value
+    && checked_detail::can_multiply<Checked<int>, unsigned char>::value, "unsigned step counts multiply");
+static_assert(!checked_detail::can_multiply<Checked<int>, int>::value && !checked_detail::can_multiply<long long, Checked<int>>::value
+    && !checked_detail::can_multiply<Checked<int>, signed char>::value && !checked_detail::can_multiply<Checked<int>, bool>::value,
+    "a signed step count does not compile rather than wrap to a huge unsigned one");
@@ -0,0 +1,416 @@
+// ColumnarFile.h : Memory-mapped columnar request and result files for bulk checks.
+//
+// A columnar request file holds one operation over many lanes of one type: a header, then a column of starts,
+// a column of amounts and a column of step counts. The file is mapped into memory and the SIMD batch kernels
+// from NumericBatch.h read the columns in place; their values and success bits go straight into a mapped result
+// file with a value column and a success bitmask column. Nothing is copied or parsed on the way through.
+// The lanes go through in chunks. A chunk whose step counts are all the same takes the shared step count
+// kernels, and any other chunk the per-lane ones, which load the counts a vector at a time. Types without
+// a SIMD kernel go through the scalar templates either way.
+//
+// Every file starts with a 64-byte ColumnarHeader, native byte order. Columns start on 64-byte boundaries
+// at the offsets the header gives (columnar_layout() computes them):
+//     requests (kind 0):  start T[count], amount T[count], steps uint64[count]
+//     results  (kind 1):  value T[count], success uint64[(count + 63) / 64]  (bit i % 64 of word i / 64)
+// T is the type the header's bulk_type names, stored as the machine writing the file stores it.
+
+#pragma once
+
+#include <algorithm>    // std::min
+#include <cstddef>      // std::size_t
+#include <cstdint>      // std::uint8_t, std::uint32_t, std::uint64_t
+#include <cstring>      // std::memcpy, std::memcmp
+#include <filesystem>   // std::filesystem::equivalent
+#include <limits>       // std::numeric_limits
+#include <ostream>      // std::ostream
+#include <string>       // std::string
+#include <system_error> // std::error_code
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>    // CreateFileA, CreateFileMappingA, MapViewOfFile, UnmapViewOfFile
+#else
+#include <fcntl.h>      // open
+#include <sys/mman.h>   // mmap, munmap, madvise
+#include <sys/stat.h>   // fstat
+#include <unistd.h>     // close, ftruncate
+#endif
+
+#include "BulkCheck.h"
+#include "CalcResultBlock.h"
+#include "NumericBatch.h"
+
+
+/// <summary>
+/// A whole file mapped into memory, read-only or (for a newly created file) read-write.
+/// </summary>
+class MappedFile
+{
+public:
+    MappedFile() = default;
+
+    ~MappedFile()
+    {
+        close();
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /// <summary>
+    /// Maps an existing file for reading.
+    /// </summary>
+    /// <returns>false when the file cannot be opened or mapped</returns>
+    bool open_read(const std::string& path)
+    {
+        close();
+#if defined(_WIN32)
+        file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        LARGE_INTEGER size{};
+        if (file_ == INVALID_HANDLE_VALUE || !GetFileSizeEx(file_, &size) || size.QuadPart == 0)
+        {
+            close();
+            return false;
+        }
+        return map(static_cast<std::uint64_t>(size.QuadPart), false);
+#else
+        fd_ = ::open(path.c_str(), O_RDONLY);
+        struct stat info {};
+        if (fd_ < 0 || fstat(fd_, &info) != 0 || info.st_size <= 0)
+        {
+            close();
+            return false;
+        }
+        return map(static_cast<std::uint64_t>(info.st_size), false);
+#endif
+    }
+
+    /// <summary>
+    /// Creates (or replaces) a file of size bytes, all zero, and maps it for writing.
+    /// </summary>
+    /// <returns>false when the file cannot be created, sized or mapped</returns>
+    bool create(const std::string& path, std::uint64_t size)
+    {
+        close();
+#if defined(_WIN32)
+        file_ = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file_ == INVALID_HANDLE_VALUE)
+        {
+            close();
+            return false;
+        }
+#else
+        fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd_ < 0 || ftruncate(fd_, static_cast<off_t>(size)) != 0)
+        {
+            close();
+            return false;
+        }
+#endif
+        return map(size, true);
+    }
+
+    void close()
+    {
+#if defined(_WIN32)
+        if (data_ != nullptr)
+        {
+            UnmapViewOfFile(data_);
+        }
+        if (mapping_ != nullptr)
+        {
+            CloseHandle(mapping_);
+        }
+        if (file_ != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(file_);
+        }
+        mapping_ = nullptr;
+        file_ = INVALID_HANDLE_VALUE;
+#else
+        if (data_ != nullptr)
+        {
+            munmap(data_, size_);
+        }
+        if (fd_ >= 0)
+        {
+            ::close(fd_);
+        }
+        fd_ = -1;
+#endif
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+    bool is_open() const { return data_ != nullptr; }
+
+    unsigned char* data() { return static_cast<unsigned char*>(data_); }
+    const unsigned char* data() const { return static_cast<const unsigned char*>(data_); }
+    std::size_t size() const { return size_; }
+
+private:
+    bool map(std::uint64_t size, bool writable)
+    {
+        if (size > std::numeric_limits<std::size_t>::max())
+        {
+            close();
+            return false;
+        }
+#if defined(_WIN32)
+        mapping_ = CreateFileMappingA(file_, nullptr, writable ? PAGE_READWRITE : PAGE_READONLY,
+            static_cast<DWORD>(size >> 32), static_cast<DWORD>(size & 0xFFFFFFFFu), nullptr);
+        if (mapping_ != nullptr)
+        {
+            data_ = MapViewOfFile(mapping_, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, static_cast<SIZE_T>(size));
+        }
+#else
+        void* const mapped = mmap(nullptr, static_cast<std::size_t>(size), writable ? PROT_READ | PROT_WRITE : PROT_READ,
+            MAP_SHARED, fd_, 0);
+        if (mapped != MAP_FAILED)
+        {
+            data_ = mapped;
+            // The kernels walk every column front to back exactly once.
+            madvise(data_, static_cast<std::size_t>(size), MADV_SEQUENTIAL);
+        }
+#endif
+        if (data_ == nullptr)
+        {
+            close();
+            return false;
+        }
+        size_ = static_cast<std::size_t>(size);
+        return true;
+    }
+
+#if defined(_WIN32)
+    HANDLE file_{ INVALID_HANDLE_VALUE };
+    HANDLE mapping_{ nullptr };
+#else
+    int fd_{ -1 };
+#endif
+    void* data_{ nullptr };
+    std::size_t size_{ 0 };
+};
+
+
+/// <summary>
+/// The first 64 bytes of every columnar file.
+/// </summary>
+struct ColumnarHeader
+{
+    char magic[8];              // "NUMCOLS" and a terminating zero
+    std::uint32_t version;      // columnar_version
+    std::uint8_t kind;          // columnar_kind
+    std::uint8_t op;            // bulk_op
+    std::uint8_t type;          // bulk_type
+    std::uint8_t value_size;    // sizeof(T) of the machine that wrote the file
+    std::uint64_t count;        // lanes
+    std::uint64_t column[3];    // byte offsets of the columns, in the order listed at the top of this file
+    std::uint64_t reserved[2];
+};
+
+static_assert(sizeof(ColumnarHeader) == 64, "ColumnarHeader must stay 64 bytes");
+
+constexpr char columnar_magic[8] = { 'N', 'U', 'M', 'C', 'O', 'L', 'S', '\0' };
+constexpr std::uint32_t columnar_version = 1;
+constexpr std::uint64_t columnar_alignment = 64;
+
+/// <summary>
+/// What a columnar file holds.
+/// </summary>
+enum class columnar_kind : std::uint8_t
+{
+    requests,
+    results
+};
+
+/// <summary>
+/// Fills in a header, with column offsets, for count lanes of T. The file is file_size bytes long.
+/// </summary>
+template <typename T>
+ColumnarHeader columnar_layout(columnar_kind kind, bulk_op op, bulk_type type, std::uint64_t count, std::uint64_t& file_size)
+{
+    const auto align = [](std::uint64_t offset) { return (offset + columnar_alignment - 1) / columnar_alignment * columnar_alignment; };
+
+    ColumnarHeader header{};
+    std::memcpy(header.magic, columnar_magic, sizeof(header.magic));
+    header.version = columnar_version;
+    header.kind = static_cast<std::uint8_t>(kind);
+    header.op = static_cast<std::uint8_t>(op);
+    header.type = static_cast<std::uint8_t>(type);
+    header.value_size = static_cast<std::uint8_t>(sizeof(T));
+    header.count = count;
+
+    const std::uint64_t values = count * sizeof(T);
+    header.column[0] = align(sizeof(ColumnarHeader));
+    if (kind == columnar_kind::requests)
+    {
+        header.column[1] = align(header.column[0] + values);
+        header.column[2] = align(header.column[1] + values);
+        file_size = header.column[2] + count * sizeof(step_count_t);
+    }
+    else
+    {
+        header.column[1] = align(header.column[0] + values);
+        file_size = header.column[1] + batch_mask_words(static_cast<std::size_t>(count)) * sizeof(std::uint64_t);
+    }
+    return header;
+}
+
+
+namespace columnar_detail
+{
+    // Lanes handed to one batch call; a multiple of 64 so every call starts on a fresh mask word.
+    constexpr std::size_t chunk_lanes = 64 * 1024;
+
+    /// <summary>
+    /// Whether the step counts of a chunk's lanes are all the same.
+    /// </summary>
+    inline bool uniform_steps(const step_count_t* steps, std::size_t lanes)
+    {
+        for (std::size_t i = 1; i < lanes; ++i)
+        {
+            if (steps[i] != steps[0])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// <summary>
+    /// Checks that the request file's header matches the layout columnar_layout gives for T.
+    /// </summary>
+    template <typename T>
+    bool valid_requests(const ColumnarHeader& header, std::size_t file_size)
+    {
+        // Every lane takes more than one byte, so this also keeps the offsets below from overflowing.
+        if (header.count > file_size)
+        {
+            return false;
+        }
+        std::uint64_t expected_size = 0;
+        const ColumnarHeader expected = columnar_layout<T>(columnar_kind::requests, static_cast<bulk_op>(header.op),
+            static_cast<bulk_type>(header.type), header.count, expected_size);
+        return header.value_size == sizeof(T)
+            && std::memcmp(header.column, expected.column, sizeof(header.column)) == 0
+            && expected_size <= file_size;
+    }
+
+    template <typename T>
+    int run(const MappedFile& in, const ColumnarHeader& header, const std::string& out_path, std::ostream& errors)
+    {
+        if (!valid_requests<T>(header, in.size()))
+        {
+            errors << "The columns do not fit the file" << std::endl;
+            return 1;
+        }
+
+        const bulk_op op = static_cast<bulk_op>(header.op);
+        std::uint64_t out_size = 0;
+        const ColumnarHeader out_header = columnar_layout<T>(columnar_kind::results, op, static_cast<bulk_type>(header.type),
+            header.count, out_size);
+
+        MappedFile out;
+        if (!out.create(out_path, out_size))
+        {
+            errors << "Cannot write " << out_path << std::endl;
+            return 1;
+        }
+        std::memcpy(out.data(), &out_header, sizeof(out_header));
+
+        // Both mappings start on a page boundary and every column on a 64-byte one, so the columns
+        // are properly aligned arrays and the kernels can use them directly.
+        const T* const starts = reinterpret_cast<const T*>(in.data() + header.column[0]);
+        const T* const amounts = reinterpret_cast<const T*>(in.data() + header.column[1]);
+        const step_count_t* const steps = reinterpret_cast<const step_count_t*>(in.data() + header.column[2]);
+        T* const values = reinterpret_cast<T*>(out.data() + out_header.column[0]);
+        std::uint64_t* const success_mask = reinterpret_cast<std::uint64_t*>(out.data() + out_header.column[1]);
+
+        const std::size_t count = static_cast<std::size_t>(header.count);
+        for (std::size_t first = 0; first < count; first += chunk_lanes)
+        {
+            const std::size_t lanes = std::min(chunk_lanes, count - first);
+            if (uniform_steps(steps + first, lanes))
+            {
+                if (op == bulk_op::subtract)
+                {
+                    subtract_numbers_batch<T>(starts + first, amounts + first, lanes, steps[first], values + first, success_mask + first / 64);
+                }
+                else
+                {
+                    add_numbers_batch<T>(starts + first, amounts + first, lanes, steps[first], values + first, success_mask + first / 64);
+                }
+            }
+            else if (op == bulk_op::subtract)
+            {
+                subtract_numbers_batch<T>(starts + first, amounts + first, steps + first, lanes, values + first, success_mask + first / 64);
+            }
+            else
+            {
+                add_numbers_batch<T>(starts + first, amounts + first, steps + first, lanes, values + first, success_mask + first / 64);
+            }
+        }
+        return 0;
+    }
+}
+
+
+/// <summary>
+/// Runs a columnar request file (options.in_path) and writes its columnar result file (options.out_path).
+/// </summary>
+/// <returns>0 when done, 1 when a file cannot be read or written, the request file is malformed
+/// or --in and --out name the same file</returns>
+inline int run_columnar(const BulkOptions& options, std::ostream& errors)
+{
+    if (options.in_path.empty() || options.out_path.empty())
+    {
+        errors << "--columnar needs both --in and --out" << std::endl;
+        return 1;
+    }
+
+    // Creating the result file truncates it while the request file is still mapped, so the two must differ.
+    std::error_code ignored;
+    if (options.in_path == options.out_path || std::filesystem::equivalent(options.in_path, options.out_path, ignored))
+    {
+        errors << "--in and --out name the same file" << std::endl;
+        return 1;
+    }
+
+    MappedFile in;
+    if (!in.open_read(options.in_path))
+    {
+        errors << "Cannot read " << options.in_path << std::endl;
+        return 1;
+    }
+
+    ColumnarHeader header{};
+    if (in.size() < sizeof(header))
+    {
+        errors << options.in_path << " is not a columnar request file" << std::endl;
+        return 1;
+    }
+    std::memcpy(&header, in.data(), sizeof(header));
+    if (std::memcmp(header.magic, columnar_magic, sizeof(header.magic)) != 0 || header.version != columnar_version
+        || header.kind != static_cast<std::uint8_t>(columnar_kind::requests) || header.op >= static_cast<std::uint8_t>(bulk_op::count))
+    {
+        errors << options.in_path << " is not a columnar request file" << std::endl;
+        return 1;
+    }
+
+    int result = 1;
+    const bool known_type = dispatch_bulk_type(static_cast<bulk_type>(header.type), [&](auto tag)
+    {
+        result = columnar_detail::run<typename decltype(tag)::type>(in, header, options.out_path, errors);
+    });
+    if (!known_type)
+    {
+        errors << options.in_path << " names an unknown type" << std::endl;
+    }
+    return result;
+}
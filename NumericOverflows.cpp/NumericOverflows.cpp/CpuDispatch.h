@@ -0,0 +1,148 @@
+// CpuDispatch.h : Which instruction set the batch kernels in NumericBatch.h run on, picked once at run time.
+//
+// One build carries every kernel the compiler can target (AVX-512 and AVX2 on x86, NEON on 64-bit ARM)
+// and active_batch_isa() says which of them this CPU gets: the first call asks the CPU what it supports,
+// and the answer is kept for the rest of the run. Hosts without any of them use the scalar templates.
+// The environment variable NUMERIC_BATCH_ISA (scalar, avx2, avx512 or neon) caps the choice, so every
+// kernel can be benchmarked on one machine; asking for more than the CPU has gives the best it does have.
+
+#pragma once
+
+#include <cstdlib>      // std::getenv
+#include <cstddef>      // std::size_t
+#include <cstring>      // std::strcmp, std::strlen, std::strcpy
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define NUMERIC_CPU_X86 1
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>     // __cpuid, __cpuidex, _xgetbv
+#endif
+#elif (defined(__ARM_NEON) && defined(__aarch64__)) || defined(_M_ARM64)
+#define NUMERIC_CPU_NEON 1
+#endif
+
+
+/// <summary>
+/// The instruction sets the batch kernels come in, from least to most capable.
+/// </summary>
+enum class batch_isa
+{
+    scalar,
+    avx2,
+    avx512,
+    neon,
+};
+
+/// <summary>
+/// The name NUMERIC_BATCH_ISA uses for isa.
+/// </summary>
+constexpr const char* batch_isa_name(batch_isa isa)
+{
+    return isa == batch_isa::avx512 ? "avx512"
+        : isa == batch_isa::avx2 ? "avx2"
+        : isa == batch_isa::neon ? "neon"
+        : "scalar";
+}
+
+
+namespace cpu_dispatch_detail
+{
+    /// <summary>
+    /// The best instruction set this CPU (and its operating system) can run.
+    /// </summary>
+    inline batch_isa detect()
+    {
+#if defined(NUMERIC_CPU_X86) && defined(_MSC_VER) && !defined(__clang__)
+        int regs[4] = {};
+        __cpuid(regs, 0);
+        const int max_leaf = regs[0];
+        __cpuid(regs, 1);
+        const bool os_saves_ymm = ((regs[2] >> 27) & 1) && ((regs[2] >> 28) & 1) && (_xgetbv(0) & 0x6) == 0x6;
+        if (!os_saves_ymm || max_leaf < 7)
+        {
+            return batch_isa::scalar;
+        }
+        const bool os_saves_zmm = (_xgetbv(0) & 0xE6) == 0xE6;
+        __cpuidex(regs, 7, 0);
+        if (os_saves_zmm && ((regs[1] >> 16) & 1))
+        {
+            return batch_isa::avx512;
+        }
+        return ((regs[1] >> 5) & 1) ? batch_isa::avx2 : batch_isa::scalar;
+#elif defined(NUMERIC_CPU_X86) && (defined(__GNUC__) || defined(__clang__))
+        // These also check that the operating system saves the wider registers.
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f"))
+        {
+            return batch_isa::avx512;
+        }
+        return __builtin_cpu_supports("avx2") ? batch_isa::avx2 : batch_isa::scalar;
+#elif defined(NUMERIC_CPU_NEON)
+        // NEON is part of every 64-bit ARM CPU.
+        return batch_isa::neon;
+#else
+        return batch_isa::scalar;
+#endif
+    }
+
+    /// <summary>
+    /// Reads NUMERIC_BATCH_ISA into isa. false when it is not set or names no instruction set.
+    /// </summary>
+    inline bool read_override(batch_isa& isa)
+    {
+        char value[16] = {};
+#if defined(_MSC_VER)
+        std::size_t size = 0;
+        if (getenv_s(&size, value, sizeof(value), "NUMERIC_BATCH_ISA") != 0 || size == 0)
+        {
+            return false;
+        }
+#else
+        const char* const text = std::getenv("NUMERIC_BATCH_ISA");
+        if (text == nullptr || std::strlen(text) >= sizeof(value))
+        {
+            return false;
+        }
+        std::strcpy(value, text);
+#endif
+        for (const batch_isa candidate : { batch_isa::scalar, batch_isa::avx2, batch_isa::avx512, batch_isa::neon })
+        {
+            if (std::strcmp(value, batch_isa_name(candidate)) == 0)
+            {
+                isa = candidate;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// <summary>
+    /// detected, lowered to requested when that is one the CPU can also run.
+    /// </summary>
+    constexpr batch_isa cap(batch_isa detected, batch_isa requested)
+    {
+        if (requested == batch_isa::scalar)
+        {
+            return batch_isa::scalar;
+        }
+        if (detected == batch_isa::neon || requested == batch_isa::neon)
+        {
+            return detected;
+        }
+        return requested < detected ? requested : detected;
+    }
+}
+
+/// <summary>
+/// The instruction set the batch kernels use in this run (see the top of this file). Detected on the first call.
+/// </summary>
+inline batch_isa active_batch_isa()
+{
+    static const batch_isa isa = []()
+    {
+        const batch_isa detected = cpu_dispatch_detail::detect();
+        batch_isa requested = detected;
+        return cpu_dispatch_detail::read_override(requested) ? cpu_dispatch_detail::cap(detected, requested) : detected;
+    }();
+    return isa;
+}
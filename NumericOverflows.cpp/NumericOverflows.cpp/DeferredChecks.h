@@ -0,0 +1,123 @@
+// DeferredChecks.h : add_numbers / subtract_numbers with the limit check deferred to a wider accumulator.
+//
+// Instead of checking T's limits on every step, the value is accumulated in a wider type, whole chunks of
+// steps at a time, and compared against the limits once per chunk. The chunk size is chosen so the wider
+// type can never overflow, so a narrow type like char or int usually finishes in a single chunk.
+// overflow_traits<T>::accumulator (accumulator_traits<T> unless specialized, see OverflowTraits.h) says which
+// wider type to use; types without an exact one fall back to add_numbers.
+
+#pragma once
+
+#include <cstdint>      // std::int64_t, std::uint64_t
+#include <limits>       // std::numeric_limits
+
+#include "NumericFunctions.h"
+
+
+namespace numeric_detail
+{
+    /// <summary>
+    /// Walks start by delta (a signed step in the accumulator type W), steps times, checking T's limits
+    /// once per chunk. A chunk that crosses a limit is resolved with one division to find the last safe
+    /// step inside it, which is where the stepwise loop would have stopped.
+    /// </summary>
+    template <typename T, typename W>
+    constexpr CalcResult<T> deferred_walk(T start, W delta, step_count_t steps)
+    {
+        const W maxVal = static_cast<W>(overflow_traits<T>::max());
+        const W lowVal = static_cast<W>(overflow_traits<T>::lowest());
+
+        CalcResult<T> out{};
+        out.value = start;
+        if (delta == 0 || steps == 0)
+        {
+            return out;
+        }
+
+        // The accumulator stays inside T between chunks, so it can grow by up to
+        // (W max - T max) before it could overflow itself.
+        const W magnitude = delta < 0 ? -delta : delta;
+        const W headroom = std::numeric_limits<W>::max() - (maxVal > -lowVal ? maxVal : -lowVal);
+        // Capped at 2^63 - 1 so it fits in 64 bits; that is still more steps than any T has room for.
+        const W whole_chunk = headroom / magnitude;
+        const W chunk_cap = static_cast<W>(std::numeric_limits<std::int64_t>::max());
+        const std::uint64_t chunk_limit = static_cast<std::uint64_t>(whole_chunk < chunk_cap ? whole_chunk : chunk_cap);
+
+        W acc = static_cast<W>(start);
+        step_count_t done = 0;
+        while (done < steps)
+        {
+            const step_count_t left = steps - done;
+            const step_count_t chunk = left < chunk_limit ? left : static_cast<step_count_t>(chunk_limit);
+
+            const W next = acc + delta * static_cast<W>(chunk);
+            if (next > maxVal || next < lowVal)
+            {
+                // Crossed a limit inside this chunk: take the whole steps that still fit and stop there.
+                const W room = delta > 0 ? maxVal - acc : acc - lowVal;
+                const W taken = room / magnitude;
+                out.value = static_cast<T>(acc + delta * taken);
+                out.success = false;
+                out.failed_at_step = done + static_cast<step_count_t>(taken);
+                return out;
+            }
+
+            acc = next;
+            done += chunk;
+        }
+
+        out.value = static_cast<T>(acc);
+        return out;
+    }
+}
+
+
+/// <summary>
+/// add_numbers with the limit check deferred to overflow_traits<T>::accumulator::type.
+/// Gives the same CalcResult as add_numbers; types without an exact wider accumulator
+/// are simply handed to add_numbers.
+/// </summary>
+/// <typeparam name="T">A type that with basic math functions</typeparam>
+/// <param name="start">The number to start with</param>
+/// <param name="increment">How much to add each step</param>
+/// <param name="steps">The number of steps to iterate</param>
+/// <returns>start + (increment * steps), or the last safe value with success = false</returns>
+template <typename T>
+constexpr CalcResult<T> add_numbers_deferred(T const& start, T const& increment, step_count_t const& steps)
+{
+    using traits = typename overflow_traits<T>::accumulator;
+    if constexpr (traits::wider && traits::exact)
+    {
+        using W = typename traits::type;
+        return numeric_detail::deferred_walk<T, W>(start, static_cast<W>(increment), steps);
+    }
+    else
+    {
+        return add_numbers<T>(start, increment, steps);
+    }
+}
+
+/// <summary>
+/// subtract_numbers with the limit check deferred to overflow_traits<T>::accumulator::type.
+/// Gives the same CalcResult as subtract_numbers; types without an exact wider accumulator
+/// are simply handed to subtract_numbers.
+/// </summary>
+/// <typeparam name="T">A type that with basic math functions</typeparam>
+/// <param name="start">The number to start with</param>
+/// <param name="decrement">How much to subtract each step</param>
+/// <param name="steps">The number of steps to iterate</param>
+/// <returns>start - (increment * steps), or the last safe value with success = false</returns>
+template <typename T>
+constexpr CalcResult<T> subtract_numbers_deferred(T const& start, T const& decrement, step_count_t const& steps)
+{
+    using traits = typename overflow_traits<T>::accumulator;
+    if constexpr (traits::wider && traits::exact)
+    {
+        using W = typename traits::type;
+        return numeric_detail::deferred_walk<T, W>(start, -static_cast<W>(decrement), steps);
+    }
+    else
+    {
+        return subtract_numbers<T>(start, decrement, steps);
+    }
+}
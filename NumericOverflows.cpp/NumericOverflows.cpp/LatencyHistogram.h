@@ -0,0 +1,182 @@
+// LatencyHistogram.h : Fixed-bucket latency histograms, and the tick counter they are filled from.
+//
+// read_ticks() is the time stamp counter (rdtsc) on x86 and a steady_clock count elsewhere; tick_unit names
+// which. LatencyHistogram keeps every recorded value in one of a fixed set of buckets held inside the object,
+// so recording never allocates: values below 16 each get a bucket, larger ones share one of 8 buckets per
+// power of two, so a percentile is at most 12.5% below the value it stands for. The largest value is exact.
+// time_calls() fills a histogram with the latency of one call repeated many times, and time_check() does
+// it for one check(start, amount, steps) call such as add_numbers<T>.
+
+#pragma once
+
+#include <atomic>       // std::atomic_signal_fence
+#include <cstddef>      // std::size_t
+#include <cstdint>      // std::uint64_t
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>     // __rdtsc
+#define NUMERIC_HAS_RDTSC 1
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>  // __rdtsc
+#define NUMERIC_HAS_RDTSC 1
+#else
+#include <chrono>       // std::chrono::steady_clock
+#endif
+
+
+#if defined(NUMERIC_HAS_RDTSC)
+constexpr const char* tick_unit = "cycles";
+#else
+constexpr const char* tick_unit = "ns";
+#endif
+
+/// <summary>
+/// The current tick count, see tick_unit.
+/// </summary>
+inline std::uint64_t read_ticks()
+{
+#if defined(NUMERIC_HAS_RDTSC)
+    return static_cast<std::uint64_t>(__rdtsc());
+#else
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+
+/// <summary>
+/// A histogram of tick counts with a fixed set of buckets (see the top of this file).
+/// </summary>
+class LatencyHistogram
+{
+public:
+    static constexpr std::size_t linear_buckets = 16;
+    static constexpr std::size_t sub_buckets = 8;
+    // 16 single values, then 8 buckets for each power of two from 2^4 to 2^63.
+    static constexpr std::size_t bucket_count = linear_buckets + (64 - 4) * sub_buckets;
+
+    void record(std::uint64_t ticks)
+    {
+        ++buckets_[bucket_of(ticks)];
+        ++count_;
+        max_ = ticks > max_ ? ticks : max_;
+    }
+
+    std::uint64_t count() const
+    {
+        return count_;
+    }
+
+    std::uint64_t max() const
+    {
+        return max_;
+    }
+
+    /// <summary>
+    /// The smallest value in the bucket holding the value that fraction (0 to 1) of the recorded values
+    /// are at or below, e.g. percentile(0.99) for p99. 0 when nothing was recorded.
+    /// </summary>
+    std::uint64_t percentile(double fraction) const
+    {
+        if (count_ == 0)
+        {
+            return 0;
+        }
+
+        // The rank of the value asked for, counting from 1.
+        std::uint64_t rank = static_cast<std::uint64_t>(fraction * static_cast<double>(count_) + 0.5);
+        rank = rank < 1 ? 1 : (rank > count_ ? count_ : rank);
+
+        std::uint64_t seen = 0;
+        for (std::size_t b = 0; b < bucket_count; ++b)
+        {
+            seen += buckets_[b];
+            if (seen >= rank)
+            {
+                return bucket_floor(b);
+            }
+        }
+        return max_;
+    }
+
+    static constexpr std::size_t bucket_of(std::uint64_t ticks)
+    {
+        if (ticks < linear_buckets)
+        {
+            return static_cast<std::size_t>(ticks);
+        }
+        std::size_t top = 0; // the index of the highest set bit, 4 or more here
+        for (std::uint64_t v = ticks; v > 1; v >>= 1)
+        {
+            ++top;
+        }
+        const std::size_t sub = static_cast<std::size_t>(ticks >> (top - 3)) & (sub_buckets - 1);
+        return linear_buckets + (top - 4) * sub_buckets + sub;
+    }
+
+    static constexpr std::uint64_t bucket_floor(std::size_t bucket)
+    {
+        if (bucket < linear_buckets)
+        {
+            return bucket;
+        }
+        const std::size_t top = (bucket - linear_buckets) / sub_buckets + 4;
+        const std::uint64_t sub = (bucket - linear_buckets) % sub_buckets;
+        return (std::uint64_t{ 1 } << top) | (sub << (top - 3));
+    }
+
+private:
+    std::uint64_t buckets_[bucket_count]{};
+    std::uint64_t count_{ 0 };
+    std::uint64_t max_{ 0 };
+};
+
+static_assert(LatencyHistogram::bucket_of(~std::uint64_t{ 0 }) == LatencyHistogram::bucket_count - 1, "the last bucket holds the largest value");
+static_assert(LatencyHistogram::bucket_of(LatencyHistogram::bucket_floor(100)) == 100, "bucket_floor is the smallest value of its bucket");
+
+
+/// <summary>
+/// Records the ticks taken by repetitions calls of call() in histogram. The cost of reading the
+/// tick counter is measured first and taken off every sample. Compiler fences keep the call between
+/// the two reads and every result is stored, but call() should read its arguments from volatile
+/// copies too, or the compiler may work the result out once for the whole loop.
+/// </summary>
+template <typename Call>
+void time_calls(LatencyHistogram& histogram, unsigned repetitions, Call&& call)
+{
+    std::uint64_t overhead = ~std::uint64_t{ 0 };
+    for (int i = 0; i < 256; ++i)
+    {
+        const std::uint64_t begin = read_ticks();
+        const std::uint64_t end = read_ticks();
+        overhead = end - begin < overhead ? end - begin : overhead;
+    }
+
+    for (unsigned i = 0; i < repetitions; ++i)
+    {
+        const std::uint64_t begin = read_ticks();
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+        const auto result = call();
+        volatile bool sink = result.success;
+        (void)sink;
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+        const std::uint64_t end = read_ticks();
+
+        const std::uint64_t ticks = end - begin;
+        histogram.record(ticks > overhead ? ticks - overhead : 0);
+    }
+}
+
+/// <summary>
+/// time_calls for check(start, amount, steps), e.g. a call of add_numbers<T>. The arguments are read back
+/// from volatile copies on every call, so the compiler cannot work the result out once for the whole loop.
+/// </summary>
+template <typename Check, typename T, typename Steps>
+void time_check(LatencyHistogram& histogram, unsigned repetitions, Check const& check, T const& start, T const& amount, Steps steps)
+{
+    volatile T timed_start = start;
+    volatile T timed_amount = amount;
+    volatile Steps timed_steps = steps;
+
+    time_calls(histogram, repetitions, [&]() { return check(T(timed_start), T(timed_amount), Steps(timed_steps)); });
+}
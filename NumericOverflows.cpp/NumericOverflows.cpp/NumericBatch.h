@@ -0,0 +1,1459 @@
+// NumericBatch.h : Batch versions of add_numbers / subtract_numbers over contiguous arrays.
+//
+// Every lane i computes starts[i] +/- (increments[i] * steps) exactly like the scalar templates and
+// writes the value to values[i]. Success flags are packed into a bitmask: bit (i % 64) of word (i / 64),
+// or the whole result goes into a CalcResultBlock<T>.
+// 32-bit and 64-bit integers, float and double run on AVX-512, AVX2 or NEON kernels; every other type
+// (and the tail of each array) goes through the scalar templates. x86-64 builds carry both the AVX-512
+// and the AVX2 kernels whatever the compiler's -m / /arch flags, and CpuDispatch.h picks the one the CPU
+// can run the first time a batch needs it. Each type keeps that pick as a plain function pointer, so
+// later batches pay one indirect call. CPUs without AVX2 get the scalar templates.
+// The per-lane step count forms run on the same kernels, which load a vector of counts where the shared
+// forms broadcast one; lanes whose count is too large for a kernel go to the scalar templates.
+// The _saturating_batch forms clamp failed lanes to max() / lowest(); single steps of 8-bit and 16-bit
+// integers use the saturating SIMD adds (paddsb / paddusb / paddsw / paddusw) on AVX2.
+
+#pragma once
+
+#include <cstddef>      // std::size_t
+#include <cstdint>      // std::uint64_t
+#include <limits>       // std::numeric_limits
+#include <type_traits>  // std::is_integral, std::is_signed
+
+#include "CalcResultBlock.h"
+#include "CpuDispatch.h"
+#include "NumericFunctions.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#include <immintrin.h>
+#define NUMERIC_BATCH_AVX512 1
+#define NUMERIC_BATCH_AVX2 1
+#if defined(_MSC_VER) && !defined(__clang__)
+// MSVC emits any intrinsic whatever /arch says.
+#define NUMERIC_TARGET_AVX512
+#define NUMERIC_TARGET_AVX2
+#else
+// Lets GCC and Clang emit these instructions in the kernels alone, not in the rest of the program.
+#define NUMERIC_TARGET_AVX512 __attribute__((target("avx512f,avx2")))
+#define NUMERIC_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#elif defined(NUMERIC_CPU_NEON)
+#include <arm_neon.h>
+#define NUMERIC_BATCH_NEON 1
+#endif
+
+
+namespace numeric_batch_detail
+{
+    inline void clear_mask(std::uint64_t* success_mask, std::size_t count)
+    {
+        for (std::size_t w = 0; w < batch_mask_words(count); ++w)
+        {
+            success_mask[w] = 0;
+        }
+    }
+
+    // Lanes are written in groups of 2, 4, 8 or 16 starting on a multiple of the group size,
+    // so a group never straddles two mask words.
+    inline void store_mask_bits(std::uint64_t* success_mask, std::size_t first_lane, std::uint64_t bits)
+    {
+        success_mask[first_lane / 64] |= bits << (first_lane % 64);
+    }
+
+    template <typename T, bool Subtract>
+    CalcResult<T> scalar_lane(T const& start, T const& increment, step_count_t steps)
+    {
+        return Subtract ? subtract_numbers<T>(start, increment, steps) : add_numbers<T>(start, increment, steps);
+    }
+
+    /// <summary>
+    /// Scalar fallback: runs lanes [first, count) through the scalar templates.
+    /// </summary>
+    template <typename T, bool Subtract>
+    void scalar_walk(const T* starts, const T* increments, std::size_t first, std::size_t count,
+        step_count_t steps, T* values, std::uint64_t* success_mask)
+    {
+        for (std::size_t i = first; i < count; ++i)
+        {
+            const CalcResult<T> r = scalar_lane<T, Subtract>(starts[i], increments[i], steps);
+            values[i] = r.value;
+            if (r.success)
+            {
+                store_mask_bits(success_mask, i, 1u);
+            }
+        }
+    }
+
+    // The kernels take Steps, their step count, either as one count shared by every lane (std::uint32_t for
+    // the integer kernels, step_count_t for the float ones) or as a pointer to one count per lane (the whole
+    // array, indexed like starts).
+    template <typename Steps>
+    constexpr bool is_lane_steps = std::is_pointer<Steps>::value;
+
+    inline step_count_t step_of(step_count_t steps, std::size_t)
+    {
+        return steps;
+    }
+
+    inline step_count_t step_of(const step_count_t* steps, std::size_t lane)
+    {
+        return steps[lane];
+    }
+
+    /// <summary>
+    /// The per-lane step counts of one group of Lanes lanes, narrowed to 32 bits so a kernel can load them
+    /// as a vector. A count over the kernel's limit is staged as 0, and its lane flagged in oversized for
+    /// the scalar engine to redo.
+    /// </summary>
+    template <unsigned Lanes>
+    struct lane_step_group
+    {
+        std::uint32_t counts[Lanes];
+        std::uint64_t oversized{ 0 };
+        std::uint32_t most{ 0 };    // the largest count staged
+
+        lane_step_group(const step_count_t* steps, step_count_t limit)
+        {
+            for (unsigned j = 0; j < Lanes; ++j)
+            {
+                const bool over = steps[j] > limit;
+                counts[j] = over ? 0u : static_cast<std::uint32_t>(steps[j]);
+                oversized |= static_cast<std::uint64_t>(over) << j;
+                most = counts[j] > most ? counts[j] : most;
+            }
+        }
+    };
+
+    // A SIMD integer kernel only proves the common "whole walk fits" case. Lanes it could not prove
+    // are re-run through the scalar engine, which finds the last safe value with its one division.
+    template <typename T, bool Subtract, typename Steps>
+    void fix_failed_lanes(const T* starts, const T* increments, std::size_t first, unsigned lanes,
+        std::uint64_t fit_bits, Steps steps, T* values, std::uint64_t* success_mask)
+    {
+        for (unsigned j = 0; j < lanes; ++j)
+        {
+            if ((fit_bits >> j) & 1u)
+            {
+                continue;
+            }
+
+            const CalcResult<T> r = scalar_lane<T, Subtract>(starts[first + j], increments[first + j], step_of(steps, first + j));
+            values[first + j] = r.value;
+            if (r.success)
+            {
+                store_mask_bits(success_mask, first + j, 1u);
+            }
+        }
+    }
+
+    template <typename T>
+    constexpr bool is_int32_lane = std::is_integral<T>::value && sizeof(T) == 4;
+
+    template <typename T>
+    constexpr bool is_int64_lane = std::is_integral<T>::value && sizeof(T) == 8;
+
+    // float / double walks longer than this go to the scalar engine instead of the SIMD kernels. The
+    // scalar engine starts skipping runs of identical steps at 64 steps (OverflowGuard's
+    // skip_ahead_min_steps), and from there on it beats a kernel that takes every step.
+    constexpr step_count_t simd_float_step_limit = 64;
+
+#if defined(NUMERIC_BATCH_AVX512)
+
+    /// <summary>
+    /// The kernels for CPUs with AVX-512F, 16 x 32-bit or 8 x 64-bit lanes.
+    /// </summary>
+    struct avx512_kernels
+    {
+        template <typename T, bool Subtract, typename Steps>
+        NUMERIC_TARGET_AVX512 static std::size_t simd_walk_int32(const T* starts, const T* increments, std::size_t count, Steps steps,
+            T* values, std::uint64_t* success_mask)
+        {
+            const __m512i zero = _mm512_setzero_si512();
+            const __m512i vmax = _mm512_set1_epi32(static_cast<int>(std::numeric_limits<T>::max()));
+            const __m512i vlow = _mm512_set1_epi32(static_cast<int>(std::numeric_limits<T>::lowest()));
+            __m512i vsteps = zero;
+            if constexpr (!is_lane_steps<Steps>)
+            {
+                vsteps = _mm512_set1_epi32(static_cast<int>(steps));
+            }
+
+            std::size_t i = 0;
+            for (; i + 16 <= count; i += 16)
+            {
+                const __m512i s = _mm512_loadu_si512(starts + i);
+                const __m512i inc = _mm512_loadu_si512(increments + i);
+
+                // The counts multiplied into the even and the odd lanes (the low half of each 64-bit pair).
+                __m512i even_steps = vsteps;
+                __m512i odd_steps = vsteps;
+                __mmask16 oversized = 0;
+                if constexpr (is_lane_steps<Steps>)
+                {
+                    const lane_step_group<16> group(steps + i, 0xFFFFFFFFu);
+                    even_steps = _mm512_loadu_si512(group.counts);
+                    odd_steps = _mm512_srli_epi64(even_steps, 32);
+                    oversized = static_cast<__mmask16>(group.oversized);
+                }
+
+                // Direction and size of one step. abs(lowest()) wraps to 2^31, which is right as an unsigned magnitude.
+                const __mmask16 neg = std::is_signed<T>::value ? _mm512_cmplt_epi32_mask(inc, zero) : __mmask16{ 0 };
+                const __m512i mag = std::is_signed<T>::value ? _mm512_abs_epi32(inc) : inc;
+                const __mmask16 up = Subtract ? neg : static_cast<__mmask16>(~neg);
+
+                const __m512i room = _mm512_mask_blend_epi32(up, _mm512_sub_epi32(s, vlow), _mm512_sub_epi32(vmax, s));
+
+                // 32 x 32 -> 64-bit products, split back into low and high halves per lane.
+                const __m512i p_even = _mm512_mul_epu32(mag, even_steps);
+                const __m512i p_odd = _mm512_mul_epu32(_mm512_srli_epi64(mag, 32), odd_steps);
+                const __m512i lo = _mm512_mask_blend_epi32(0xAAAA, p_even, _mm512_slli_epi64(p_odd, 32));
+                const __m512i hi = _mm512_mask_blend_epi32(0xAAAA, _mm512_srli_epi64(p_even, 32), p_odd);
+
+                const __mmask16 fits = _mm512_cmpeq_epi32_mask(hi, zero) & _mm512_cmple_epu32_mask(lo, room) & static_cast<__mmask16>(~oversized);
+                _mm512_storeu_si512(values + i, _mm512_mask_blend_epi32(up, _mm512_sub_epi32(s, lo), _mm512_add_epi32(s, lo)));
+
+                store_mask_bits(success_mask, i, fits);
+                if (fits != 0xFFFF)
+                {
+                    fix_failed_lanes<T, Subtract>(starts, increments, i, 16, fits, steps, values, success_mask);
+                }
+            }
+            return i;
+        }
+
+        template <typename T, bool Subtract, typename Steps>
+        NUMERIC_TARGET_AVX512 static std::size_t simd_walk_int64(const T* starts, const T* increments, std::size_t count, Steps steps,
+            T* values, std::uint64_t* success_mask)
+        {
+            const __m512i zero = _mm512_setzero_si512();
+            const __m512i vmax = _mm512_set1_epi64(static_cast<long long>(std::numeric_limits<T>::max()));
+            const __m512i vlow = _mm512_set1_epi64(static_cast<long long>(std::numeric_limits<T>::lowest()));
+            __m512i vsteps = zero;
+            if constexpr (!is_lane_steps<Steps>)
+            {
+                vsteps = _mm512_set1_epi64(static_cast<long long>(steps));
+            }
+
+            std::size_t i = 0;
+            for (; i + 8 <= count; i += 8)
+            {
+                const __m512i s = _mm512_loadu_si512(starts + i);
+                const __m512i inc = _mm512_loadu_si512(increments + i);
+
+                __mmask8 oversized = 0;
+                if constexpr (is_lane_steps<Steps>)
+                {
+                    const lane_step_group<8> group(steps + i, 0xFFFFFFFFu);
+                    vsteps = _mm512_cvtepu32_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(group.counts)));
+                    oversized = static_cast<__mmask8>(group.oversized);
+                }
+
+                const __mmask8 neg = std::is_signed<T>::value ? _mm512_cmplt_epi64_mask(inc, zero) : __mmask8{ 0 };
+                const __m512i mag = std::is_signed<T>::value ? _mm512_abs_epi64(inc) : inc;
+                const __mmask8 up = Subtract ? neg : static_cast<__mmask8>(~neg);
+
+                const __m512i room = _mm512_mask_blend_epi64(up, _mm512_sub_epi64(s, vlow), _mm512_sub_epi64(vmax, s));
+
+                // mag * steps = (mag_hi * steps) << 32 + mag_lo * steps, with steps < 2^32.
+                const __m512i p_lo = _mm512_mul_epu32(mag, vsteps);
+                const __m512i p_hi = _mm512_mul_epu32(_mm512_srli_epi64(mag, 32), vsteps);
+                const __m512i total = _mm512_add_epi64(_mm512_slli_epi64(p_hi, 32), p_lo);
+
+                const __mmask8 bad = _mm512_cmpneq_epi64_mask(_mm512_srli_epi64(p_hi, 32), zero)
+                    | _mm512_cmplt_epu64_mask(total, p_lo)
+                    | _mm512_cmpgt_epu64_mask(total, room);
+                const __mmask8 fits = static_cast<__mmask8>(~(bad | oversized));
+
+                _mm512_storeu_si512(values + i, _mm512_mask_blend_epi64(up, _mm512_sub_epi64(s, total), _mm512_add_epi64(s, total)));
+
+                store_mask_bits(success_mask, i, fits);
+                if (fits != 0xFF)
+                {
+                    fix_failed_lanes<T, Subtract>(starts, increments, i, 8, fits, steps, values, success_mask);
+                }
+            }
+            return i;
+        }
+
+        template <bool Subtract, typename Steps>
+        NUMERIC_TARGET_AVX512 static std::size_t simd_walk_float(const float* starts, const float* increments, std::size_t count, Steps steps,
+            float* values, std::uint64_t* success_mask)
+        {
+            const __m512 zero = _mm512_setzero_ps();
+            const __m512 vmax = _mm512_set1_ps(std::numeric_limits<float>::max());
+            const __m512 vlow = _mm512_set1_ps(std::numeric_limits<float>::lowest());
+
+            std::size_t i = 0;
+            for (; i + 16 <= count; i += 16)
+            {
+                __m512 v = _mm512_loadu_ps(starts + i);
+                const __m512 inc = _mm512_loadu_ps(increments + i);
+
+                // With per-lane counts the group walks for as long as its longest lane, and a lane only
+                // steps (and is only checked) while it still has steps left.
+                step_count_t walk_steps = 0;
+                __m512i lane_steps = _mm512_setzero_si512();
+                __mmask16 oversized = 0;
+                if constexpr (is_lane_steps<Steps>)
+                {
+                    const lane_step_group<16> group(steps + i, simd_float_step_limit);
+                    walk_steps = group.most;
+                    lane_steps = _mm512_loadu_si512(group.counts);
+                    oversized = static_cast<__mmask16>(group.oversized);
+                }
+                else
+                {
+                    walk_steps = steps;
+                }
+
+                // Same per-step checks as the stepwise loop, applied to 16 lanes at once.
+                // A lane that fails stays frozen on its last safe value; once every lane is frozen or has
+                // absorbed its increment (next == v) the remaining steps cannot change anything.
+                const __mmask16 pos = _mm512_cmp_ps_mask(inc, zero, _CMP_GT_OQ);
+                const __mmask16 neg = _mm512_cmp_ps_mask(inc, zero, _CMP_LT_OQ);
+                const __m512 th_pos = Subtract ? _mm512_add_ps(vlow, inc) : _mm512_sub_ps(vmax, inc);
+                const __m512 th_neg = Subtract ? _mm512_add_ps(vmax, inc) : _mm512_sub_ps(vlow, inc);
+
+                __mmask16 active = 0xFFFF;
+                for (step_count_t step = 0; step < walk_steps; ++step)
+                {
+                    const __mmask16 due = is_lane_steps<Steps>
+                        ? _mm512_cmpgt_epu32_mask(lane_steps, _mm512_set1_epi32(static_cast<int>(step))) : __mmask16{ 0xFFFF };
+                    const __mmask16 fail = due & (Subtract
+                        ? ((pos & _mm512_cmp_ps_mask(v, th_pos, _CMP_LT_OQ)) | (neg & _mm512_cmp_ps_mask(v, th_neg, _CMP_GT_OQ)))
+                        : ((pos & _mm512_cmp_ps_mask(v, th_pos, _CMP_GT_OQ)) | (neg & _mm512_cmp_ps_mask(v, th_neg, _CMP_LT_OQ))));
+                    active = static_cast<__mmask16>(active & ~fail);
+                    const __mmask16 stepping = static_cast<__mmask16>(active & due);
+                    const __m512 next = Subtract ? _mm512_mask_sub_ps(v, stepping, v, inc) : _mm512_mask_add_ps(v, stepping, v, inc);
+
+                    // Stop once no lane can change any more: every lane has failed or absorbed its increment.
+                    const __mmask16 moving = static_cast<__mmask16>(stepping & _mm512_cmp_ps_mask(next, v, _CMP_NEQ_UQ));
+                    v = next;
+                    if (moving == 0)
+                    {
+                        break;
+                    }
+                }
+
+                _mm512_storeu_ps(values + i, v);
+                active = static_cast<__mmask16>(active & ~oversized);
+                store_mask_bits(success_mask, i, active);
+                if (oversized != 0)
+                {
+                    fix_failed_lanes<float, Subtract>(starts, increments, i, 16, active | static_cast<__mmask16>(~oversized), steps, values, success_mask);
+                }
+            }
+            return i;
+        }
+
+        template <bool Subtract, typename Steps>
+        NUMERIC_TARGET_AVX512 static std::size_t simd_walk_double(const double* starts, const double* increments, std::size_t count, Steps steps,
+            double* values, std::uint64_t* success_mask)
+        {
+            const __m512d zero = _mm512_setzero_pd();
+            const __m512d vmax = _mm512_set1_pd(std::numeric_limits<double>::max());
+            const __m512d vlow = _mm512_set1_pd(std::numeric_limits<double>::lowest());
+
+            std::size_t i = 0;
+            for (; i + 8 <= count; i += 8)
+            {
+                __m512d v = _mm512_loadu_pd(starts + i);
+                const __m512d inc = _mm512_loadu_pd(increments + i);
+
+                step_count_t walk_steps = 0;
+                __m512i lane_steps = _mm512_setzero_si512();
+                __mmask8 oversized = 0;
+                if constexpr (is_lane_steps<Steps>)
+                {
+                    const lane_step_group<8> group(steps + i, simd_float_step_limit);
+                    walk_steps = group.most;
+                    lane_steps = _mm512_cvtepu32_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(group.counts)));
+                    oversized = static_cast<__mmask8>(group.oversized);
+                }
+                else
+                {
+                    walk_steps = steps;
+                }
+
+                const __mmask8 pos = _mm512_cmp_pd_mask(inc, zero, _CMP_GT_OQ);
+                const __mmask8 neg = _mm512_cmp_pd_mask(inc, zero, _CMP_LT_OQ);
+                const __m512d th_pos = Subtract ? _mm512_add_pd(vlow, inc) : _mm512_sub_pd(vmax, inc);
+                const __m512d th_neg = Subtract ? _mm512_add_pd(vmax, inc) : _mm512_sub_pd(vlow, inc);
+
+                __mmask8 active = 0xFF;
+                for (step_count_t step = 0; step < walk_steps; ++step)
+                {
+                    const __mmask8 due = is_lane_steps<Steps>
+                        ? _mm512_cmpgt_epu64_mask(lane_steps, _mm512_set1_epi64(static_cast<long long>(step))) : __mmask8{ 0xFF };
+                    const __mmask8 fail = due & (Subtract
+                        ? ((pos & _mm512_cmp_pd_mask(v, th_pos, _CMP_LT_OQ)) | (neg & _mm512_cmp_pd_mask(v, th_neg, _CMP_GT_OQ)))
+                        : ((pos & _mm512_cmp_pd_mask(v, th_pos, _CMP_GT_OQ)) | (neg & _mm512_cmp_pd_mask(v, th_neg, _CMP_LT_OQ))));
+                    active = static_cast<__mmask8>(active & ~fail);
+                    const __mmask8 stepping = static_cast<__mmask8>(active & due);
+                    const __m512d next = Subtract ? _mm512_mask_sub_pd(v, stepping, v, inc) : _mm512_mask_add_pd(v, stepping, v, inc);
+
+                    // Stop once no lane can change any more: every lane has failed or absorbed its increment.
+                    const __mmask8 moving = static_cast<__mmask8>(stepping & _mm512_cmp_pd_mask(next, v, _CMP_NEQ_UQ));
+                    v = next;
+                    if (moving == 0)
+                    {
+                        break;
+                    }
+                }
+
+                _mm512_storeu_pd(values + i, v);
+                active = static_cast<__mmask8>(active & ~oversized);
+                store_mask_bits(success_mask, i, active);
+                if (oversized != 0)
+                {
+                    fix_failed_lanes<double, Subtract>(starts, increments, i, 8, active | static_cast<__mmask8>(~oversized), steps, values, success_mask);
+                }
+            }
+            return i;
+        }
+    };
+
+#endif
+
+#if defined(NUMERIC_BATCH_AVX2)
+
+    /// <summary>
+    /// The kernels for CPUs with AVX2, 8 x 32-bit or 4 x 64-bit lanes.
+    /// </summary>
+    struct avx2_kernels
+    {
+        // Unsigned 64-bit a > b, which AVX2 only has in signed form.
+        NUMERIC_TARGET_AVX2 static __m256i avx2_cmpgt_epu64(__m256i a, __m256i b)
+        {
+            const __m256i sign = _mm256_set1_epi64x(static_cast<long long>(0x8000000000000000ull));
+            return _mm256_cmpgt_epi64(_mm256_xor_si256(a, sign), _mm256_xor_si256(b, sign));
+        }
+
+        template <typename T, bool Subtract, typename Steps>
+        NUMERIC_TARGET_AVX2 static std::size_t simd_walk_int32(const T* starts, const T* increments, std::size_t count, Steps steps,
+            T* values, std::uint64_t* success_mask)
+        {
+            const __m256i zero = _mm256_setzero_si256();
+            const __m256i ones = _mm256_set1_epi32(-1);
+            const __m256i vmax = _mm256_set1_epi32(static_cast<int>(std::numeric_limits<T>::max()));
+            const __m256i vlow = _mm256_set1_epi32(static_cast<int>(std::numeric_limits<T>::lowest()));
+            __m256i vsteps = zero;
+            if constexpr (!is_lane_steps<Steps>)
+            {
+                vsteps = _mm256_set1_epi32(static_cast<int>(steps));
+            }
+
+            std::size_t i = 0;
+            for (; i + 8 <= count; i += 8)
+            {
+                const __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(starts + i));
+                const __m256i inc = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(increments + i));
+
+                // The counts multiplied into the even and the odd lanes (the low half of each 64-bit pair).
+                __m256i even_steps = vsteps;
+                __m256i odd_steps = vsteps;
+                std::uint64_t oversized = 0;
+                if constexpr (is_lane_steps<Steps>)
+                {
+                    const lane_step_group<8> group(steps + i, 0xFFFFFFFFu);
+                    even_steps = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(group.counts));
+                    odd_steps = _mm256_srli_epi64(even_steps, 32);
+                    oversized = group.oversized;
+                }
+
+                // Direction and size of one step. (inc ^ neg) - neg is abs(inc); lowest() wraps to 2^31 as unsigned.
+                const __m256i neg = std::is_signed<T>::value ? _mm256_cmpgt_epi32(zero, inc) : zero;
+                const __m256i mag = _mm256_sub_epi32(_mm256_xor_si256(inc, neg), neg);
+                const __m256i up = Subtract ? neg : _mm256_xor_si256(neg, ones);
+
+                const __m256i room = _mm256_blendv_epi8(_mm256_sub_epi32(s, vlow), _mm256_sub_epi32(vmax, s), up);
+
+                // 32 x 32 -> 64-bit products, split back into low and high halves per lane.
+                const __m256i p_even = _mm256_mul_epu32(mag, even_steps);
+                const __m256i p_odd = _mm256_mul_epu32(_mm256_srli_epi64(mag, 32), odd_steps);
+                const __m256i lo = _mm256_blend_epi32(p_even, _mm256_slli_epi64(p_odd, 32), 0xAA);
+                const __m256i hi = _mm256_blend_epi32(_mm256_srli_epi64(p_even, 32), p_odd, 0xAA);
+
+                // Fits when the product has no high half and lo <= room (max_epu32(lo, room) == room).
+                const __m256i fits = _mm256_and_si256(_mm256_cmpeq_epi32(hi, zero),
+                    _mm256_cmpeq_epi32(_mm256_max_epu32(lo, room), room));
+
+                const __m256i value = _mm256_blendv_epi8(_mm256_sub_epi32(s, lo), _mm256_add_epi32(s, lo), up);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(values + i), value);
+
+                const std::uint64_t bits = static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(fits))) & ~oversized;
+                store_mask_bits(success_mask, i, bits);
+                if (bits != 0xFF)
+                {
+                    fix_failed_lanes<T, Subtract>(starts, increments, i, 8, bits, steps, values, success_mask);
+                }
+            }
+            return i;
+        }
+
+        template <typename T, bool Subtract, typename Steps>
+        NUMERIC_TARGET_AVX2 static std::size_t simd_walk_int64(const T* starts, const T* increments, std::size_t count, Steps steps,
+            T* values, std::uint64_t* success_mask)
+        {
+            const __m256i zero = _mm256_setzero_si256();
+            const __m256i ones = _mm256_set1_epi64x(-1);
+            const __m256i vmax = _mm256_set1_epi64x(static_cast<long long>(std::numeric_limits<T>::max()));
+            const __m256i vlow = _mm256_set1_epi64x(static_cast<long long>(std::numeric_limits<T>::lowest()));
+            __m256i vsteps = zero;
+            if constexpr (!is_lane_steps<Steps>)
+            {
+                vsteps = _mm256_set1_epi64x(static_cast<long long>(steps));
+            }
+
+            std::size_t i = 0;
+            for (; i + 4 <= count; i += 4)
+            {
+                const __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(starts + i));
+                const __m256i inc = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(increments + i));
+
+                std::uint64_t oversized = 0;
+                if constexpr (is_lane_steps<Steps>)
+                {
+                    const lane_step_group<4> group(steps + i, 0xFFFFFFFFu);
+                    vsteps = _mm256_cvtepu32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(group.counts)));
+                    oversized = group.oversized;
+                }
+
+                const __m256i neg = std::is_signed<T>::value ? _mm256_cmpgt_epi64(zero, inc) : zero;
+                const __m256i mag = _mm256_sub_epi64(_mm256_xor_si256(inc, neg), neg);
+                const __m256i up = Subtract ? neg : _mm256_xor_si256(neg, ones);
+
+                const __m256i room = _mm256_blendv_epi8(_mm256_sub_epi64(s, vlow), _mm256_sub_epi64(vmax, s), up);
+
+                // mag * steps = (mag_hi * steps) << 32 + mag_lo * steps, with steps < 2^32.
+                const __m256i p_lo = _mm256_mul_epu32(mag, vsteps);
+                const __m256i p_hi = _mm256_mul_epu32(_mm256_srli_epi64(mag, 32), vsteps);
+                const __m256i total = _mm256_add_epi64(_mm256_slli_epi64(p_hi, 32), p_lo);
+
+                // Overflowed when the high product spills past 32 bits or the final add carries out.
+                const __m256i bad = _mm256_or_si256(
+                    _mm256_or_si256(
+                        _mm256_xor_si256(_mm256_cmpeq_epi64(_mm256_srli_epi64(p_hi, 32), zero), ones),
+                        avx2_cmpgt_epu64(p_lo, total)),
+                    avx2_cmpgt_epu64(total, room));
+
+                const __m256i value = _mm256_blendv_epi8(_mm256_sub_epi64(s, total), _mm256_add_epi64(s, total), up);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(values + i), value);
+
+                const std::uint64_t bits = ~static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(bad))) & 0xFu & ~oversized;
+                store_mask_bits(success_mask, i, bits);
+                if (bits != 0xF)
+                {
+                    fix_failed_lanes<T, Subtract>(starts, increments, i, 4, bits, steps, values, success_mask);
+                }
+            }
+            return i;
+        }
+
+        template <bool Subtract, typename Steps>
+        NUMERIC_TARGET_AVX2 static std::size_t simd_walk_float(const float* starts, const float* increments, std::size_t count, Steps steps,
+            float* values, std::uint64_t* success_mask)
+        {
+            const __m256 zero = _mm256_setzero_ps();
+            const __m256 vmax = _mm256_set1_ps(std::numeric_limits<float>::max());
+            const __m256 vlow = _mm256_set1_ps(std::numeric_limits<float>::lowest());
+            const __m256 all = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+            std::size_t i = 0;
+            for (; i + 8 <= count; i += 8)
+            {
+                __m256 v = _mm256_loadu_ps(starts + i);
+                const __m256 inc = _mm256_loadu_ps(increments + i);
+
+                // With per-lane counts the group walks for as long as its longest lane, and a lane only
+                // steps (and is only checked) while it still has steps left.
+                step_count_t walk_steps = 0;
+                __m256i lane_steps = _mm256_setzero_si256();
+                std::uint64_t oversized = 0;
+                if constexpr (is_lane_steps<Steps>)
+                {
+                    const lane_step_group<8> group(steps + i, simd_float_step_limit);
+                    walk_steps = group.most;
+                    lane_steps = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(group.counts));
+                    oversized = group.oversized;
+                }
+                else
+                {
+                    walk_steps = steps;
+                }
+
+                // Same per-step checks as the stepwise loop, applied to 8 lanes at once.
+                // A lane that fails stays frozen on its last safe value; once every lane is frozen or has
+                // absorbed its increment (next == v) the remaining steps cannot change anything.
+                const __m256 pos = _mm256_cmp_ps(inc, zero, _CMP_GT_OQ);
+                const __m256 neg = _mm256_cmp_ps(inc, zero, _CMP_LT_OQ);
+                const __m256 th_pos = Subtract ? _mm256_add_ps(vlow, inc) : _mm256_sub_ps(vmax, inc);
+                const __m256 th_neg = Subtract ? _mm256_add_ps(vmax, inc) : _mm256_sub_ps(vlow, inc);
+
+                __m256 active = all;
+                for (step_count_t step = 0; step < walk_steps; ++step)
+                {
+                    const __m256 due = is_lane_steps<Steps>
+                        ? _mm256_castsi256_ps(_mm256_cmpgt_epi32(lane_steps, _mm256_set1_epi32(static_cast<int>(step)))) : all;
+                    const __m256 fail = _mm256_and_ps(due, Subtract
+                        ? _mm256_or_ps(_mm256_and_ps(pos, _mm256_cmp_ps(v, th_pos, _CMP_LT_OQ)), _mm256_and_ps(neg, _mm256_cmp_ps(v, th_neg, _CMP_GT_OQ)))
+                        : _mm256_or_ps(_mm256_and_ps(pos, _mm256_cmp_ps(v, th_pos, _CMP_GT_OQ)), _mm256_and_ps(neg, _mm256_cmp_ps(v, th_neg, _CMP_LT_OQ))));
+                    active = _mm256_andnot_ps(fail, active);
+                    const __m256 stepping = _mm256_and_ps(active, due);
+                    const __m256 next = _mm256_blendv_ps(v, Subtract ? _mm256_sub_ps(v, inc) : _mm256_add_ps(v, inc), stepping);
+
+                    // Stop once no lane can change any more: every lane has failed or absorbed its increment.
+                    const __m256 moving = _mm256_and_ps(stepping, _mm256_cmp_ps(next, v, _CMP_NEQ_UQ));
+                    v = next;
+                    if (_mm256_movemask_ps(moving) == 0)
+                    {
+                        break;
+                    }
+                }
+
+                _mm256_storeu_ps(values + i, v);
+                const std::uint64_t bits = static_cast<unsigned>(_mm256_movemask_ps(active)) & ~oversized;
+                store_mask_bits(success_mask, i, bits);
+                if (oversized != 0)
+                {
+                    fix_failed_lanes<float, Subtract>(starts, increments, i, 8, bits | ~oversized, steps, values, success_mask);
+                }
+            }
+            return i;
+        }
+
+        template <bool Subtract, typename Steps>
+        NUMERIC_TARGET_AVX2 static std::size_t simd_walk_double(const double* starts, const double* increments, std::size_t count, Steps steps,
+            double* values, std::uint64_t* success_mask)
+        {
+            const __m256d zero = _mm256_setzero_pd();
+            const __m256d vmax = _mm256_set1_pd(std::numeric_limits<double>::max());
+            const __m256d vlow = _mm256_set1_pd(std::numeric_limits<double>::lowest());
+            const __m256d all = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+
+            std::size_t i = 0;
+            for (; i + 4 <= count; i += 4)
+            {
+                __m256d v = _mm256_loadu_pd(starts + i);
+                const __m256d inc = _mm256_loadu_pd(increments + i);
+
+                step_count_t walk_steps = 0;
+                __m256i lane_steps = _mm256_setzero_si256();
+                std::uint64_t oversized = 0;
+                if constexpr (is_lane_steps<Steps>)
+                {
+                    const lane_step_group<4> group(steps + i, simd_float_step_limit);
+                    walk_steps = group.most;
+                    lane_steps = _mm256_cvtepu32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(group.counts)));
+                    oversized = group.oversized;
+                }
+                else
+                {
+                    walk_steps = steps;
+                }
+
+                const __m256d pos = _mm256_cmp_pd(inc, zero, _CMP_GT_OQ);
+                const __m256d neg = _mm256_cmp_pd(inc, zero, _CMP_LT_OQ);
+                const __m256d th_pos = Subtract ? _mm256_add_pd(vlow, inc) : _mm256_sub_pd(vmax, inc);
+                const __m256d th_neg = Subtract ? _mm256_add_pd(vmax, inc) : _mm256_sub_pd(vlow, inc);
+
+                __m256d active = all;
+                for (step_count_t step = 0; step < walk_steps; ++step)
+                {
+                    const __m256d due = is_lane_steps<Steps>
+                        ? _mm256_castsi256_pd(_mm256_cmpgt_epi64(lane_steps, _mm256_set1_epi64x(static_cast<long long>(step)))) : all;
+                    const __m256d fail = _mm256_and_pd(due, Subtract
+                        ? _mm256_or_pd(_mm256_and_pd(pos, _mm256_cmp_pd(v, th_pos, _CMP_LT_OQ)), _mm256_and_pd(neg, _mm256_cmp_pd(v, th_neg, _CMP_GT_OQ)))
+                        : _mm256_or_pd(_mm256_and_pd(pos, _mm256_cmp_pd(v, th_pos, _CMP_GT_OQ)), _mm256_and_pd(neg, _mm256_cmp_pd(v, th_neg, _CMP_LT_OQ))));
+                    active = _mm256_andnot_pd(fail, active);
+                    const __m256d stepping = _mm256_and_pd(active, due);
+                    const __m256d next = _mm256_blendv_pd(v, Subtract ? _mm256_sub_pd(v, inc) : _mm256_add_pd(v, inc), stepping);
+
+                    // Stop once no lane can change any more: every lane has failed or absorbed its increment.
+                    const __m256d moving = _mm256_and_pd(stepping, _mm256_cmp_pd(next, v, _CMP_NEQ_UQ));
+                    v = next;
+                    if (_mm256_movemask_pd(moving) == 0)
+                    {
+                        break;
+                    }
+                }
+
+                _mm256_storeu_pd(values + i, v);
+                const std::uint64_t bits = static_cast<unsigned>(_mm256_movemask_pd(active)) & ~oversized;
+                store_mask_bits(success_mask, i, bits);
+                if (oversized != 0)
+                {
+                    fix_failed_lanes<double, Subtract>(starts, increments, i, 4, bits | ~oversized, steps, values, success_mask);
+                }
+            }
+            return i;
+        }
+    };
+
+#endif
+
+#if defined(NUMERIC_BATCH_NEON)
+
+    /// <summary>
+    /// The kernels for 64-bit ARM, 4 x 32-bit lanes.
+    /// </summary>
+    struct neon_kernels
+    {
+        // Packs the top bit of each 32-bit lane into the low 4 bits of the result.
+        static std::uint64_t neon_lane_bits(uint32x4_t m)
+        {
+            return (vgetq_lane_u32(m, 0) & 1u) | ((vgetq_lane_u32(m, 1) & 1u) << 1)
+                | ((vgetq_lane_u32(m, 2) & 1u) << 2) | ((vgetq_lane_u32(m, 3) & 1u) << 3);
+        }
+
+        template <typename T, bool Subtract, typename Steps>
+        static std::size_t simd_walk_int32(const T* starts, const T* increments, std::size_t count, Steps steps,
+            T* values, std::uint64_t* success_mask)
+        {
+            const uint32x4_t vmax = vdupq_n_u32(static_cast<std::uint32_t>(std::numeric_limits<T>::max()));
+            const uint32x4_t vlow = vdupq_n_u32(static_cast<std::uint32_t>(std::numeric_limits<T>::lowest()));
+            uint32x4_t vsteps = vdupq_n_u32(0);
+            if constexpr (!is_lane_steps<Steps>)
+            {
+                vsteps = vdupq_n_u32(steps);
+            }
+
+            std::size_t i = 0;
+            for (; i + 4 <= count; i += 4)
+            {
+                const uint32x4_t s = vld1q_u32(reinterpret_cast<const std::uint32_t*>(starts + i));
+                const int32x4_t inc = vld1q_s32(reinterpret_cast<const std::int32_t*>(increments + i));
+
+                std::uint64_t oversized = 0;
+                if constexpr (is_lane_steps<Steps>)
+                {
+                    const lane_step_group<4> group(steps + i, 0xFFFFFFFFu);
+                    vsteps = vld1q_u32(group.counts);
+                    oversized = group.oversized;
+                }
+
+                // Direction and size of one step; vabsq wraps lowest() to 2^31, which is right as unsigned.
+                const uint32x4_t neg = std::is_signed<T>::value ? vcltq_s32(inc, vdupq_n_s32(0)) : vdupq_n_u32(0);
+                const uint32x4_t mag = std::is_signed<T>::value ? vreinterpretq_u32_s32(vabsq_s32(inc)) : vreinterpretq_u32_s32(inc);
+                const uint32x4_t up = Subtract ? neg : vmvnq_u32(neg);
+
+                const uint32x4_t room = vbslq_u32(up, vsubq_u32(vmax, s), vsubq_u32(s, vlow));
+
+                // 32 x 32 -> 64-bit products, narrowed back into low and high halves per lane.
+                const uint64x2_t p_low_half = vmull_u32(vget_low_u32(mag), vget_low_u32(vsteps));
+                const uint64x2_t p_high_half = vmull_u32(vget_high_u32(mag), vget_high_u32(vsteps));
+                const uint32x4_t lo = vcombine_u32(vmovn_u64(p_low_half), vmovn_u64(p_high_half));
+                const uint32x4_t hi = vcombine_u32(vshrn_n_u64(p_low_half, 32), vshrn_n_u64(p_high_half, 32));
+
+                const uint32x4_t fits = vandq_u32(vceqq_u32(hi, vdupq_n_u32(0)), vcleq_u32(lo, room));
+                vst1q_u32(reinterpret_cast<std::uint32_t*>(values + i), vbslq_u32(up, vaddq_u32(s, lo), vsubq_u32(s, lo)));
+
+                const std::uint64_t bits = neon_lane_bits(fits) & ~oversized;
+                store_mask_bits(success_mask, i, bits);
+                if (bits != 0xF)
+                {
+                    fix_failed_lanes<T, Subtract>(starts, increments, i, 4, bits, steps, values, success_mask);
+                }
+            }
+            return i;
+        }
+
+        template <typename T, bool Subtract, typename Steps>
+        static std::size_t simd_walk_int64(const T*, const T*, std::size_t, Steps, T*, std::uint64_t*)
+        {
+            return 0; // NEON has no 64-bit widening multiply worth using here; the scalar engine handles these.
+        }
+
+        template <bool Subtract, typename Steps>
+        static std::size_t simd_walk_float(const float* starts, const float* increments, std::size_t count, Steps steps,
+            float* values, std::uint64_t* success_mask)
+        {
+            const float32x4_t zero = vdupq_n_f32(0.0f);
+            const float32x4_t vmax = vdupq_n_f32(std::numeric_limits<float>::max());
+            const float32x4_t vlow = vdupq_n_f32(std::numeric_limits<float>::lowest());
+            const uint32x4_t all = vdupq_n_u32(0xFFFFFFFFu);
+
+            std::size_t i = 0;
+            for (; i + 4 <= count; i += 4)
+            {
+                float32x4_t v = vld1q_f32(starts + i);
+                const float32x4_t inc = vld1q_f32(increments + i);
+
+                // With per-lane counts the group walks for as long as its longest lane, and a lane only
+                // steps (and is only checked) while it still has steps left.
+                step_count_t walk_steps = 0;
+                uint32x4_t lane_steps = vdupq_n_u32(0);
+                std::uint64_t oversized = 0;
+                if constexpr (is_lane_steps<Steps>)
+                {
+                    const lane_step_group<4> group(steps + i, simd_float_step_limit);
+                    walk_steps = group.most;
+                    lane_steps = vld1q_u32(group.counts);
+                    oversized = group.oversized;
+                }
+                else
+                {
+                    walk_steps = steps;
+                }
+
+                // Same per-step checks as the stepwise loop, applied to 4 lanes at once.
+                const uint32x4_t pos = vcgtq_f32(inc, zero);
+                const uint32x4_t neg = vcltq_f32(inc, zero);
+                const float32x4_t th_pos = Subtract ? vaddq_f32(vlow, inc) : vsubq_f32(vmax, inc);
+                const float32x4_t th_neg = Subtract ? vaddq_f32(vmax, inc) : vsubq_f32(vlow, inc);
+
+                uint32x4_t active = all;
+                for (step_count_t step = 0; step < walk_steps; ++step)
+                {
+                    const uint32x4_t due = is_lane_steps<Steps> ? vcgtq_u32(lane_steps, vdupq_n_u32(static_cast<std::uint32_t>(step))) : all;
+                    const uint32x4_t fail = vandq_u32(due, Subtract
+                        ? vorrq_u32(vandq_u32(pos, vcltq_f32(v, th_pos)), vandq_u32(neg, vcgtq_f32(v, th_neg)))
+                        : vorrq_u32(vandq_u32(pos, vcgtq_f32(v, th_pos)), vandq_u32(neg, vcltq_f32(v, th_neg))));
+                    active = vbicq_u32(active, fail);
+                    const uint32x4_t stepping = vandq_u32(active, due);
+                    const float32x4_t next = vbslq_f32(stepping, Subtract ? vsubq_f32(v, inc) : vaddq_f32(v, inc), v);
+
+                    // Stop once no lane can change any more: every lane has failed or absorbed its increment.
+                    const uint32x4_t moving = vbicq_u32(stepping, vceqq_f32(next, v));
+                    v = next;
+                    if (vmaxvq_u32(moving) == 0)
+                    {
+                        break;
+                    }
+                }
+
+                vst1q_f32(values + i, v);
+                const std::uint64_t bits = neon_lane_bits(active) & ~oversized;
+                store_mask_bits(success_mask, i, bits);
+                if (oversized != 0)
+                {
+                    fix_failed_lanes<float, Subtract>(starts, increments, i, 4, bits | ~oversized, steps, values, success_mask);
+                }
+            }
+            return i;
+        }
+
+        template <bool Subtract, typename Steps>
+        static std::size_t simd_walk_double(const double* starts, const double* increments, std::size_t count, Steps steps,
+            double* values, std::uint64_t* success_mask)
+        {
+            const float64x2_t zero = vdupq_n_f64(0.0);
+            const float64x2_t vmax = vdupq_n_f64(std::numeric_limits<double>::max());
+            const float64x2_t vlow = vdupq_n_f64(std::numeric_limits<double>::lowest());
+            const uint64x2_t all = vdupq_n_u64(~0ull);
+
+            std::size_t i = 0;
+            for (; i + 2 <= count; i += 2)
+            {
+                float64x2_t v = vld1q_f64(starts + i);
+                const float64x2_t inc = vld1q_f64(increments + i);
+
+                step_count_t walk_steps = 0;
+                uint64x2_t lane_steps = vdupq_n_u64(0);
+                std::uint64_t oversized = 0;
+                if constexpr (is_lane_steps<Steps>)
+                {
+                    const lane_step_group<2> group(steps + i, simd_float_step_limit);
+                    walk_steps = group.most;
+                    lane_steps = vmovl_u32(vld1_u32(group.counts));
+                    oversized = group.oversized;
+                }
+                else
+                {
+                    walk_steps = steps;
+                }
+
+                const uint64x2_t pos = vcgtq_f64(inc, zero);
+                const uint64x2_t neg = vcltq_f64(inc, zero);
+                const float64x2_t th_pos = Subtract ? vaddq_f64(vlow, inc) : vsubq_f64(vmax, inc);
+                const float64x2_t th_neg = Subtract ? vaddq_f64(vmax, inc) : vsubq_f64(vlow, inc);
+
+                uint64x2_t active = all;
+                for (step_count_t step = 0; step < walk_steps; ++step)
+                {
+                    const uint64x2_t due = is_lane_steps<Steps> ? vcgtq_u64(lane_steps, vdupq_n_u64(step)) : all;
+                    const uint64x2_t fail = vandq_u64(due, Subtract
+                        ? vorrq_u64(vandq_u64(pos, vcltq_f64(v, th_pos)), vandq_u64(neg, vcgtq_f64(v, th_neg)))
+                        : vorrq_u64(vandq_u64(pos, vcgtq_f64(v, th_pos)), vandq_u64(neg, vcltq_f64(v, th_neg))));
+                    active = vbicq_u64(active, fail);
+                    const uint64x2_t stepping = vandq_u64(active, due);
+                    const float64x2_t next = vbslq_f64(stepping, Subtract ? vsubq_f64(v, inc) : vaddq_f64(v, inc), v);
+
+                    // Stop once no lane can change any more: every lane has failed or absorbed its increment.
+                    const uint64x2_t moving = vbicq_u64(stepping, vceqq_f64(next, v));
+                    v = next;
+                    if ((vgetq_lane_u64(moving, 0) | vgetq_lane_u64(moving, 1)) == 0)
+                    {
+                        break;
+                    }
+                }
+
+                vst1q_f64(values + i, v);
+                const std::uint64_t bits = ((vgetq_lane_u64(active, 0) & 1u) | ((vgetq_lane_u64(active, 1) & 1u) << 1)) & ~oversized;
+                store_mask_bits(success_mask, i, bits);
+                if (oversized != 0)
+                {
+                    fix_failed_lanes<double, Subtract>(starts, increments, i, 2, bits | ~oversized, steps, values, success_mask);
+                }
+            }
+            return i;
+        }
+    };
+
+#endif
+
+    template <typename T>
+    constexpr bool has_simd_kernel = is_int32_lane<T> || is_int64_lane<T>
+        || std::is_same<T, float>::value || std::is_same<T, double>::value;
+
+    template <typename T>
+    using simd_walk_fn = std::size_t (*)(const T*, const T*, std::size_t, step_count_t, T*, std::uint64_t*);
+
+    /// <summary>
+    /// Runs as many lanes as possible through the kernel for T in Kernels (one of the *_kernels above).
+    /// </summary>
+    /// <returns>The number of leading lanes handled; the rest are left for scalar_walk</returns>
+    template <typename Kernels, typename T, bool Subtract>
+    std::size_t simd_walk_with(const T* starts, const T* increments, std::size_t count, step_count_t steps,
+        T* values, std::uint64_t* success_mask)
+    {
+        // The integer kernels build 64-bit products from a 32-bit step count. Larger counts overflow
+        // every non-zero lane anyway, so they are left to the scalar engine.
+        const bool steps_fit_32 = steps <= 0xFFFFFFFFu;
+        // The float kernels take every step, while the scalar engine skips runs of identical steps,
+        // so long float walks are faster one lane at a time.
+        const bool float_steps_short = steps <= simd_float_step_limit;
+
+        if constexpr (is_int32_lane<T>)
+        {
+            return steps_fit_32 ? Kernels::template simd_walk_int32<T, Subtract>(starts, increments, count, static_cast<std::uint32_t>(steps), values, success_mask) : 0;
+        }
+        else if constexpr (is_int64_lane<T>)
+        {
+            return steps_fit_32 ? Kernels::template simd_walk_int64<T, Subtract>(starts, increments, count, static_cast<std::uint32_t>(steps), values, success_mask) : 0;
+        }
+        else if constexpr (std::is_same<T, float>::value)
+        {
+            return float_steps_short ? Kernels::template simd_walk_float<Subtract>(starts, increments, count, steps, values, success_mask) : 0;
+        }
+        else if constexpr (std::is_same<T, double>::value)
+        {
+            return float_steps_short ? Kernels::template simd_walk_double<Subtract>(starts, increments, count, steps, values, success_mask) : 0;
+        }
+        else
+        {
+            return 0;
+        }
+    }
+
+    template <typename T>
+    using simd_walk_lanes_fn = std::size_t (*)(const T*, const T*, const step_count_t*, std::size_t, T*, std::uint64_t*);
+
+    /// <summary>
+    /// simd_walk_with for per-lane step counts. The kernels check every lane's count themselves and hand
+    /// the ones they cannot take (over 32 bits, or long float walks) to the scalar engine.
+    /// </summary>
+    /// <returns>The number of leading lanes handled; the rest are left for the scalar templates</returns>
+    template <typename Kernels, typename T, bool Subtract>
+    std::size_t simd_walk_lanes_with(const T* starts, const T* increments, const step_count_t* steps, std::size_t count,
+        T* values, std::uint64_t* success_mask)
+    {
+        if constexpr (is_int32_lane<T>)
+        {
+            return Kernels::template simd_walk_int32<T, Subtract>(starts, increments, count, steps, values, success_mask);
+        }
+        else if constexpr (is_int64_lane<T>)
+        {
+            return Kernels::template simd_walk_int64<T, Subtract>(starts, increments, count, steps, values, success_mask);
+        }
+        else if constexpr (std::is_same<T, float>::value)
+        {
+            return Kernels::template simd_walk_float<Subtract>(starts, increments, count, steps, values, success_mask);
+        }
+        else if constexpr (std::is_same<T, double>::value)
+        {
+            return Kernels::template simd_walk_double<Subtract>(starts, increments, count, steps, values, success_mask);
+        }
+        else
+        {
+            return 0;
+        }
+    }
+
+    /// <summary>
+    /// The kernel for T on isa, nullptr when this build has none.
+    /// </summary>
+    template <typename T, bool Subtract>
+    simd_walk_fn<T> select_simd_walk(batch_isa isa)
+    {
+        switch (isa)
+        {
+#if defined(NUMERIC_BATCH_AVX512)
+        case batch_isa::avx512:
+            return &simd_walk_with<avx512_kernels, T, Subtract>;
+#endif
+#if defined(NUMERIC_BATCH_AVX2)
+        case batch_isa::avx2:
+            return &simd_walk_with<avx2_kernels, T, Subtract>;
+#endif
+#if defined(NUMERIC_BATCH_NEON)
+        case batch_isa::neon:
+            return &simd_walk_with<neon_kernels, T, Subtract>;
+#endif
+        default:
+            return nullptr;
+        }
+    }
+
+    /// <summary>
+    /// The per-lane step count kernel for T on isa, nullptr when this build has none.
+    /// </summary>
+    template <typename T, bool Subtract>
+    simd_walk_lanes_fn<T> select_simd_walk_lanes(batch_isa isa)
+    {
+        switch (isa)
+        {
+#if defined(NUMERIC_BATCH_AVX512)
+        case batch_isa::avx512:
+            return &simd_walk_lanes_with<avx512_kernels, T, Subtract>;
+#endif
+#if defined(NUMERIC_BATCH_AVX2)
+        case batch_isa::avx2:
+            return &simd_walk_lanes_with<avx2_kernels, T, Subtract>;
+#endif
+#if defined(NUMERIC_BATCH_NEON)
+        case batch_isa::neon:
+            return &simd_walk_lanes_with<neon_kernels, T, Subtract>;
+#endif
+        default:
+            return nullptr;
+        }
+    }
+
+    /// <summary>
+    /// Runs as many lanes as possible through the SIMD kernel for T that this CPU runs (see active_batch_isa()).
+    /// </summary>
+    /// <returns>The number of leading lanes handled; the rest are left for scalar_walk</returns>
+    template <typename T, bool Subtract>
+    std::size_t simd_walk(const T* starts, const T* increments, std::size_t count, step_count_t steps,
+        T* values, std::uint64_t* success_mask)
+    {
+        if constexpr (has_simd_kernel<T>)
+        {
+            static const simd_walk_fn<T> walk = select_simd_walk<T, Subtract>(active_batch_isa());
+            return walk != nullptr ? walk(starts, increments, count, steps, values, success_mask) : 0;
+        }
+        else
+        {
+            (void)starts; (void)increments; (void)count; (void)steps; (void)values; (void)success_mask;
+            return 0;
+        }
+    }
+
+    /// <summary>
+    /// simd_walk for per-lane step counts.
+    /// </summary>
+    /// <returns>The number of leading lanes handled; the rest are left for the scalar templates</returns>
+    template <typename T, bool Subtract>
+    std::size_t simd_walk_lanes(const T* starts, const T* increments, const step_count_t* steps, std::size_t count,
+        T* values, std::uint64_t* success_mask)
+    {
+        if constexpr (has_simd_kernel<T>)
+        {
+            static const simd_walk_lanes_fn<T> walk = select_simd_walk_lanes<T, Subtract>(active_batch_isa());
+            return walk != nullptr ? walk(starts, increments, steps, count, values, success_mask) : 0;
+        }
+        else
+        {
+            (void)starts; (void)increments; (void)steps; (void)count; (void)values; (void)success_mask;
+            return 0;
+        }
+    }
+
+    template <typename T, bool Subtract>
+    void batch_walk(const T* starts, const T* increments, std::size_t count, step_count_t steps,
+        T* values, std::uint64_t* success_mask)
+    {
+        clear_mask(success_mask, count);
+        const std::size_t done = simd_walk<T, Subtract>(starts, increments, count, steps, values, success_mask);
+        scalar_walk<T, Subtract>(starts, increments, done, count, steps, values, success_mask);
+    }
+
+    template <typename T, bool Subtract>
+    void batch_walk(const T* starts, const T* increments, const step_count_t* steps, std::size_t count,
+        T* values, std::uint64_t* success_mask)
+    {
+        clear_mask(success_mask, count);
+        const std::size_t done = simd_walk_lanes<T, Subtract>(starts, increments, steps, count, values, success_mask);
+        for (std::size_t i = done; i < count; ++i)
+        {
+            const CalcResult<T> r = scalar_lane<T, Subtract>(starts[i], increments[i], steps[i]);
+            values[i] = r.value;
+            if (r.success)
+            {
+                store_mask_bits(success_mask, i, 1u);
+            }
+        }
+    }
+
+    template <typename T>
+    constexpr bool is_small_int_lane = std::is_integral<T>::value && sizeof(T) <= 2 && !std::is_same<T, bool>::value;
+
+    template <typename T, bool Subtract>
+    CalcResult<T> saturating_lane(T const& start, T const& increment, step_count_t steps)
+    {
+        return Subtract ? subtract_numbers_saturating<T>(start, increment, steps) : add_numbers_saturating<T>(start, increment, steps);
+    }
+
+    /// <summary>
+    /// Scalar saturating lanes [first, count).
+    /// </summary>
+    template <typename T, bool Subtract>
+    void scalar_walk_saturating(const T* starts, const T* increments, std::size_t first, std::size_t count,
+        step_count_t steps, T* values, std::uint64_t* success_mask)
+    {
+        for (std::size_t i = first; i < count; ++i)
+        {
+            const CalcResult<T> r = saturating_lane<T, Subtract>(starts[i], increments[i], steps);
+            values[i] = r.value;
+            store_mask_bits(success_mask, i, r.success ? 1u : 0u);
+        }
+    }
+
+    /// <summary>
+    /// Replaces the last safe value of every failed lane in [0, count) with the limit it ran into.
+    /// </summary>
+    template <typename T, bool Subtract>
+    void saturate_failed_lanes(const T* increments, std::size_t count, T* values, const std::uint64_t* success_mask)
+    {
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const bool upward = Subtract ? increments[i] < T{ 0 } : increments[i] > T{ 0 };
+            const T limit = upward ? std::numeric_limits<T>::max() : std::numeric_limits<T>::lowest();
+            values[i] = batch_mask_test(success_mask, i) ? values[i] : limit;
+        }
+    }
+
+#if defined(NUMERIC_BATCH_AVX2)
+
+    /// <summary>
+    /// The single saturating step for 8-bit and 16-bit lanes on CPUs with AVX2.
+    /// </summary>
+    struct avx2_saturating_kernels
+    {
+        template <typename T, bool Subtract>
+        NUMERIC_TARGET_AVX2 static __m256i saturating_step_256(__m256i a, __m256i b)
+        {
+            if constexpr (sizeof(T) == 1)
+            {
+                if constexpr (std::is_signed<T>::value)
+                {
+                    return Subtract ? _mm256_subs_epi8(a, b) : _mm256_adds_epi8(a, b);
+                }
+                else
+                {
+                    return Subtract ? _mm256_subs_epu8(a, b) : _mm256_adds_epu8(a, b);
+                }
+            }
+            else
+            {
+                if constexpr (std::is_signed<T>::value)
+                {
+                    return Subtract ? _mm256_subs_epi16(a, b) : _mm256_adds_epi16(a, b);
+                }
+                else
+                {
+                    return Subtract ? _mm256_subs_epu16(a, b) : _mm256_adds_epu16(a, b);
+                }
+            }
+        }
+
+        /// <summary>
+        /// One saturating step for 8-bit and 16-bit lanes. A lane saturated exactly when its saturating
+        /// result differs from the wrapping one.
+        /// </summary>
+        /// <returns>The number of leading lanes handled</returns>
+        template <typename T, bool Subtract>
+        NUMERIC_TARGET_AVX2 static std::size_t simd_saturating_step_small(const T* starts, const T* increments, std::size_t count,
+            T* values, std::uint64_t* success_mask)
+        {
+            constexpr std::size_t lanes = 32 / sizeof(T);
+
+            std::size_t i = 0;
+            for (; i + lanes <= count; i += lanes)
+            {
+                const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(starts + i));
+                const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(increments + i));
+                const __m256i saturated = saturating_step_256<T, Subtract>(a, b);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(values + i), saturated);
+
+                std::uint64_t bits = 0;
+                if constexpr (sizeof(T) == 1)
+                {
+                    const __m256i wrapped = Subtract ? _mm256_sub_epi8(a, b) : _mm256_add_epi8(a, b);
+                    bits = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(saturated, wrapped)));
+                }
+                else
+                {
+                    // Packing to bytes leaves lanes 0-7 in mask bits 0-7 and lanes 8-15 in bits 16-23.
+                    const __m256i wrapped = Subtract ? _mm256_sub_epi16(a, b) : _mm256_add_epi16(a, b);
+                    const __m256i same = _mm256_packs_epi16(_mm256_cmpeq_epi16(saturated, wrapped), _mm256_setzero_si256());
+                    const std::uint32_t packed = static_cast<std::uint32_t>(_mm256_movemask_epi8(same));
+                    bits = (packed & 0xFFu) | ((packed >> 8) & 0xFF00u);
+                }
+                store_mask_bits(success_mask, i, bits);
+            }
+            return i;
+        }
+    };
+
+#endif
+
+    template <typename T, bool Subtract>
+    void batch_walk_saturating(const T* starts, const T* increments, std::size_t count, step_count_t steps,
+        T* values, std::uint64_t* success_mask)
+    {
+        clear_mask(success_mask, count);
+        std::size_t done = 0;
+        if constexpr (is_small_int_lane<T>)
+        {
+#if defined(NUMERIC_BATCH_AVX2)
+            // Every x86 CPU past scalar has AVX2, the AVX-512 ones included.
+            if (steps == 1 && active_batch_isa() != batch_isa::scalar)
+            {
+                done = avx2_saturating_kernels::simd_saturating_step_small<T, Subtract>(starts, increments, count, values, success_mask);
+            }
+#endif
+        }
+        else
+        {
+            // The ordinary kernels stop failed lanes at their last safe value; those are then clamped.
+            done = simd_walk<T, Subtract>(starts, increments, count, steps, values, success_mask);
+            saturate_failed_lanes<T, Subtract>(increments, done, values, success_mask);
+        }
+        scalar_walk_saturating<T, Subtract>(starts, increments, done, count, steps, values, success_mask);
+    }
+
+    template <typename T, bool Subtract>
+    void batch_walk_saturating(const T* starts, const T* increments, const step_count_t* steps, std::size_t count,
+        T* values, std::uint64_t* success_mask)
+    {
+        clear_mask(success_mask, count);
+        std::size_t done = 0;
+        if constexpr (!is_small_int_lane<T>)
+        {
+            done = simd_walk_lanes<T, Subtract>(starts, increments, steps, count, values, success_mask);
+            saturate_failed_lanes<T, Subtract>(increments, done, values, success_mask);
+        }
+        for (std::size_t i = done; i < count; ++i)
+        {
+            const CalcResult<T> r = saturating_lane<T, Subtract>(starts[i], increments[i], steps[i]);
+            values[i] = r.value;
+            store_mask_bits(success_mask, i, r.success ? 1u : 0u);
+        }
+    }
+}
+
+
+/// <summary>
+/// Batch form of add_numbers with one step count shared by every lane:
+///   values[i] = starts[i] + (increments[i] * steps)
+/// </summary>
+/// <typeparam name="T">Any type add_numbers accepts</typeparam>
+/// <param name="starts">count starting values</param>
+/// <param name="increments">count increments, one per lane</param>
+/// <param name="count">The number of lanes</param>
+/// <param name="steps">The number of steps every lane takes</param>
+/// <param name="values">Receives count results (or last safe values)</param>
+/// <param name="success_mask">Receives batch_mask_words(count) words of success bits</param>
+template <typename T>
+void add_numbers_batch(const T* starts, const T* increments, std::size_t count, step_count_t steps,
+    T* values, std::uint64_t* success_mask)
+{
+    numeric_batch_detail::batch_walk<T, false>(starts, increments, count, steps, values, success_mask);
+}
+
+/// <summary>
+/// Batch form of add_numbers with a step count per lane:
+///   values[i] = starts[i] + (increments[i] * steps[i])
+/// </summary>
+template <typename T>
+void add_numbers_batch(const T* starts, const T* increments, const step_count_t* steps, std::size_t count,
+    T* values, std::uint64_t* success_mask)
+{
+    numeric_batch_detail::batch_walk<T, false>(starts, increments, steps, count, values, success_mask);
+}
+
+/// <summary>
+/// Batch form of subtract_numbers with one step count shared by every lane:
+///   values[i] = starts[i] - (decrements[i] * steps)
+/// </summary>
+/// <typeparam name="T">Any type subtract_numbers accepts</typeparam>
+/// <param name="starts">count starting values</param>
+/// <param name="decrements">count decrements, one per lane</param>
+/// <param name="count">The number of lanes</param>
+/// <param name="steps">The number of steps every lane takes</param>
+/// <param name="values">Receives count results (or last safe values)</param>
+/// <param name="success_mask">Receives batch_mask_words(count) words of success bits</param>
+template <typename T>
+void subtract_numbers_batch(const T* starts, const T* decrements, std::size_t count, step_count_t steps,
+    T* values, std::uint64_t* success_mask)
+{
+    numeric_batch_detail::batch_walk<T, true>(starts, decrements, count, steps, values, success_mask);
+}
+
+/// <summary>
+/// Batch form of subtract_numbers with a step count per lane:
+///   values[i] = starts[i] - (decrements[i] * steps[i])
+/// </summary>
+template <typename T>
+void subtract_numbers_batch(const T* starts, const T* decrements, const step_count_t* steps, std::size_t count,
+    T* values, std::uint64_t* success_mask)
+{
+    numeric_batch_detail::batch_walk<T, true>(starts, decrements, steps, count, values, success_mask);
+}
+
+/// <summary>
+/// add_numbers_batch writing into a CalcResultBlock, which is resized to count (reusing its capacity).
+/// </summary>
+template <typename T>
+void add_numbers_batch(const T* starts, const T* increments, std::size_t count, step_count_t steps,
+    CalcResultBlock<T>& out)
+{
+    out.resize(count);
+    add_numbers_batch<T>(starts, increments, count, steps, out.values(), out.success_mask());
+}
+
+/// <summary>
+/// add_numbers_batch with per-lane step counts, writing into a CalcResultBlock.
+/// </summary>
+template <typename T>
+void add_numbers_batch(const T* starts, const T* increments, const step_count_t* steps, std::size_t count,
+    CalcResultBlock<T>& out)
+{
+    out.resize(count);
+    add_numbers_batch<T>(starts, increments, steps, count, out.values(), out.success_mask());
+}
+
+/// <summary>
+/// subtract_numbers_batch writing into a CalcResultBlock, which is resized to count (reusing its capacity).
+/// </summary>
+template <typename T>
+void subtract_numbers_batch(const T* starts, const T* decrements, std::size_t count, step_count_t steps,
+    CalcResultBlock<T>& out)
+{
+    out.resize(count);
+    subtract_numbers_batch<T>(starts, decrements, count, steps, out.values(), out.success_mask());
+}
+
+/// <summary>
+/// subtract_numbers_batch with per-lane step counts, writing into a CalcResultBlock.
+/// </summary>
+template <typename T>
+void subtract_numbers_batch(const T* starts, const T* decrements, const step_count_t* steps, std::size_t count,
+    CalcResultBlock<T>& out)
+{
+    out.resize(count);
+    subtract_numbers_batch<T>(starts, decrements, steps, count, out.values(), out.success_mask());
+}
+
+/// <summary>
+/// Batch form of add_numbers_saturating with one step count shared by every lane:
+///   values[i] = starts[i] + (increments[i] * steps), clamped to the range of T
+/// </summary>
+/// <typeparam name="T">Any type add_numbers accepts</typeparam>
+/// <param name="starts">count starting values</param>
+/// <param name="increments">count increments, one per lane</param>
+/// <param name="count">The number of lanes</param>
+/// <param name="steps">The number of steps every lane takes</param>
+/// <param name="values">Receives count results (or the limit a lane saturated at)</param>
+/// <param name="success_mask">Receives batch_mask_words(count) words of success bits (0 = saturated)</param>
+template <typename T>
+void add_numbers_saturating_batch(const T* starts, const T* increments, std::size_t count, step_count_t steps,
+    T* values, std::uint64_t* success_mask)
+{
+    numeric_batch_detail::batch_walk_saturating<T, false>(starts, increments, count, steps, values, success_mask);
+}
+
+/// <summary>
+/// Batch form of add_numbers_saturating with a step count per lane:
+///   values[i] = starts[i] + (increments[i] * steps[i]), clamped to the range of T
+/// </summary>
+template <typename T>
+void add_numbers_saturating_batch(const T* starts, const T* increments, const step_count_t* steps, std::size_t count,
+    T* values, std::uint64_t* success_mask)
+{
+    numeric_batch_detail::batch_walk_saturating<T, false>(starts, increments, steps, count, values, success_mask);
+}
+
+/// <summary>
+/// add_numbers_saturating_batch writing into a CalcResultBlock, which is resized to count (reusing its capacity).
+/// </summary>
+template <typename T>
+void add_numbers_saturating_batch(const T* starts, const T* increments, std::size_t count, step_count_t steps,
+    CalcResultBlock<T>& out)
+{
+    out.resize(count);
+    add_numbers_saturating_batch<T>(starts, increments, count, steps, out.values(), out.success_mask());
+}
+
+/// <summary>
+/// add_numbers_saturating_batch with per-lane step counts, writing into a CalcResultBlock.
+/// </summary>
+template <typename T>
+void add_numbers_saturating_batch(const T* starts, const T* increments, const step_count_t* steps, std::size_t count,
+    CalcResultBlock<T>& out)
+{
+    out.resize(count);
+    add_numbers_saturating_batch<T>(starts, increments, steps, count, out.values(), out.success_mask());
+}
+
+/// <summary>
+/// Batch form of subtract_numbers_saturating with one step count shared by every lane:
+///   values[i] = starts[i] - (decrements[i] * steps), clamped to the range of T
+/// </summary>
+/// <typeparam name="T">Any type subtract_numbers accepts</typeparam>
+/// <param name="starts">count starting values</param>
+/// <param name="decrements">count decrements, one per lane</param>
+/// <param name="count">The number of lanes</param>
+/// <param name="steps">The number of steps every lane takes</param>
+/// <param name="values">Receives count results (or the limit a lane saturated at)</param>
+/// <param name="success_mask">Receives batch_mask_words(count) words of success bits (0 = saturated)</param>
+template <typename T>
+void subtract_numbers_saturating_batch(const T* starts, const T* decrements, std::size_t count, step_count_t steps,
+    T* values, std::uint64_t* success_mask)
+{
+    numeric_batch_detail::batch_walk_saturating<T, true>(starts, decrements, count, steps, values, success_mask);
+}
+
+/// <summary>
+/// Batch form of subtract_numbers_saturating with a step count per lane:
+///   values[i] = starts[i] - (decrements[i] * steps[i]), clamped to the range of T
+/// </summary>
+template <typename T>
+void subtract_numbers_saturating_batch(const T* starts, const T* decrements, const step_count_t* steps, std::size_t count,
+    T* values, std::uint64_t* success_mask)
+{
+    numeric_batch_detail::batch_walk_saturating<T, true>(starts, decrements, steps, count, values, success_mask);
+}
+
+/// <summary>
+/// subtract_numbers_saturating_batch writing into a CalcResultBlock, which is resized to count (reusing its capacity).
+/// </summary>
+template <typename T>
+void subtract_numbers_saturating_batch(const T* starts, const T* decrements, std::size_t count, step_count_t steps,
+    CalcResultBlock<T>& out)
+{
+    out.resize(count);
+    subtract_numbers_saturating_batch<T>(starts, decrements, count, steps, out.values(), out.success_mask());
+}
+
+/// <summary>
+/// subtract_numbers_saturating_batch with per-lane step counts, writing into a CalcResultBlock.
+/// </summary>
+template <typename T>
+void subtract_numbers_saturating_batch(const T* starts, const T* decrements, const step_count_t* steps, std::size_t count,
+    CalcResultBlock<T>& out)
+{
+    out.resize(count);
+    subtract_numbers_saturating_batch<T>(starts, decrements, steps, count, out.values(), out.success_mask());
+}
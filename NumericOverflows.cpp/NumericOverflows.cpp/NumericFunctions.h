@@ -0,0 +1,746 @@
+// NumericFunctions.h : The overflow-safe add_numbers / subtract_numbers templates used by NumericOverflows.cpp.
+//
+// Both are built on OverflowGuard, which prepares the checks for one increment and step count. Integer
+// types are handled by a closed-form engine that works out start +/- (increment * steps) with one checked
+// multiply and one compare, instead of walking every step. How that multiply is checked
+// is picked by the Backend template parameter (see CheckedArithmetic.h). Floating point types keep the
+// step-by-step loop because every += rounds, so the closed form would not give the same value, but long
+// runs of steps that provably round the same way are taken in one exact add.
+// Everything here is constexpr, so results can also be worked out (and static_assert'ed) at compile time.
+// Step counts are 64 bits (step_count_t); GCC and Clang also get unsigned __int128 overloads.
+// add_numbers_saturating / subtract_numbers_saturating clamp to the limits instead of stopping early.
+// Built with NUMERIC_STATS=1, add_numbers / subtract_numbers also count every call (see NumericStats.h).
+// Types that are not built-in arithmetic types are described by overflow_traits (OverflowTraits.h): they
+// run on their own checked_fma when they have one and on the stepwise loop otherwise.
+
+#pragma once
+
+#include <cmath>        // std::frexp, std::ldexp, std::floor, std::fabs, std::fmax, std::isfinite
+#include <cstdint>      // std::uint64_t
+#include <limits>       // std::numeric_limits
+#include <type_traits>  // std::is_integral, std::is_arithmetic, std::make_unsigned, std::enable_if_t
+
+#include "CalcResult.h"
+#include "CheckedArithmetic.h"
+#include "NumericStats.h"
+#include "OverflowTraits.h"
+
+
+
+/// <summary>
+/// Reference implementation of start + (increment * steps).
+/// Checks the limits before every single add and stops at the last safe value.
+/// Cost grows linearly with steps; add_numbers only uses it for types overflow_traits gives no faster path.
+/// </summary>
+/// <typeparam name="T">A type that with basic math functions</typeparam>
+/// <param name="start">The number to start with</param>
+/// <param name="increment">How much to add each step</param>
+/// <param name="steps">The number of steps to iterate</param>
+/// <returns>start + (increment * steps), or the last safe value with success = false</returns>
+template <typename T>
+constexpr CalcResult<T> add_numbers_stepwise(T const& start, T const& increment, step_count_t const& steps)
+{
+    CalcResult<T> out{};   // holds both the running total and a success/failure flag
+    out.value = start;     // start the running total at the starting value
+
+    for (step_count_t i = 0; i < steps; ++i)
+    {
+        // grab the valid range for this type (int, unsigned, float, etc.)
+        // so we can check limits before we change the value.
+        const T maxVal = overflow_traits<T>::max();
+        const T lowVal = overflow_traits<T>::lowest(); // the lowest value this type can hold
+
+        // Check *before* we add.
+        // If the next add would push us past the type's limits, we stop early and report failure.
+        if (increment > overflow_traits<T>::zero())
+        {
+            // Positive increment: would we go above max?
+            if (out.value > (maxVal - increment))
+            {
+                out.success = false; // tell the caller we prevented an overflow
+                out.failed_at_step = i;
+                return out;          // return the last safe value
+            }
+        }
+        else if (increment < overflow_traits<T>::zero())
+        {
+            // Negative increment: would we go below the lowest value?
+            if (out.value < (lowVal - increment))
+            {
+                out.success = false; // tell the caller we prevented an underflow
+                out.failed_at_step = i;
+                return out;          // return the last safe value
+            }
+        }
+
+        out.value += increment; // safe to add now (we already checked the limits)
+    }
+
+    return out; // return both the final value and whether it completed safely
+}
+
+
+/// <summary>
+/// Reference implementation of start - (increment * steps).
+/// Checks the limits before every single subtract and stops at the last safe value.
+/// Cost grows linearly with steps; subtract_numbers only uses it for types overflow_traits gives no faster path.
+/// </summary>
+/// <typeparam name="T">A type that with basic math functions</typeparam>
+/// <param name="start">The number to start with</param>
+/// <param name="decrement">How much to subtract each step</param>
+/// <param name="steps">The number of steps to iterate</param>
+/// <returns>start - (increment * steps), or the last safe value with success = false</returns>
+template <typename T>
+constexpr CalcResult<T> subtract_numbers_stepwise(T const& start, T const& decrement, step_count_t const& steps)
+{
+    CalcResult<T> out{};   // holds both the running total and a success/failure flag
+    out.value = start;     // start the running total at the starting value
+
+    for (step_count_t i = 0; i < steps; ++i)
+    {
+        // grab the valid range for this type (int, unsigned, float, etc.)
+        // so we can check limits before we change the value.
+        const T maxVal = overflow_traits<T>::max();
+        const T lowVal = overflow_traits<T>::lowest();
+
+        // Check *before* we subtract.
+        // If the next subtract would push us past the type's limits, we stop early and report failure.
+        // This prevents the underflow/overflow from ever happening.
+        if (decrement > overflow_traits<T>::zero())
+        {
+            // Positive decrement: would we go below the lowest value?
+            if (out.value < (lowVal + decrement))
+            {
+                out.success = false; // tell the caller we prevented an underflow
+                out.failed_at_step = i;
+                return out;          // return the last safe value
+            }
+        }
+        else if (decrement < overflow_traits<T>::zero())
+        {
+            // Negative decrement: subtracting a negative is the same as adding.
+            // Would that push us above max?
+            if (out.value > (maxVal + decrement)) // decrement is negative here
+            {
+                out.success = false; // tell the caller we prevented an overflow
+                out.failed_at_step = i;
+                return out;          // return the last safe value
+            }
+        }
+
+        out.value -= decrement; // safe to subtract now (we already checked the limits)
+    }
+
+    return out; // return both the final value and whether it completed safely
+}
+
+
+namespace numeric_detail
+{
+    // Unsigned type used for the closed-form math. Small types (char, short) are widened to
+    // unsigned int so the arithmetic never gets promoted to a signed int behind our back.
+    // Floating point types never use it, they just get a placeholder.
+    template <typename T, bool = std::is_integral<T>::value>
+    struct work_unsigned
+    {
+        using type = unsigned int;
+    };
+
+    template <typename T>
+    struct work_unsigned<T, true>
+    {
+        using type = std::common_type_t<std::make_unsigned_t<T>, unsigned int>;
+    };
+
+    template <typename T>
+    using work_unsigned_t = typename work_unsigned<T>::type;
+}
+
+
+/// <summary>
+/// Overflow checks for one increment (or decrement) and step count, prepared once and reused
+/// for as many starting values as needed. The limits, the step size and the distance the walk
+/// covers are all worked out in the constructor, so checking a start is a single compare.
+///
+/// Integer types use the closed form: the whole walk is one compare against a precomputed
+/// threshold, and only a walk that fails pays one division to find its last safe value.
+/// Floating point types keep the stepwise loop, but with the per-step threshold hoisted out,
+/// runs of steps that round identically taken in one add (skip_ahead), and an early stop
+/// (reporting precision_lost) once the increment is absorbed by the value.
+/// </summary>
+/// <typeparam name="T">A type that with basic math functions</typeparam>
+/// <typeparam name="Backend">How the integer multiply is checked (portable_backend, intrinsic_backend or wide_backend)</typeparam>
+template <typename T, typename Backend = default_backend>
+class OverflowGuard
+{
+public:
+    /// <summary>
+    /// Prepares the checks for start + (increment * steps).
+    /// </summary>
+    static constexpr OverflowGuard adding(T const& increment, step_count_t steps)
+    {
+        return OverflowGuard(increment, steps, false);
+    }
+
+    /// <summary>
+    /// Prepares the checks for start - (decrement * steps).
+    /// </summary>
+    static constexpr OverflowGuard subtracting(T const& decrement, step_count_t steps)
+    {
+        return OverflowGuard(decrement, steps, true);
+    }
+
+    /// <summary>
+    /// true when taking one more step from value stays inside the range of T.
+    /// This is the check the stepwise loop makes before every step.
+    /// </summary>
+    constexpr bool step_fits(T const& value) const
+    {
+        // Written as !(a > b) rather than a <= b so a NaN value behaves like the stepwise loop.
+        return direction_ == walk_direction::up ? !(value > step_threshold_)
+            : direction_ == walk_direction::down ? !(value < step_threshold_)
+            : true;
+    }
+
+    /// <summary>
+    /// true when every step from start stays inside the range of T (apply(start).success).
+    /// A single compare for integer types; floating point types have to walk the steps.
+    /// </summary>
+    constexpr bool fits(T const& start) const
+    {
+        if constexpr (std::is_integral<T>::value)
+        {
+            return direction_ == walk_direction::none
+                || (walk_fits_ && (direction_ == walk_direction::up ? start <= walk_threshold_ : start >= walk_threshold_));
+        }
+        else
+        {
+            return apply(start).success;
+        }
+    }
+
+    /// <summary>
+    /// Runs the prepared operation from start.
+    /// </summary>
+    /// <returns>The result, or the last safe value with success = false</returns>
+    constexpr CalcResult<T> apply(T const& start) const
+    {
+        if constexpr (std::is_integral<T>::value)
+        {
+            const U ustart = static_cast<U>(start);
+
+            // Common case: the whole walk fits, so the total distance was already worked out.
+            if (fits(start))
+            {
+                const U moved = direction_ == walk_direction::none ? U{ 0 } : total_;
+                return CalcResult<T>{ static_cast<T>(direction_ == walk_direction::down ? static_cast<U>(ustart - moved) : static_cast<U>(ustart + moved)), true };
+            }
+
+            // The walk would leave the range, so work out how many whole steps still fit
+            // and stop on that last safe value, the same place the stepwise loop stops.
+            // taken < steps here, so it also fits in failed_at_step. The true distance to the
+            // limit always fits in U, and unsigned wrap-around gives it to us even for negative starts.
+            const bool upward = direction_ == walk_direction::up;
+            const U room = upward
+                ? static_cast<U>(static_cast<U>(std::numeric_limits<T>::max()) - ustart)
+                : static_cast<U>(ustart - static_cast<U>(std::numeric_limits<T>::lowest()));
+            const U taken = static_cast<U>(room / magnitude_);
+            const U moved = static_cast<U>(magnitude_ * taken);
+
+            CalcResult<T> out{};
+            out.value = static_cast<T>(upward ? static_cast<U>(ustart + moved) : static_cast<U>(ustart - moved));
+            out.success = false;
+            out.failed_at_step = static_cast<step_count_t>(taken);
+            return out;
+        }
+        else
+        {
+            CalcResult<T> out{};
+            out.value = start;
+
+            step_count_t next_skip = 0; // the step at which skip_ahead is tried again after coming up empty
+            for (step_count_t i = 0; i < steps_; )
+            {
+                if (!step_fits(out.value))
+                {
+                    out.success = false;
+                    out.failed_at_step = i;
+                    return out;
+                }
+
+                const T next = subtract_ ? out.value - increment_ : out.value + increment_;
+
+                // Once the value is large enough that adding the increment no longer changes it, every
+                // remaining step would pass the same check and leave it where it is, so stop here.
+                // next (not out.value) is kept: for signed zeros the first step can still flip -0 to +0,
+                // and next is then the value the loop would settle on.
+                if (next == out.value)
+                {
+                    out.value = next;
+                    out.precision_lost = increment_ != T{ 0 };
+                    return out;
+                }
+
+                // A NaN stays NaN and passes every check, so the remaining steps cannot change anything.
+                if (next != next)
+                {
+                    out.value = next;
+                    return out;
+                }
+
+                out.value = next;
+                ++i;
+
+                // Most of a long walk adds the same rounded amount over and over; skip those runs in one add.
+                if (!NUMERIC_IS_CONSTANT_EVALUATED() && i >= next_skip && steps_ - i >= skip_ahead_min_steps)
+                {
+                    const step_count_t skipped = skip_ahead(out.value, steps_ - i);
+                    i += skipped;
+                    if (skipped == 0)
+                    {
+                        next_skip = i + skip_ahead_retry_steps;
+                    }
+                }
+            }
+
+            return out;
+        }
+    }
+
+    /// <summary>
+    /// Runs the prepared operation from start, clamping to max() / lowest() instead of stopping at the
+    /// last safe value. For integer types this is branch-free: both outcomes are worked out and one is
+    /// selected, which compilers turn into conditional moves.
+    /// </summary>
+    /// <returns>The result with success = true, or the limit that was hit with success = false.
+    /// failed_at_step is not worked out (always 0), since the walk is not stopped.</returns>
+    constexpr CalcResult<T> apply_saturating(T const& start) const
+    {
+        const bool upward = direction_ == walk_direction::up;
+        const T limit = upward ? std::numeric_limits<T>::max() : std::numeric_limits<T>::lowest();
+
+        CalcResult<T> out{};
+        if constexpr (std::is_integral<T>::value)
+        {
+            // total_ is 0 for a walk that does not move, and meaningless (but harmless) when it does not fit.
+            // The conditions are combined with & and | rather than && and ||, which would be jumps.
+            const U ustart = static_cast<U>(start);
+            const bool within = (upward & !(start > walk_threshold_)) | (!upward & !(start < walk_threshold_));
+            const bool fits = (direction_ == walk_direction::none) | (walk_fits_ & within);
+            const U up_value = static_cast<U>(ustart + total_);
+            const U down_value = static_cast<U>(ustart - total_);
+            const T moved = static_cast<T>(upward ? up_value : down_value);
+            out.value = fits ? moved : limit;
+            out.success = fits;
+        }
+        else
+        {
+            const CalcResult<T> r = apply(start);
+            out.value = r.success ? r.value : limit;
+            out.success = r.success;
+            out.precision_lost = r.precision_lost;
+        }
+        return out;
+    }
+
+private:
+    using U = numeric_detail::work_unsigned_t<T>;
+
+    // Which limit the value moves towards. none covers a zero (or NaN) increment and zero steps.
+    enum class walk_direction { none, up, down };
+
+    // (floating point) Walks with fewer steps left than this just keep stepping, and a skip_ahead
+    // that finds nothing to skip is not tried again for this many steps.
+    static constexpr step_count_t skip_ahead_min_steps = 64;
+    static constexpr step_count_t skip_ahead_retry_steps = 16;
+
+    /// <summary>
+    /// (floating point) Moves value past the next steps that provably each add the same amount and pass
+    /// their check, and returns how many steps that was (0 when none can be proven).
+    /// Every value in one binade is a multiple of the same ulp, so value + increment rounds to
+    /// value + k * ulp for a fixed k while the exact sum stays inside that binade and is not a tie.
+    /// n of those steps are then a single exact add of n * k * ulp. Assumes round-to-nearest.
+    /// </summary>
+    step_count_t skip_ahead(T& value, step_count_t left) const
+    {
+        const T delta = subtract_ ? -increment_ : increment_;
+        if (value == T{ 0 } || !std::isfinite(value) || !std::isfinite(delta))
+        {
+            return 0;
+        }
+
+        // magnitude is in [2^(exponent - 1), 2^exponent); subnormals are spaced by denorm_min.
+        constexpr int digits = std::numeric_limits<T>::digits;
+        const T magnitude = std::fabs(value);
+        int exponent = 0;
+        std::frexp(magnitude, &exponent);
+        const T ulp = std::fmax(std::ldexp(T{ 1 }, exponent - digits), std::numeric_limits<T>::denorm_min());
+
+        // The increment measured in ulps, and the whole number of ulps each step really adds.
+        const T ratio = std::fabs(delta) / ulp;
+        if (!(ratio < std::ldexp(T{ 1 }, digits - 1)))
+        {
+            return 0;
+        }
+        const T whole = std::floor(ratio);
+        const T fraction = ratio - whole;
+        if (fraction == T{ 0.5 })
+        {
+            return 0; // ties round to even, so the amount added alternates
+        }
+        const T k = fraction > T{ 0.5 } ? whole + 1 : whole;
+        if (k == T{ 0 })
+        {
+            return 0; // absorbed, the next step ends the walk
+        }
+
+        // How many ulps the value can move before the exact sum could reach the edge of the binade
+        // (kept a full ulp clear), and before the check would fail. Both are rounded, so a few
+        // steps are held back as margin and left to the normal loop.
+        const T units = magnitude / ulp;
+        const bool outward = (value > T{ 0 }) == (delta > T{ 0 });
+        const T binade_room = outward
+            ? std::ldexp(T{ 1 }, exponent) / ulp - units - ratio - 1
+            : units - std::ldexp(T{ 1 }, exponent - 1) / ulp - ratio - 1;
+        const T stride = k * ulp;
+        const T check_room = direction_ == walk_direction::up ? step_threshold_ - value : value - step_threshold_;
+
+        T runs = std::floor(binade_room / k) - 2;
+        const T check_runs = std::floor(check_room / stride) - 1;
+        if (check_runs < runs)
+        {
+            runs = check_runs;
+        }
+        if (!(runs > T{ 0 }))
+        {
+            return 0;
+        }
+
+        // runs < 2^(digits - 1), so it converts exactly and n * stride stays an exact multiple of ulp.
+        const step_count_t n = static_cast<step_count_t>(runs) < left ? static_cast<step_count_t>(runs) : left;
+        const T moved = static_cast<T>(n) * stride;
+        value = delta > T{ 0 } ? value + moved : value - moved;
+        return n;
+    }
+
+    constexpr OverflowGuard(T const& increment, step_count_t steps, bool subtract)
+        : increment_(increment), steps_(steps), subtract_(subtract)
+    {
+        const T maxVal = std::numeric_limits<T>::max();
+        const T lowVal = std::numeric_limits<T>::lowest();
+
+        // Subtracting a negative amount moves up, the same as adding a positive one.
+        const bool positive = increment > T{ 0 };
+        const bool negative = increment < T{ 0 };
+        if (steps == 0 && std::is_integral<T>::value)
+        {
+            direction_ = walk_direction::none;
+        }
+        else if (positive)
+        {
+            direction_ = subtract ? walk_direction::down : walk_direction::up;
+        }
+        else if (negative)
+        {
+            direction_ = subtract ? walk_direction::up : walk_direction::down;
+        }
+
+        if constexpr (std::is_integral<T>::value)
+        {
+            if (direction_ == walk_direction::none)
+            {
+                return;
+            }
+
+            // 0 - increment in unsigned math is the magnitude of a negative increment, lowest() included.
+            magnitude_ = positive ? static_cast<U>(increment) : static_cast<U>(U{ 0 } - static_cast<U>(increment));
+
+            const U umax = static_cast<U>(maxVal);
+            const U ulow = static_cast<U>(lowVal);
+            step_threshold_ = direction_ == walk_direction::up
+                ? static_cast<T>(static_cast<U>(umax - magnitude_))
+                : static_cast<T>(static_cast<U>(ulow + magnitude_));
+
+            // The walk can only fit if its total distance fits inside the whole range of T.
+            // Then it fits from any start at or before walk_threshold_.
+            const U range = static_cast<U>(umax - ulow);
+            walk_fits_ = Backend::walk_fits(magnitude_, steps, range, total_);
+            if (walk_fits_)
+            {
+                walk_threshold_ = direction_ == walk_direction::up
+                    ? static_cast<T>(static_cast<U>(umax - total_))
+                    : static_cast<T>(static_cast<U>(ulow + total_));
+            }
+        }
+        else
+        {
+            // Hoisted copies of the limits the stepwise loop compares against on every step.
+            if (subtract)
+            {
+                step_threshold_ = positive ? lowVal + increment : maxVal + increment;
+            }
+            else
+            {
+                step_threshold_ = positive ? maxVal - increment : lowVal - increment;
+            }
+        }
+    }
+
+    T increment_{};
+    step_count_t steps_{ 0 };
+    bool subtract_{ false };
+    walk_direction direction_{ walk_direction::none };
+
+    T step_threshold_{};   // one more step is unsafe past this value
+    T walk_threshold_{};   // (integers) the whole walk is unsafe past this start
+    U magnitude_{ 0 };     // (integers) the size of one step
+    U total_{ 0 };         // (integers) magnitude * steps, valid when walk_fits_
+    bool walk_fits_{ false };
+};
+
+
+namespace numeric_detail
+{
+    /// <summary>
+    /// start + (amount * steps), or start - (amount * steps) when Subtract, on the fastest engine T has:
+    /// its overflow_traits checked_fma, OverflowGuard for the built-in arithmetic types, else the stepwise loop.
+    /// </summary>
+    template <typename T, typename Backend, bool Subtract>
+    constexpr CalcResult<T> walk(T const& start, T const& amount, step_count_t steps)
+    {
+        if constexpr (overflow_traits<T>::has_checked_fma)
+        {
+            return overflow_traits<T>::checked_fma(start, amount, steps, Subtract);
+        }
+        else if constexpr (std::is_arithmetic<T>::value)
+        {
+            return Subtract
+                ? OverflowGuard<T, Backend>::subtracting(amount, steps).apply(start)
+                : OverflowGuard<T, Backend>::adding(amount, steps).apply(start);
+        }
+        else
+        {
+            return Subtract ? subtract_numbers_stepwise<T>(start, amount, steps) : add_numbers_stepwise<T>(start, amount, steps);
+        }
+    }
+
+    /// <summary>
+    /// walk with the saturating policy: OverflowGuard's branch-free form for the built-in arithmetic types,
+    /// otherwise a failed walk is replaced by the limit it was stopped at.
+    /// </summary>
+    template <typename T, typename Backend, bool Subtract>
+    constexpr CalcResult<T> walk_saturating(T const& start, T const& amount, step_count_t steps)
+    {
+        if constexpr (std::is_arithmetic<T>::value && !overflow_traits<T>::has_checked_fma)
+        {
+            return Subtract
+                ? OverflowGuard<T, Backend>::subtracting(amount, steps).apply_saturating(start)
+                : OverflowGuard<T, Backend>::adding(amount, steps).apply_saturating(start);
+        }
+        else
+        {
+            CalcResult<T> out = walk<T, Backend, Subtract>(start, amount, steps);
+            if (!out.success)
+            {
+                const bool upward = (amount > overflow_traits<T>::zero()) != Subtract;
+                out.value = upward ? overflow_traits<T>::max() : overflow_traits<T>::lowest();
+                out.failed_at_step = 0;
+            }
+            return out;
+        }
+    }
+}
+
+
+/// <summary>
+/// Template function to abstract away the logic of:
+///   start + (increment * steps)
+/// </summary>
+/// <typeparam name="T">A type that with basic math functions</typeparam>
+/// <typeparam name="Backend">How the integer multiply is checked (portable_backend, intrinsic_backend or wide_backend)</typeparam>
+/// <param name="start">The number to start with</param>
+/// <param name="increment">How much to add each step</param>
+/// <param name="steps">The number of steps to iterate</param>
+/// <returns>start + (increment * steps), or the last safe value with success = false</returns>
+template <typename T, typename Backend = default_backend>
+constexpr CalcResult<T> add_numbers(T const& start, T const& increment, step_count_t const& steps)
+{
+#if NUMERIC_STATS_ENABLED
+    if (!NUMERIC_IS_CONSTANT_EVALUATED())
+    {
+        return numeric_stats::measure<T>(!(increment < overflow_traits<T>::zero()),
+            [&]() { return numeric_detail::walk<T, Backend, false>(start, increment, steps); });
+    }
+#endif
+    return numeric_detail::walk<T, Backend, false>(start, increment, steps);
+}
+
+
+/// <summary>
+/// Template function to abstract away the logic of:
+///   start - (increment * steps)
+/// </summary>
+/// <typeparam name="T">A type that with basic math functions</typeparam>
+/// <typeparam name="Backend">How the integer multiply is checked (portable_backend, intrinsic_backend or wide_backend)</typeparam>
+/// <param name="start">The number to start with</param>
+/// <param name="decrement">How much to subtract each step</param>
+/// <param name="steps">The number of steps to iterate</param>
+/// <returns>start - (increment * steps), or the last safe value with success = false</returns>
+template <typename T, typename Backend = default_backend>
+constexpr CalcResult<T> subtract_numbers(T const& start, T const& decrement, step_count_t const& steps)
+{
+#if NUMERIC_STATS_ENABLED
+    if (!NUMERIC_IS_CONSTANT_EVALUATED())
+    {
+        return numeric_stats::measure<T>(decrement < overflow_traits<T>::zero(),
+            [&]() { return numeric_detail::walk<T, Backend, true>(start, decrement, steps); });
+    }
+#endif
+    return numeric_detail::walk<T, Backend, true>(start, decrement, steps);
+}
+
+
+/// <summary>
+/// add_numbers with a saturating policy:
+///   start + (increment * steps), clamped to the range of T
+/// </summary>
+/// <typeparam name="T">A type that with basic math functions</typeparam>
+/// <typeparam name="Backend">How the integer multiply is checked (portable_backend, intrinsic_backend or wide_backend)</typeparam>
+/// <param name="start">The number to start with</param>
+/// <param name="increment">How much to add each step</param>
+/// <param name="steps">The number of steps to iterate</param>
+/// <returns>start + (increment * steps), or max() / lowest() with success = false when it saturated</returns>
+template <typename T, typename Backend = default_backend>
+constexpr CalcResult<T> add_numbers_saturating(T const& start, T const& increment, step_count_t const& steps)
+{
+    return numeric_detail::walk_saturating<T, Backend, false>(start, increment, steps);
+}
+
+
+/// <summary>
+/// subtract_numbers with a saturating policy:
+///   start - (increment * steps), clamped to the range of T
+/// </summary>
+/// <typeparam name="T">A type that with basic math functions</typeparam>
+/// <typeparam name="Backend">How the integer multiply is checked (portable_backend, intrinsic_backend or wide_backend)</typeparam>
+/// <param name="start">The number to start with</param>
+/// <param name="decrement">How much to subtract each step</param>
+/// <param name="steps">The number of steps to iterate</param>
+/// <returns>start - (increment * steps), or max() / lowest() with success = false when it saturated</returns>
+template <typename T, typename Backend = default_backend>
+constexpr CalcResult<T> subtract_numbers_saturating(T const& start, T const& decrement, step_count_t const& steps)
+{
+    return numeric_detail::walk_saturating<T, Backend, true>(start, decrement, steps);
+}
+
+static_assert(OverflowGuard<signed char>::adding(10, 3).apply_saturating(100).value == 127
+    && !OverflowGuard<signed char>::adding(10, 3).apply_saturating(100).success
+    && OverflowGuard<signed char>::adding(10, 3).apply_saturating(90).value == 120
+    && OverflowGuard<signed char>::adding(10, 3).apply_saturating(90).success, "apply_saturating clamps at max() and only there");
+static_assert(add_numbers_saturating<int>(std::numeric_limits<int>::lowest() + 5, -2, 3).value == std::numeric_limits<int>::lowest()
+    && add_numbers_saturating<int>(std::numeric_limits<int>::lowest() + 5, -2, 3).failed_at_step == 0, "a negative amount clamps at lowest()");
+static_assert(subtract_numbers_saturating<unsigned short>(5, 2, 3).value == 0 && !subtract_numbers_saturating<unsigned short>(5, 2, 3).success
+    && subtract_numbers_saturating<unsigned short>(65535, 65535, 1).value == 0 && subtract_numbers_saturating<unsigned short>(65535, 65535, 1).success,
+    "unsigned subtraction clamps at 0");
+static_assert(add_numbers_saturating<double>(std::numeric_limits<double>::max(), std::numeric_limits<double>::max(), 2).value == std::numeric_limits<double>::max()
+    && !add_numbers_saturating<double>(std::numeric_limits<double>::max(), std::numeric_limits<double>::max(), 2).success, "floating point clamps too");
+
+
+#if defined(__SIZEOF_INT128__)
+namespace numeric_detail
+{
+    /// <summary>
+    /// Runs a walk of up to 2^128 - 1 steps as chunks of 2^64 - 1 steps, each through walk.
+    /// An integer walk with a non-zero step runs out of room within the first two chunks, and a float
+    /// walk is absorbed or stopped long before, so this stops as soon as the value settles.
+    /// failed_at_step is 64 bits and saturates at 2^64 - 1.
+    /// </summary>
+    template <typename T, typename Backend, bool Subtract>
+    constexpr CalcResult<T> long_walk(T const& start, T const& amount, unsigned __int128 steps)
+    {
+        const step_count_t chunk_steps = std::numeric_limits<step_count_t>::max();
+
+        CalcResult<T> out{};
+        out.value = start;
+        unsigned __int128 done = 0;
+        while (done < steps)
+        {
+            const unsigned __int128 left = steps - done;
+            const step_count_t chunk = left < chunk_steps ? static_cast<step_count_t>(left) : chunk_steps;
+            const CalcResult<T> r = walk<T, Backend, Subtract>(out.value, amount, chunk);
+
+            if (!r.success)
+            {
+                const unsigned __int128 failed_at = done + r.failed_at_step;
+                out.value = r.value;
+                out.success = false;
+                out.failed_at_step = failed_at < chunk_steps ? static_cast<step_count_t>(failed_at) : chunk_steps;
+                return out;
+            }
+
+            // A value that no longer moves (including NaN) will not move in the next chunk either.
+            const bool settled = r.precision_lost || r.value == out.value || r.value != r.value;
+            out.value = r.value;
+            out.precision_lost = r.precision_lost;
+            if (settled)
+            {
+                return out;
+            }
+
+            done += chunk;
+        }
+
+        return out;
+    }
+}
+
+
+/// <summary>
+/// add_numbers for step counts past 2^64 - 1. Only an argument that is exactly unsigned __int128
+/// picks this overload, so ordinary integer step counts still go to the step_count_t one.
+/// </summary>
+/// <typeparam name="T">A type that with basic math functions</typeparam>
+/// <typeparam name="Backend">How the integer multiply is checked (portable_backend, intrinsic_backend or wide_backend)</typeparam>
+/// <param name="start">The number to start with</param>
+/// <param name="increment">How much to add each step</param>
+/// <param name="steps">The number of steps to iterate</param>
+/// <returns>start + (increment * steps), or the last safe value with success = false</returns>
+template <typename T, typename Backend = default_backend, typename Steps,
+    std::enable_if_t<std::is_same<Steps, unsigned __int128>::value, int> = 0>
+constexpr CalcResult<T> add_numbers(T const& start, T const& increment, Steps const& steps)
+{
+#if NUMERIC_STATS_ENABLED
+    if (!NUMERIC_IS_CONSTANT_EVALUATED())
+    {
+        return numeric_stats::measure<T>(!(increment < overflow_traits<T>::zero()),
+            [&]() { return numeric_detail::long_walk<T, Backend, false>(start, increment, steps); });
+    }
+#endif
+    return numeric_detail::long_walk<T, Backend, false>(start, increment, steps);
+}
+
+
+/// <summary>
+/// subtract_numbers for step counts past 2^64 - 1. Only an argument that is exactly unsigned __int128
+/// picks this overload, so ordinary integer step counts still go to the step_count_t one.
+/// </summary>
+/// <typeparam name="T">A type that with basic math functions</typeparam>
+/// <typeparam name="Backend">How the integer multiply is checked (portable_backend, intrinsic_backend or wide_backend)</typeparam>
+/// <param name="start">The number to start with</param>
+/// <param name="decrement">How much to subtract each step</param>
+/// <param name="steps">The number of steps to iterate</param>
+/// <returns>start - (increment * steps), or the last safe value with success = false</returns>
+template <typename T, typename Backend = default_backend, typename Steps,
+    std::enable_if_t<std::is_same<Steps, unsigned __int128>::value, int> = 0>
+constexpr CalcResult<T> subtract_numbers(T const& start, T const& decrement, Steps const& steps)
+{
+#if NUMERIC_STATS_ENABLED
+    if (!NUMERIC_IS_CONSTANT_EVALUATED())
+    {
+        return numeric_stats::measure<T>(decrement < overflow_traits<T>::zero(),
+            [&]() { return numeric_detail::long_walk<T, Backend, true>(start, decrement, steps); });
+    }
+#endif
+    return numeric_detail::long_walk<T, Backend, true>(start, decrement, steps);
+}
+#endif
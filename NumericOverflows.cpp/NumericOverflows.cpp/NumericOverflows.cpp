@@ -1,131 +1,59 @@
 // NumericOverflows.cpp : This file contains the 'main' function. Program execution begins and ends there.
 //
 
+#include <cstdlib>      // std::strtoul
+#include <cstring>      // std::strcmp
 #include <iostream>     // std::cout
 #include <limits>       // std::numeric_limits
+#include <string_view>  // std::string_view
 #include <typeinfo> // ADDED: Needed for typeid(T).name() so we can print the current type in the test output.
 
-// ADDED: We need a clean way to send two things back to the test code:
-//  1) the number we ended up with, and
-//  2) whether the operation finished safely.
-// This avoids using "special" return values like -1, which can be a real value or behave
-// differently for unsigned types, chars, and floating-point numbers.
-template <typename T>
-struct CalcResult
-{
-    T value{};            // The result (or the last safe value if we had to stop early)
-    bool success{ true }; // true = all steps completed safely, false = we prevented overflow/underflow
-};
+#include "NumericFunctions.h" // UPDATED: CalcResult, add_numbers and subtract_numbers now live in the NumericFunctions header
+#include "NumericTypeList.h" // ADDED: tested_types, the list of types every test runs for
+#include "OverflowResultsTable.h" // ADDED: compile-time copy of the test results below
+#include "ParallelTestRunner.h" // ADDED: runs the type tests on a thread pool, output kept in order
+#include "ReportSink.h" // ADDED: buffered report output and std::to_chars number formatting
+#include "BulkCheck.h" // ADDED: --bulk mode, streams requests through add_numbers / subtract_numbers
+#include "ColumnarFile.h" // ADDED: --bulk --columnar, memory-mapped request and result columns
+#include "BulkPipeline.h" // ADDED: --bulk --pipeline, reader, checker and writer threads
+#include "LatencyHistogram.h" // ADDED: --timing, per-call latency percentiles
+#include "NumericTypeName.h" // ADDED: constexpr readable type names for the NUMERIC_STATS report
+
+//  NOTE:
+//    You will see the unary ('+') operator used in front of the variables in the test_XXX methods.
+//    This forces the output to be a number for cases where cout would assume it is a character. 
 
+// ADDED: With --timing [N], every add_numbers / subtract_numbers call in the tests is repeated N times and its
+// latency (p50 / p99 / max) is added to the end of its report line. 0 leaves the report as it always was.
+unsigned timing_repetitions = 0;
 
 /// <summary>
-/// Template function to abstract away the logic of:
-///   start + (increment * steps)
+/// ADDED: Times add_numbers(start, amount, steps), or subtract_numbers when subtract, over timing_repetitions calls
+/// and prints " [p50 .. p99 .. max .. unit]". Prints nothing when timing is off. The histogram lives on the stack,
+/// so timing never allocates.
 /// </summary>
-/// <typeparam name="T">A type that with basic math functions</typeparam>
-/// <param name="start">The number to start with</param>
-/// <param name="increment">How much to add each step</param>
-/// <param name="steps">The number of steps to iterate</param>
-/// <returns>start + (increment * steps)</returns>
 template <typename T>
-CalcResult<T> add_numbers(T const& start, T const& increment, unsigned long int const& steps)
+void print_latency(std::ostream& out, bool subtract, T const& start, T const& amount, step_count_t steps)
 {
-    CalcResult<T> out{};   // ADDED: holds both the running total and a success/failure flag
-    out.value = start;     // ADDED: start the running total at the starting value
-
-    for (unsigned long int i = 0; i < steps; ++i)
+    if (timing_repetitions == 0)
     {
-        // ADDED: grab the valid range for this type (int, unsigned, float, etc.)
-        // so we can check limits before we change the value.
-        const T maxVal = std::numeric_limits<T>::max();
-        const T lowVal = std::numeric_limits<T>::lowest(); // ADDED: the lowest value this type can hold
-
-        // ADDED: Check *before* we add.
-        // If the next add would push us past the types limits, we stop early and report failure.
-        if (increment > T{ 0 })
-        {
-            // Positive increment: would we go above max?
-            if (out.value > (maxVal - increment))
-            {
-                out.success = false; // ADDED: tell the caller we prevented an overflow
-                return out;          // ADDED: return the last safe value
-            }
-        }
-        else if (increment < T{ 0 })
-        {
-            // Negative increment: would we go below the lowest value?
-            if (out.value < (lowVal - increment))
-            {
-                out.success = false; // ADDED: tell the caller we prevented an underflow
-                return out;          // ADDED: return the last safe value
-            }
-        }
-
-        out.value += increment; // UPDATED: safe to add now (we already checked the limits)
+        return;
     }
 
-    return out; // UPDATED: return both the final value and whether it completed safely
-}
-
-
-/// <summary>
-/// Template function to abstract away the logic of:
-///   start - (increment * steps)
-/// </summary>
-/// <typeparam name="T">A type that with basic math functions</typeparam>
-/// <param name="start">The number to start with</param>
-/// <param name="increment">How much to subtract each step</param>
-/// <param name="steps">The number of steps to iterate</param>
-/// <returns>start - (increment * steps)</returns>
-
-template <typename T>
-CalcResult<T> subtract_numbers(T const& start, T const& decrement, unsigned long int const& steps)
-{
-    CalcResult<T> out{};   // ADDED: holds both the running total and a success/failure flag
-    out.value = start;     // ADDED: start the running total at the starting value
-
-    for (unsigned long int i = 0; i < steps; ++i)
+    LatencyHistogram histogram;
+    if (subtract)
     {
-        // ADDED: grab the valid range for this type (int, unsigned, float, etc.)
-        // so we can check limits before we change the value.
-        const T maxVal = std::numeric_limits<T>::max();
-        const T lowVal = std::numeric_limits<T>::lowest();
-
-        // ADDED: Check *before* we subtract.
-        // If the next subtract would push us past the types limits, we stop early and report failure.
-        // This prevents the underflow/overflow from ever happening.
-        if (decrement > T{ 0 })
-        {
-            // Positive decrement: would we go below the lowest value?
-            if (out.value < (lowVal + decrement))
-            {
-                out.success = false; // ADDED: tell the caller we prevented an underflow
-                return out;          // ADDED: return the last safe value
-            }
-        }
-        else if (decrement < T{ 0 })
-        {
-            // Negative decrement: subtracting a negative is the same as adding.
-            // Would that push us above max?
-            if (out.value > (maxVal + decrement)) // decrement is negative here
-            {
-                out.success = false; // ADDED: tell the caller we prevented an overflow
-                return out;          // ADDED: return the last safe value
-            }
-        }
-
-        out.value -= decrement; // UPDATED: safe to subtract now (we already checked the limits)
+        time_check(histogram, timing_repetitions, [](T const& s, T const& a, step_count_t n) { return subtract_numbers<T>(s, a, n); }, start, amount, steps);
+    }
+    else
+    {
+        time_check(histogram, timing_repetitions, [](T const& s, T const& a, step_count_t n) { return add_numbers<T>(s, a, n); }, start, amount, steps);
     }
 
-    return out; // UPDATED: return both the final value and whether it completed safely
+    out << " [p50 " << format_number(histogram.percentile(0.50)) << " p99 " << format_number(histogram.percentile(0.99))
+        << " max " << format_number(histogram.max()) << ' ' << tick_unit << ']';
 }
 
-
-
-//  NOTE:
-//    You will see the unary ('+') operator used in front of the variables in the test_XXX methods.
-//    This forces the output to be a number for cases where cout would assume it is a character. 
-
 template <typename T>
 void test_overflow()
 {
@@ -162,30 +90,32 @@ void test_overflow()
     // It returns a small "package" (CalcResult<T>) that includes:
     //   - value: the result we computed (or the last safe value if we had to stop)
     //   - success: whether we finished all the steps without going out of range
-    std::cout << "\tAdding Numbers Without Overflow (" << +start << ", " << +increment << ", " << steps << ") = ";
+    // UPDATED: numbers go through format_number (std::to_chars), which prints the same text std::cout did.
+    std::cout << "\tAdding Numbers Without Overflow (" << format_number(+start) << ", " << format_number(+increment) << ", " << format_number(steps) << ") = ";
 
     // UPDATED: Store both the result and the success flag so we can tell if the math was safe.
     auto r1 = add_numbers<T>(start, increment, steps);
 
     // ADDED: Print a clear status plus the numeric result.
-    // boolalpha makes it print true/false instead of 1/0.
+    // UPDATED: true/false are spelled out here rather than with std::boolalpha, which would change
+    // the flags of the shared std::cout while other type tests are printing through it.
     // Overflow is just the opposite of success (if success is false, overflow was prevented).
-    std::cout << std::boolalpha
-        << "Overflow: " << (!r1.success)
-        << " Result: " << +r1.value
-        << std::noboolalpha << std::endl;
+    std::cout << "Overflow: " << (r1.success ? "false" : "true")
+        << " Result: " << format_number(+r1.value);
+    print_latency<T>(std::cout, false, start, increment, steps); // ADDED: only with --timing
+    std::cout << std::endl;
 
-    std::cout << "\tAdding Numbers With Overflow (" << +start << ", " << +increment << ", " << (steps + 1) << ") = ";
+    std::cout << "\tAdding Numbers With Overflow (" << format_number(+start) << ", " << format_number(+increment) << ", " << format_number(steps + 1) << ") = ";
 
     // UPDATED: This call is meant to push the calculation past the types limit.
     // If adding would go above the maximum value, add_numbers() stops early and sets success=false.
     auto r2 = add_numbers<T>(start, increment, steps + 1);
 
     // ADDED: Show whether we prevented overflow, and show the last safe value we reached.
-    std::cout << std::boolalpha
-        << "Overflow: " << (!r2.success)
-        << " Result: " << +r2.value
-        << std::noboolalpha << std::endl;
+    std::cout << "Overflow: " << (r2.success ? "false" : "true")
+        << " Result: " << format_number(+r2.value);
+    print_latency<T>(std::cout, false, start, increment, steps + 1); // ADDED: only with --timing
+    std::cout << std::endl;
 
 }
 
@@ -225,96 +155,162 @@ void test_underflow()
 // It returns a small "package" (CalcResult<T>) that includes:
 //   - value: the result we computed (or the last safe value if we had to stop)
 //   - success: whether we finished all the steps without going out of range
-    std::cout << "\tSubtracting Numbers Without Underflow (" << +start << ", " << +decrement << ", " << steps << ") = ";
+    // UPDATED: numbers go through format_number (std::to_chars), which prints the same text std::cout did.
+    std::cout << "\tSubtracting Numbers Without Underflow (" << format_number(+start) << ", " << format_number(+decrement) << ", " << format_number(steps) << ") = ";
 
     // UPDATED: Store both the result and the success flag so we can tell if the math was safe.
     auto r1 = subtract_numbers<T>(start, decrement, steps);
 
     // ADDED: Print a clear status plus the numeric result.
-    // boolalpha makes it print true/false instead of 1/0.
+    // UPDATED: true/false are spelled out here rather than with std::boolalpha, which would change
+    // the flags of the shared std::cout while other type tests are printing through it.
     // Underflow is just the opposite of success (if success is false, underflow was prevented).
-    std::cout << std::boolalpha
-        << "Underflow: " << (!r1.success)
-        << " Result: " << +r1.value
-        << std::noboolalpha << std::endl;
+    std::cout << "Underflow: " << (r1.success ? "false" : "true")
+        << " Result: " << format_number(+r1.value);
+    print_latency<T>(std::cout, true, start, decrement, steps); // ADDED: only with --timing
+    std::cout << std::endl;
 
-    std::cout << "\tSubtracting Numbers With Underflow (" << +start << ", " << +decrement << ", " << (steps + 1) << ") = ";
+    std::cout << "\tSubtracting Numbers With Underflow (" << format_number(+start) << ", " << format_number(+decrement) << ", " << format_number(steps + 1) << ") = ";
 
     // UPDATED: This call is meant to push the calculation past the types limit.
     // If subtracting would go below the minimum value, subtract_numbers() stops early and sets success=false.
     auto r2 = subtract_numbers<T>(start, decrement, steps + 1);
 
     // ADDED: Show whether we prevented underflow, and show the last safe value we reached.
-    std::cout << std::boolalpha
-        << "Underflow: " << (!r2.success)
-        << " Result: " << +r2.value
-        << std::noboolalpha << std::endl;
+    std::cout << "Underflow: " << (r2.success ? "false" : "true")
+        << " Result: " << format_number(+r2.value);
+    print_latency<T>(std::cout, true, start, decrement, steps + 1); // ADDED: only with --timing
+    std::cout << std::endl;
 }
 
-void do_overflow_tests(const std::string& star_line)
+// ADDED: The engine is constexpr, so every test below is also checked while compiling.
+// If a change to add_numbers / subtract_numbers breaks one of the 14 types, the build fails here.
+static_assert(overflow_results_table::all_hold, "add_numbers / subtract_numbers no longer prevent overflow for every tested type");
+
+void do_overflow_tests(std::string_view star_line)
 {
     std::cout << std::endl << star_line << std::endl;
     std::cout << "*** Running Overflow Tests ***" << std::endl;
     std::cout << star_line << std::endl;
 
-    // Testing C++ primative times see: https://www.geeksforgeeks.org/c-data-types/
-    // signed integers
-    test_overflow<char>();
-    test_overflow<wchar_t>();
-    test_overflow<short int>();
-    test_overflow<int>();
-    test_overflow<long>();
-    test_overflow<long long>();
-
-    // unsigned integers
-    test_overflow<unsigned char>();
-    test_overflow<unsigned short int>();
-    test_overflow<unsigned int>();
-    test_overflow<unsigned long>();
-    test_overflow<unsigned long long>();
-
-    // real numbers
-    test_overflow<float>();
-    test_overflow<double>();
-    test_overflow<long double>();
+    // UPDATED: The type tests are independent, so they run side by side on a thread pool.
+    // Each test's output is collected on its own and printed in the order they are added here.
+    OrderedTestRunner tests;
+
+    // UPDATED: One test per type in tested_types (NumericTypeList.h), in the order listed there.
+    for_each_type<tested_types>([&tests](auto tag) { tests.add(test_overflow<typename decltype(tag)::type>); });
+
+    // UPDATED: --timing runs the tests one at a time, so their timings do not disturb each other.
+    tests.run(std::cout, timing_repetitions != 0 ? 1 : 0);
 }
 
-void do_underflow_tests(const std::string& star_line)
+void do_underflow_tests(std::string_view star_line)
 {
     std::cout << std::endl << star_line << std::endl;
     std::cout << "*** Running Underflow Tests ***" << std::endl; // Fixed typo
     std::cout << star_line << std::endl;
 
-    // Testing C++ primative times see: https://www.geeksforgeeks.org/c-data-types/
-    // signed integers
-    test_underflow<char>();
-    test_underflow<wchar_t>();
-    test_underflow<short int>();
-    test_underflow<int>();
-    test_underflow<long>();
-    test_underflow<long long>();
-
-    // unsigned integers
-    test_underflow<unsigned char>();
-    test_underflow<unsigned short int>();
-    test_underflow<unsigned int>();
-    test_underflow<unsigned long>();
-    test_underflow<unsigned long long>();
-
-    // real numbers
-    test_underflow<float>();
-    test_underflow<double>();
-    test_underflow<long double>();
+    // UPDATED: The type tests are independent, so they run side by side on a thread pool.
+    // Each test's output is collected on its own and printed in the order they are added here.
+    OrderedTestRunner tests;
+
+    // UPDATED: One test per type in tested_types (NumericTypeList.h), in the order listed there.
+    for_each_type<tested_types>([&tests](auto tag) { tests.add(test_underflow<typename decltype(tag)::type>); });
+
+    // UPDATED: --timing runs the tests one at a time, so their timings do not disturb each other.
+    tests.run(std::cout, timing_repetitions != 0 ? 1 : 0);
+}
+
+#if NUMERIC_STATS_ENABLED
+/// <summary>
+/// ADDED: Prints what the NUMERIC_STATS counters saw, one line per type that was checked,
+/// then how many failed calls stopped in each range of steps.
+/// Goes to std::cerr so the test output and bulk results on std::cout stay the same.
+/// </summary>
+void print_stats(std::ostream& out)
+{
+    const numeric_stats::stats_snapshot stats = numeric_stats::snapshot();
+    out << "type: checks overflows underflows cycles/call (sampled)" << std::endl;
+    auto print_slot = [&](std::string_view name, const numeric_stats::type_stats& t)
+    {
+        if (t.checks != 0)
+        {
+            out << name << ": " << t.checks << ' ' << t.overflows << ' ' << t.underflows << ' '
+                << FormattedNumber(t.cycles_per_call()) << " (" << t.sampled_calls << ')' << std::endl;
+        }
+    };
+    for_each_type<tested_types>([&](auto tag)
+    {
+        using T = typename decltype(tag)::type;
+        print_slot(type_name<T>(), stats.per_type[numeric_stats::slot_of<T>]);
+    });
+    print_slot("other", stats.per_type[numeric_stats::slot_count - 1]);
+
+    out << "failed at step: count" << std::endl;
+    for (std::size_t b = 0; b < numeric_stats::step_bucket_count; ++b)
+    {
+        if (stats.failed_steps[b] != 0)
+        {
+            out << numeric_stats::step_bucket_floor(b) << ".." << (b == 0 ? 0 : numeric_stats::step_bucket_floor(b) * 2 - 1)
+                << ": " << stats.failed_steps[b] << std::endl;
+        }
+    }
 }
+#endif
 
 /// <summary>
 /// Entry point into the application
 /// </summary>
 /// <returns>0 when complete</returns>
-int main()
+int main(int argc, char* argv[])
 {
+    const char* const usage = "Usage: NumericOverflows [--timing [<repetitions>] | --bulk [--binary | --columnar] [--pipeline [<workers>]] [--in <file>] [--out <file>]]";
+
+    // ADDED: "--timing [N]" runs the tests as usual and adds the latency of every call over N repetitions (default 10000)
+    if (argc > 1 && std::strcmp(argv[1], "--timing") == 0)
+    {
+        timing_repetitions = 10000;
+        if (argc > 2)
+        {
+            char* end = nullptr;
+            const unsigned long repetitions = std::strtoul(argv[2], &end, 10);
+            if (argc > 3 || *end != '\0' || repetitions == 0 || repetitions > std::numeric_limits<unsigned>::max())
+            {
+                std::cerr << usage << std::endl;
+                return 1;
+            }
+            timing_repetitions = static_cast<unsigned>(repetitions);
+        }
+    }
+    // ADDED: "--bulk [--binary | --columnar] [--pipeline [<workers>]] [--in <file>] [--out <file>]" checks requests instead of running the tests
+    else if (argc > 1)
+    {
+        BulkOptions options{};
+        if (std::strcmp(argv[1], "--bulk") != 0 || !parse_bulk_options(argc, argv, 2, options))
+        {
+            std::cerr << usage << std::endl;
+            return 1;
+        }
+        const int status = options.columnar ? run_columnar(options, std::cerr)
+            : options.pipeline ? run_bulk_pipeline(options, std::cerr)
+            : run_bulk(options, std::cerr);
+#if NUMERIC_STATS_ENABLED
+        print_stats(std::cerr); // ADDED: only in builds with NUMERIC_STATS=1
+#endif
+        return status;
+    }
+
+    // ADDED: Everything printed through std::cout below collects in one preallocated buffer and reaches
+    // the console in a few large writes, instead of one flush for every std::endl.
+    ConsoleReportBackend console;
+    ReportSink report(console);
+    ReportStreamBuffer report_buffer(report);
+    std::streambuf* const console_buffer = std::cout.rdbuf(&report_buffer);
+
     //  create a string of "*" to use in the console
-    const std::string star_line = std::string(50, '*');
+    // UPDATED: a view of a constant instead of a std::string, which put its 50 characters on the heap
+    constexpr std::string_view star_line = "**************************************************";
+    static_assert(star_line.size() == 50, "the report's star lines are 50 characters");
 
     std::cout << "Starting Numeric Underflow / Overflow Tests!" << std::endl;
 
@@ -326,6 +322,14 @@ int main()
 
     std::cout << std::endl << "All Numeric Underflow / Overflow Tests Complete! By Joseph Wilfong" << std::endl;
 
+    // ADDED: put std::cout back and send the report out
+    std::cout.rdbuf(console_buffer);
+    report.flush();
+
+#if NUMERIC_STATS_ENABLED
+    print_stats(std::cerr); // ADDED: only in builds with NUMERIC_STATS=1
+#endif
+
     return 0;
 }
 
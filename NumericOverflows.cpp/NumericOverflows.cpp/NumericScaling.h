@@ -0,0 +1,356 @@
+// NumericScaling.h : Overflow-safe multiply_numbers / divide_numbers / shift_numbers, the scaling counterparts
+// of add_numbers / subtract_numbers.
+//
+// Each one repeats one operation steps times and reports like add_numbers does: the value, or the last safe
+// value with success = false and failed_at_step = the step that was refused.
+//   multiply_numbers(start, factor, steps)  - start * factor^steps
+//   divide_numbers(start, divisor, steps)   - start / divisor, steps times (integers truncate every step)
+//   shift_numbers(start, shift, steps)      - start << shift, steps times, i.e. start * 2^(shift * steps)
+// Integer types work on magnitudes in the unsigned work type, so lowest() is handled like every other value.
+// multiply_numbers raises the factor to the power steps by squaring, O(log steps) checked multiplies through
+// the Backend (see CheckedArithmetic.h); only a walk that fails is stepped again to find where it stops, and
+// that never takes more steps than T has bits. divide_numbers stops dividing once the value reaches 0.
+// Always refused: a divisor of 0, lowest() / -1 and lowest() * -1, and a shift by the width of T or more,
+// which C++ leaves undefined even for a start of 0.
+// Floating point types take every step (each one rounds), refuse a step whose result is not finite, and stop
+// early once the value reaches 0 or stops changing, with precision_lost when rounding swallowed the change.
+// Shifting a floating point value multiplies it by 2^shift, with the same limit on shift as the integers.
+
+#pragma once
+
+#include <climits>      // CHAR_BIT
+#include <limits>       // std::numeric_limits
+#include <type_traits>  // std::is_integral
+
+#include "CheckedArithmetic.h"
+#include "NumericFunctions.h"
+
+
+namespace scaling_detail
+{
+    template <typename T>
+    using work_t = numeric_detail::work_unsigned_t<T>;
+
+    // A shift by this many bits or more is refused.
+    template <typename T>
+    constexpr unsigned int shift_width = sizeof(T) * CHAR_BIT;
+
+    /// <summary>
+    /// An integer value as a sign and a magnitude. The magnitude of lowest() fits too.
+    /// </summary>
+    template <typename T>
+    struct signed_magnitude
+    {
+        work_t<T> size{ 0 };
+        bool negative{ false };
+    };
+
+    template <typename T>
+    constexpr signed_magnitude<T> split(T const& value)
+    {
+        const work_t<T> bits = static_cast<work_t<T>>(value);
+        const bool negative = value < T{ 0 };
+        return signed_magnitude<T>{ negative ? static_cast<work_t<T>>(work_t<T>{ 0 } - bits) : bits, negative };
+    }
+
+    template <typename T>
+    constexpr T join(work_t<T> size, bool negative)
+    {
+        return static_cast<T>(negative ? static_cast<work_t<T>>(work_t<T>{ 0 } - size) : size);
+    }
+
+    /// <summary>
+    /// The largest magnitude a value of T with that sign can have.
+    /// </summary>
+    template <typename T>
+    constexpr work_t<T> room(bool negative)
+    {
+        return negative ? split<T>(std::numeric_limits<T>::lowest()).size : static_cast<work_t<T>>(std::numeric_limits<T>::max());
+    }
+
+    template <typename T>
+    constexpr CalcResult<T> refused(T const& value, step_count_t step)
+    {
+        CalcResult<T> out{};
+        out.value = value;
+        out.success = false;
+        out.failed_at_step = step;
+        return out;
+    }
+
+    template <typename T, typename Backend>
+    constexpr CalcResult<T> multiply_integer(T const& start, T const& factor, step_count_t steps)
+    {
+        using W = work_t<T>;
+        const signed_magnitude<T> s = split(start);
+        const signed_magnitude<T> f = split(factor);
+
+        CalcResult<T> out{};
+        out.value = start;
+        if (steps == 0 || s.size == 0)
+        {
+            return out;
+        }
+        if (f.size == 0)
+        {
+            out.value = T{ 0 };
+            return out;
+        }
+
+        // A negative factor flips the sign on every step.
+        const bool negative = s.negative != (f.negative && (steps & 1) != 0);
+        if (f.size == 1)
+        {
+            // Only the magnitude of lowest() has no value of the other sign, and it fails on the first flip.
+            if (f.negative && s.size > room<T>(!s.negative))
+            {
+                return refused(start, 0);
+            }
+            out.value = join<T>(s.size, negative);
+            return out;
+        }
+
+        // |factor|^steps by squaring. With |factor| >= 2 every step grows the magnitude, so when the last
+        // value fits all the ones before it do too, and once a partial power is past the room so is the walk.
+        const W limit = room<T>(negative);
+        W power = 1;
+        W base = f.size;
+        bool fits = true;
+        for (step_count_t n = steps; fits; )
+        {
+            if ((n & 1) != 0)
+            {
+                fits = Backend::walk_fits(power, base, limit, power);
+            }
+            n >>= 1;
+            if (n == 0)
+            {
+                break;
+            }
+            fits = fits && Backend::walk_fits(base, base, limit, base);
+        }
+
+        W total = 0;
+        if (fits && Backend::walk_fits(s.size, power, limit, total))
+        {
+            out.value = join<T>(total, negative);
+            return out;
+        }
+
+        // The walk leaves the range before it has taken as many steps as T has bits; step to where it stops.
+        W size = s.size;
+        bool sign = s.negative;
+        for (step_count_t i = 0; i < steps; ++i)
+        {
+            const bool next_sign = sign != f.negative;
+            W next = 0;
+            if (!Backend::walk_fits(size, f.size, room<T>(next_sign), next))
+            {
+                return refused(join<T>(size, sign), i);
+            }
+            size = next;
+            sign = next_sign;
+        }
+        out.value = join<T>(size, sign);
+        return out;
+    }
+
+    template <typename T>
+    constexpr CalcResult<T> divide_integer(T const& start, T const& divisor, step_count_t steps)
+    {
+        using W = work_t<T>;
+        const signed_magnitude<T> s = split(start);
+        const signed_magnitude<T> d = split(divisor);
+
+        CalcResult<T> out{};
+        out.value = start;
+        if (steps == 0)
+        {
+            return out;
+        }
+        // Division by 0, and lowest() / -1, whose magnitude has no value of the other sign.
+        if (d.size == 0 || (d.size == 1 && d.negative && s.size > room<T>(!s.negative)))
+        {
+            return refused(start, 0);
+        }
+
+        // Truncating after every step ends on the same value as one truncating division by |divisor|^steps.
+        W size = s.size;
+        if (d.size != 1)
+        {
+            for (step_count_t i = 0; i < steps && size != 0; ++i)
+            {
+                size = static_cast<W>(size / d.size);
+            }
+        }
+        out.value = join<T>(size, s.negative != (d.negative && (steps & 1) != 0));
+        return out;
+    }
+
+    template <typename T>
+    constexpr CalcResult<T> shift_integer(T const& start, unsigned int shift, step_count_t steps)
+    {
+        using W = work_t<T>;
+        const signed_magnitude<T> s = split(start);
+
+        CalcResult<T> out{};
+        out.value = start;
+        if (steps == 0 || shift == 0 || s.size == 0)
+        {
+            return out;
+        }
+
+        // size << shift stays within the room exactly when size <= room >> shift. Every step at least
+        // doubles the magnitude, so this is over before it has taken as many steps as T has bits.
+        const W limit = static_cast<W>(room<T>(s.negative) >> shift);
+        W size = s.size;
+        for (step_count_t i = 0; i < steps; ++i)
+        {
+            if (size > limit)
+            {
+                return refused(join<T>(size, s.negative), i);
+            }
+            size = static_cast<W>(size << shift);
+        }
+        out.value = join<T>(size, s.negative);
+        return out;
+    }
+
+    /// <summary>
+    /// (floating point) start * operand, or start / operand when Divide, steps times, one rounded step at a time.
+    /// </summary>
+    template <typename T, bool Divide>
+    constexpr CalcResult<T> scale_floating(T const& start, T const& operand, step_count_t steps)
+    {
+        CalcResult<T> out{};
+        out.value = start;
+
+        for (step_count_t i = 0; i < steps; ++i)
+        {
+            const T next = Divide ? out.value / operand : out.value * operand;
+            if (next > std::numeric_limits<T>::max() || next < std::numeric_limits<T>::lowest())
+            {
+                return refused(out.value, i);
+            }
+
+            // A NaN stays NaN, the remaining steps cannot change anything.
+            if (next != next)
+            {
+                out.value = next;
+                return out;
+            }
+
+            // A value that reached 0 or stopped changing repeats every two steps from here (a negative
+            // operand flips the sign of a zero each time), so the step count left picks which one it ends on.
+            if (next == T{ 0 } || next == out.value)
+            {
+                const T after = Divide ? next / operand : next * operand;
+                out.precision_lost = out.value != T{ 0 } && operand != T{ 0 } && (next == T{ 0 } || operand != T{ 1 });
+                out.value = (steps - i - 1) % 2 == 0 ? next : after;
+                return out;
+            }
+
+            out.value = next;
+        }
+
+        return out;
+    }
+}
+
+
+/// <summary>
+/// Template function to abstract away the logic of:
+///   start * (factor ^ steps)
+/// </summary>
+/// <typeparam name="T">A type that with basic math functions</typeparam>
+/// <typeparam name="Backend">How the integer multiplies are checked (portable_backend, intrinsic_backend or wide_backend)</typeparam>
+/// <param name="start">The number to start with</param>
+/// <param name="factor">What to multiply by each step</param>
+/// <param name="steps">The number of steps to iterate</param>
+/// <returns>start * (factor ^ steps), or the last safe value with success = false</returns>
+template <typename T, typename Backend = default_backend>
+constexpr CalcResult<T> multiply_numbers(T const& start, T const& factor, step_count_t const& steps)
+{
+    if constexpr (std::is_integral<T>::value)
+    {
+        return scaling_detail::multiply_integer<T, Backend>(start, factor, steps);
+    }
+    else
+    {
+        return scaling_detail::scale_floating<T, false>(start, factor, steps);
+    }
+}
+
+
+/// <summary>
+/// Template function to abstract away the logic of:
+///   start / divisor / divisor ... (steps times)
+/// Integer types truncate towards 0 on every step. A divisor of 0 and lowest() / -1 fail on the first step.
+/// </summary>
+/// <typeparam name="T">A type that with basic math functions</typeparam>
+/// <param name="start">The number to start with</param>
+/// <param name="divisor">What to divide by each step</param>
+/// <param name="steps">The number of steps to iterate</param>
+/// <returns>start / (divisor ^ steps), or the last safe value with success = false</returns>
+template <typename T>
+constexpr CalcResult<T> divide_numbers(T const& start, T const& divisor, step_count_t const& steps)
+{
+    if constexpr (std::is_integral<T>::value)
+    {
+        return scaling_detail::divide_integer<T>(start, divisor, steps);
+    }
+    else
+    {
+        if (steps != 0 && divisor == T{ 0 })
+        {
+            return scaling_detail::refused(start, 0);
+        }
+        return scaling_detail::scale_floating<T, true>(start, divisor, steps);
+    }
+}
+
+
+/// <summary>
+/// Template function to abstract away the logic of:
+///   start << shift << shift ... (steps times), i.e. start * 2^(shift * steps)
+/// A step fails when a bit would be shifted out or into the sign, and every step fails when shift
+/// is the width of T or more.
+/// </summary>
+/// <typeparam name="T">A type that with basic math functions</typeparam>
+/// <param name="start">The number to start with</param>
+/// <param name="shift">How many bits to shift left each step</param>
+/// <param name="steps">The number of steps to iterate</param>
+/// <returns>start * 2^(shift * steps), or the last safe value with success = false</returns>
+template <typename T>
+constexpr CalcResult<T> shift_numbers(T const& start, unsigned int shift, step_count_t const& steps)
+{
+    if (steps != 0 && shift >= scaling_detail::shift_width<T>)
+    {
+        return scaling_detail::refused(start, 0);
+    }
+
+    if constexpr (std::is_integral<T>::value)
+    {
+        return scaling_detail::shift_integer<T>(start, shift, steps);
+    }
+    else
+    {
+        T factor{ 1 };
+        for (unsigned int i = 0; i < shift; ++i)
+        {
+            factor *= T{ 2 };
+        }
+        return scaling_detail::scale_floating<T, false>(start, factor, steps);
+    }
+}
+
+
+static_assert(multiply_numbers<int>(3, -2, 5).value == -96, "multiply_numbers multiplies steps times");
+static_assert(!multiply_numbers<signed char>(-1, 2, 8).success && multiply_numbers<signed char>(-1, 2, 8).value == -128
+    && multiply_numbers<signed char>(-1, 2, 8).failed_at_step == 7, "multiply_numbers stops on the last safe value");
+static_assert(!multiply_numbers<int>(std::numeric_limits<int>::lowest(), -1, 2).success, "lowest() * -1 is refused");
+static_assert(!divide_numbers<int>(std::numeric_limits<int>::lowest(), -1, 1).success, "lowest() / -1 is refused");
+static_assert(!divide_numbers<long long>(7, 0, 1).success && divide_numbers<long long>(7, 0, 0).success, "division by 0 is refused");
+static_assert(divide_numbers<int>(-100, -3, 2).value == -11, "divide_numbers truncates every step");
+static_assert(shift_numbers<short>(-1, 15, 1).value == -32768 && !shift_numbers<short>(1, 15, 1).success, "shift_numbers keeps the sign");
+static_assert(!shift_numbers<unsigned char>(0, 8, 1).success, "shifts by the width of T are refused");
@@ -0,0 +1,214 @@
+// NumericStats.h : Optional counters for add_numbers / subtract_numbers: checks made, overflows and underflows
+// prevented, and sampled cycles per call, for every tested type.
+//
+// The counters only exist when the build defines NUMERIC_STATS=1; otherwise NUMERIC_STATS_ENABLED is 0,
+// add_numbers / subtract_numbers compile exactly as before and numeric_stats::snapshot() returns zeros.
+// Each thread counts its checks into its own cache-line aligned block, which only it writes, so the count made
+// on every call takes no lock and shares no cache line. The rarer failures go straight to the lock-free
+// shared_aggregator() (StatsAggregator.h) with the step they stopped at, and a thread that exits hands its
+// block to it too. snapshot() adds the blocks of the running threads to the aggregator's totals.
+// One call in NUMERIC_STATS_SAMPLE_INTERVAL per thread and type is timed with read_ticks() (LatencyHistogram.h:
+// rdtsc, or a steady_clock nanosecond elsewhere), so timing costs little on the calls that are not sampled.
+// Calls worked out at compile time are not counted.
+
+#pragma once
+
+#include <atomic>       // std::atomic, std::memory_order_relaxed
+#include <cstddef>      // std::size_t
+#include <cstdint>      // std::uint32_t, std::uint64_t
+
+#include "StatsAggregator.h"
+
+#if !defined(NUMERIC_STATS)
+#define NUMERIC_STATS 0
+#endif
+
+#if NUMERIC_STATS
+#define NUMERIC_STATS_ENABLED 1
+#else
+#define NUMERIC_STATS_ENABLED 0
+#endif
+
+// Time one call in this many, per thread and type (a power of two).
+#if !defined(NUMERIC_STATS_SAMPLE_INTERVAL)
+#define NUMERIC_STATS_SAMPLE_INTERVAL 64
+#endif
+
+#if NUMERIC_STATS_ENABLED
+#include <mutex>        // std::mutex, std::lock_guard
+#include <vector>       // std::vector
+
+#include "LatencyHistogram.h"
+#endif
+
+
+namespace numeric_stats
+{
+#if NUMERIC_STATS_ENABLED
+    namespace detail
+    {
+        /// <summary>
+        /// A counter written only by the thread that owns it, and read by snapshot() from any thread.
+        /// A relaxed load and store is a plain move, not a locked add.
+        /// </summary>
+        struct counter
+        {
+            std::atomic<std::uint64_t> value{ 0 };
+
+            void add(std::uint64_t n)
+            {
+                value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+            }
+
+            std::uint64_t get() const
+            {
+                return value.load(std::memory_order_relaxed);
+            }
+        };
+
+        struct slot_counters
+        {
+            counter checks;
+            counter sampled_calls;
+            counter sampled_cycles;
+            std::uint32_t sample_clock{ 0 }; // only read by the owner, which decides when to time a call
+        };
+
+        /// <summary>
+        /// One thread's counters, on cache lines of their own.
+        /// </summary>
+        struct alignas(64) thread_block
+        {
+            slot_counters slots[slot_count];
+        };
+
+        inline void add_into(stats_snapshot& out, const thread_block& block)
+        {
+            for (std::size_t s = 0; s < slot_count; ++s)
+            {
+                out.per_type[s].checks += block.slots[s].checks.get();
+                out.per_type[s].sampled_calls += block.slots[s].sampled_calls.get();
+                out.per_type[s].sampled_cycles += block.slots[s].sampled_cycles.get();
+            }
+        }
+
+        /// <summary>
+        /// The blocks of the running threads. The lock is only taken when a thread starts or stops
+        /// counting and by snapshot(), never by a thread that is counting.
+        /// </summary>
+        struct registry
+        {
+            std::mutex lock;
+            std::vector<const thread_block*> live;
+
+            static registry& instance()
+            {
+                static registry r;
+                return r;
+            }
+        };
+
+        /// <summary>
+        /// Registers this thread's block on first use and hands its counts to shared_aggregator() when the thread exits.
+        /// </summary>
+        class thread_handle
+        {
+        public:
+            thread_handle()
+                : registry_(registry::instance())
+            {
+                std::lock_guard<std::mutex> guard(registry_.lock);
+                registry_.live.push_back(&block);
+            }
+
+            ~thread_handle()
+            {
+                // Under the lock, so snapshot() sees these counts either in the block or in the aggregator.
+                std::lock_guard<std::mutex> guard(registry_.lock);
+                overflow_aggregator& shared = shared_aggregator();
+                for (std::size_t s = 0; s < slot_count; ++s)
+                {
+                    shared.record_checks(s, block.slots[s].checks.get());
+                    shared.record_samples(s, block.slots[s].sampled_calls.get(), block.slots[s].sampled_cycles.get());
+                }
+                for (std::size_t i = 0; i < registry_.live.size(); ++i)
+                {
+                    if (registry_.live[i] == &block)
+                    {
+                        registry_.live[i] = registry_.live.back();
+                        registry_.live.pop_back();
+                        break;
+                    }
+                }
+            }
+
+            thread_handle(const thread_handle&) = delete;
+            thread_handle& operator=(const thread_handle&) = delete;
+
+            thread_block block;
+
+        private:
+            registry& registry_;
+        };
+
+        inline thread_block& local_block()
+        {
+            thread_local thread_handle handle;
+            return handle.block;
+        }
+    }
+
+    /// <summary>
+    /// Runs call() and counts it for T. upward says which limit a failed call stopped at:
+    /// max() (an overflow prevented) when true, lowest() (an underflow prevented) when false.
+    /// </summary>
+    template <typename T, typename Call>
+    auto measure(bool upward, Call&& call) -> decltype(call())
+    {
+        static_assert((NUMERIC_STATS_SAMPLE_INTERVAL & (NUMERIC_STATS_SAMPLE_INTERVAL - 1)) == 0,
+            "NUMERIC_STATS_SAMPLE_INTERVAL must be a power of two");
+
+        detail::slot_counters& slot = detail::local_block().slots[slot_of<T>];
+
+        const bool sampled = (++slot.sample_clock & (NUMERIC_STATS_SAMPLE_INTERVAL - 1)) == 0;
+        const std::uint64_t begin = sampled ? read_ticks() : 0;
+        auto result = call();
+        if (sampled)
+        {
+            slot.sampled_cycles.add(read_ticks() - begin);
+            slot.sampled_calls.add(1);
+        }
+
+        slot.checks.add(1);
+        if (!result.success)
+        {
+            shared_aggregator().record_failure(slot_of<T>, upward, result.failed_at_step);
+        }
+        return result;
+    }
+
+    /// <summary>
+    /// The counts so far, added up over every thread that has counted anything.
+    /// Counts made by other threads while this runs may or may not be included.
+    /// </summary>
+    inline stats_snapshot snapshot()
+    {
+        detail::registry& r = detail::registry::instance();
+        std::lock_guard<std::mutex> guard(r.lock);
+        stats_snapshot out = shared_aggregator().snapshot();
+        for (const detail::thread_block* block : r.live)
+        {
+            detail::add_into(out, *block);
+        }
+        return out;
+    }
+#else
+    /// <summary>
+    /// Stats are compiled out (NUMERIC_STATS is not set): every count is zero.
+    /// </summary>
+    inline stats_snapshot snapshot()
+    {
+        return stats_snapshot{};
+    }
+#endif
+}
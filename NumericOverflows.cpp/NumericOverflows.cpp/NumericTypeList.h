@@ -0,0 +1,154 @@
+// NumericTypeList.h : The list of tested types, and dispatch from a runtime type index to a template instantiation.
+//
+// tested_types names every type the tests, the compile-time results table and the bulk modes work with,
+// in the order they run. for_each_type() visits them at compile time; dispatch_type() turns a runtime
+// index into a call on the matching type through a table of function pointers built from the list,
+// so there is one indirect call instead of a chain of comparisons. A type added to the list is tested, checked
+// at compile time and benchmarked with no change to those loops. It does need a name in tested_type_names
+// (NumericTypeName.h), and the bulk formats need a bulk_type enum value and a bulk_type_names entry for it
+// (BulkCheck.h); static_asserts next to each of those stop the build until they are added.
+
+#pragma once
+
+#include <cstddef>      // std::size_t
+#include <type_traits>  // std::is_same
+
+
+/// <summary>
+/// Stands for the type T in calls that pick a type at runtime. Use typename decltype(tag)::type
+/// inside a generic lambda to get T back.
+/// </summary>
+template <typename T>
+struct type_tag
+{
+    using type = T;
+};
+
+/// <summary>
+/// A compile-time list of types.
+/// </summary>
+template <typename... Ts>
+struct type_list
+{
+    static constexpr std::size_t size = sizeof...(Ts);
+
+    /// <summary>
+    /// Target<Ts...>, for templates that take the whole list as their parameters.
+    /// </summary>
+    template <template <typename...> class Target>
+    using apply = Target<Ts...>;
+};
+
+/// <summary>
+/// The position of T in List; a compile error when T is not in it.
+/// </summary>
+template <typename T, typename List>
+struct type_index;
+
+template <typename T, typename... Rest>
+struct type_index<T, type_list<T, Rest...>>
+{
+    static constexpr std::size_t value = 0;
+};
+
+template <typename T, typename First, typename... Rest>
+struct type_index<T, type_list<First, Rest...>>
+{
+    static constexpr std::size_t value = 1 + type_index<T, type_list<Rest...>>::value;
+};
+
+template <typename T>
+struct type_index<T, type_list<>>
+{
+    static_assert(!std::is_same<T, T>::value, "the type is not in the list");
+};
+
+namespace type_list_detail
+{
+    template <typename T, typename... Ts>
+    constexpr std::size_t find(type_list<Ts...>)
+    {
+        const bool match[] = { std::is_same<T, Ts>::value..., true };
+        std::size_t index = 0;
+        while (!match[index])
+        {
+            ++index;
+        }
+        return index;
+    }
+}
+
+/// <summary>
+/// The position of T in List, or List::size when T is not in it (where type_index would not compile).
+/// </summary>
+template <typename T, typename List>
+constexpr std::size_t type_position = type_list_detail::find<T>(List{});
+
+
+namespace type_list_detail
+{
+    template <typename List>
+    struct visit;
+
+    template <typename... Ts>
+    struct visit<type_list<Ts...>>
+    {
+        template <typename F>
+        static void each(F& f)
+        {
+            (f(type_tag<Ts>{}), ...);
+        }
+
+        template <typename F>
+        static bool at(std::size_t index, F& f)
+        {
+            using entry = void (*)(F&);
+            static constexpr entry table[] = { &call<Ts, F>... };
+            if (index >= sizeof...(Ts))
+            {
+                return false;
+            }
+            table[index](f);
+            return true;
+        }
+
+    private:
+        template <typename T, typename F>
+        static void call(F& f)
+        {
+            f(type_tag<T>{});
+        }
+    };
+}
+
+/// <summary>
+/// Calls f(type_tag<T>{}) for every T in List, in order.
+/// </summary>
+template <typename List, typename F>
+void for_each_type(F&& f)
+{
+    type_list_detail::visit<List>::each(f);
+}
+
+/// <summary>
+/// Calls f(type_tag<T>{}) for the T at position index of List.
+/// </summary>
+/// <returns>false (without calling f) when index is past the end of the list</returns>
+template <typename List, typename F>
+bool dispatch_type(std::size_t index, F&& f)
+{
+    return type_list_detail::visit<List>::at(index, f);
+}
+
+
+/// <summary>
+/// The types do_overflow_tests() / do_underflow_tests() exercise, in the order they run.
+/// Testing C++ primative times see: https://www.geeksforgeeks.org/c-data-types/
+/// </summary>
+using tested_types = type_list<
+    // signed integers
+    char, wchar_t, short int, int, long, long long,
+    // unsigned integers
+    unsigned char, unsigned short int, unsigned int, unsigned long, unsigned long long,
+    // real numbers
+    float, double, long double>;
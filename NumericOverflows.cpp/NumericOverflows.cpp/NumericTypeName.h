@@ -0,0 +1,76 @@
+// NumericTypeName.h : Readable type names worked out at compile time.
+//
+// type_name<T>() is a constexpr std::string_view. The tested types have fixed names from a table,
+// spelled the way they are declared ("unsigned short", "long double"), so every compiler prints the same
+// text. Any other type is named from the compiler's function signature macro (__PRETTY_FUNCTION__ or
+// __FUNCSIG__) with the text around the type cut off, so those names are the compiler's own spelling.
+// Unlike typeid(T).name() nothing is looked up at run time and the names are not mangled.
+// The NUMERIC_STATS report, NumericBenchmarks and NumericChecks name their types this way. The test
+// headers of the main program ("Overflow Test of Type = ...") still print typeid(T).name(): they sit in
+// code that may not be changed, so the program keeps needing RTTI.
+
+#pragma once
+
+#include <cstddef>      // std::size_t
+#include <string_view>  // std::string_view
+
+#include "NumericTypeList.h"
+
+
+/// <summary>
+/// The names of tested_types, in the same order.
+/// </summary>
+constexpr std::string_view tested_type_names[] = {
+    "char", "wchar_t", "short", "int", "long", "long long",
+    "unsigned char", "unsigned short", "unsigned int", "unsigned long", "unsigned long long",
+    "float", "double", "long double" };
+
+static_assert(sizeof(tested_type_names) / sizeof(tested_type_names[0]) == tested_types::size, "one name per tested type");
+
+
+namespace type_name_detail
+{
+    template <typename T>
+    constexpr std::string_view signature()
+    {
+#if defined(_MSC_VER) && !defined(__clang__)
+        return __FUNCSIG__;
+#else
+        return __PRETTY_FUNCTION__;
+#endif
+    }
+
+    // signature<int>() tells how much text the compiler puts before and after the type.
+    constexpr std::string_view probe = signature<int>();
+    constexpr std::size_t prefix = probe.find("int");
+    constexpr std::size_t suffix = probe.size() - prefix - std::string_view("int").size();
+
+    static_assert(prefix != std::string_view::npos, "the signature macro does not name the template argument");
+
+    template <typename T>
+    constexpr std::string_view from_signature()
+    {
+        constexpr std::string_view full = signature<T>();
+        return full.substr(prefix, full.size() - prefix - suffix);
+    }
+}
+
+/// <summary>
+/// The readable name of T, e.g. "long double" (see the top of this file).
+/// </summary>
+template <typename T>
+constexpr std::string_view type_name()
+{
+    constexpr std::size_t position = type_position<T, tested_types>;
+    if constexpr (position < tested_types::size)
+    {
+        return tested_type_names[position];
+    }
+    else
+    {
+        return type_name_detail::from_signature<T>();
+    }
+}
+
+static_assert(type_name<long double>() == "long double", "tested types use the table");
+static_assert(type_name<bool>() == "bool", "other types use the signature macro");
@@ -0,0 +1,85 @@
+// OverflowResultsTable.h : The results of test_overflow<T>() / test_underflow<T>(), worked out at compile time.
+//
+// Every input those tests use comes from std::numeric_limits<T> and steps = 5, and the engine in
+// NumericFunctions.h is constexpr, so the whole table is a constant. Builds that only need the verified
+// limits can static_assert against it and skip running the tests at startup.
+
+#pragma once
+
+#include <limits>       // std::numeric_limits
+#include <tuple>        // std::tuple, std::get
+#include <type_traits>  // std::is_unsigned
+
+#include "NumericFunctions.h"
+#include "NumericTypeList.h"
+
+
+/// <summary>
+/// The four calls made by test_overflow<T>() and test_underflow<T>() for one type.
+/// </summary>
+template <typename T>
+struct OverflowTestResults
+{
+    CalcResult<T> add_without_overflow;        // add_numbers(0, max / 5, 5)
+    CalcResult<T> add_with_overflow;           // add_numbers(0, max / 5, 6)
+    CalcResult<T> subtract_without_underflow;  // subtract_numbers(max, max / 5, 5)
+    CalcResult<T> subtract_with_underflow;     // subtract_numbers(max, max / 5, 6)
+};
+
+/// <summary>
+/// Runs the same calls as test_overflow<T>() / test_underflow<T>() with the same inputs.
+/// </summary>
+template <typename T>
+constexpr OverflowTestResults<T> overflow_test_results()
+{
+    const unsigned long int steps = 5;
+    const T increment = std::numeric_limits<T>::max() / steps;
+    const T overflow_start = 0;
+    const T underflow_start = std::numeric_limits<T>::max();
+
+    OverflowTestResults<T> out{};
+    out.add_without_overflow = add_numbers<T>(overflow_start, increment, steps);
+    out.add_with_overflow = add_numbers<T>(overflow_start, increment, steps + 1);
+    out.subtract_without_underflow = subtract_numbers<T>(underflow_start, increment, steps);
+    out.subtract_with_underflow = subtract_numbers<T>(underflow_start, increment, steps + 1);
+    return out;
+}
+
+/// <summary>
+/// The expected shape of the results for T: the plain calls succeed, the extra add step is prevented,
+/// and the extra subtract step is only prevented for unsigned types (signed and floating point types
+/// just go negative). Prevented calls keep the last safe value from the step before.
+/// </summary>
+template <typename T>
+constexpr bool overflow_test_results_hold()
+{
+    const OverflowTestResults<T> r = overflow_test_results<T>();
+    return r.add_without_overflow.success
+        && !r.add_with_overflow.success
+        && r.add_with_overflow.value == r.add_without_overflow.value
+        && r.add_with_overflow.failed_at_step == 5
+        && r.subtract_without_underflow.success
+        && r.subtract_with_underflow.success == !std::is_unsigned<T>::value
+        && (r.subtract_with_underflow.success || r.subtract_with_underflow.value == r.subtract_without_underflow.value);
+}
+
+/// <summary>
+/// A compile-time table of OverflowTestResults, one entry per type.
+/// </summary>
+template <typename... Types>
+struct OverflowResultsTable
+{
+    static constexpr std::tuple<OverflowTestResults<Types>...> results{ overflow_test_results<Types>()... };
+
+    template <typename T>
+    static constexpr const OverflowTestResults<T>& get()
+    {
+        return std::get<OverflowTestResults<T>>(results);
+    }
+
+    // true when overflow_test_results_hold<T>() for every type in the table
+    static constexpr bool all_hold = (overflow_test_results_hold<Types>() && ...);
+};
+
+// The types do_overflow_tests() / do_underflow_tests() exercise, in the same order.
+using overflow_results_table = tested_types::apply<OverflowResultsTable>;
@@ -0,0 +1,250 @@
+// OverflowTraits.h : overflow_traits<T>, the customization point that tells add_numbers / subtract_numbers about T.
+//
+// The built-in arithmetic types are described by std::numeric_limits and run on OverflowGuard's engines
+// (NumericFunctions.h). Any other type gets add_numbers / subtract_numbers by specializing overflow_traits:
+// its range and zero are enough for the stepwise loop, and a checked_fma that works out
+// start +/- amount * steps in O(1) (with the same CalcResult a stepwise walk gives) replaces the loop. The
+// wider type deferred checks accumulate in (DeferredChecks.h) is part of the traits too; it defaults to
+// accumulator_traits<T>. Specializations for __int128 / unsigned __int128 (an O(1) checked_fma) and _Float16
+// (its range, and a checked_fma that stops once the steps stop changing the value) come with this header. A fixed-point or Boost.Multiprecision type plugs in the same way, e.g.
+//
+//   template <>
+//   struct overflow_traits<fixed_16_16>
+//   {
+//       static constexpr fixed_16_16 max() { return fixed_16_16::from_raw(INT32_MAX); }
+//       static constexpr fixed_16_16 lowest() { return fixed_16_16::from_raw(INT32_MIN); }
+//       static constexpr fixed_16_16 zero() { return fixed_16_16{}; }
+//       using accumulator = accumulator_traits<fixed_16_16>;
+//       static constexpr bool has_checked_fma = true;
+//       static constexpr CalcResult<fixed_16_16> checked_fma(fixed_16_16 const& start, fixed_16_16 const& amount,
+//           step_count_t steps, bool subtract); // add_numbers<std::int32_t> / subtract_numbers on the raw values
+//   };
+
+#pragma once
+
+#include <cstdint>      // std::int64_t, std::uint64_t
+#include <limits>       // std::numeric_limits
+#include <type_traits>  // std::is_integral, std::is_same, std::enable_if_t
+
+#include "CalcResult.h"
+
+
+/// <summary>
+/// The accumulator used for deferred checks of T.
+///   type   - the accumulator type (T itself when nothing wider is available)
+///   wider  - type can hold every value of T plus a full step in either direction
+///   exact  - accumulating in type and converting back matches stepping in T bit for bit
+/// Integers up to 32 bits widen to int64_t and 64-bit integers to __int128 where the compiler has it.
+/// float and double widen to double and long double, but every float add rounds, so those are not exact
+/// and deferred checks keep stepping in T for them.
+/// </summary>
+template <typename T, typename Enable = void>
+struct accumulator_traits
+{
+    using type = T;
+    static constexpr bool wider = false;
+    static constexpr bool exact = false;
+};
+
+template <typename T>
+struct accumulator_traits<T, std::enable_if_t<std::is_integral<T>::value && (sizeof(T) <= 4)>>
+{
+    using type = std::int64_t;
+    static constexpr bool wider = true;
+    static constexpr bool exact = true;
+};
+
+#if defined(__SIZEOF_INT128__)
+template <typename T>
+struct accumulator_traits<T, std::enable_if_t<std::is_integral<T>::value && (sizeof(T) == 8)>>
+{
+    using type = __int128;
+    static constexpr bool wider = true;
+    static constexpr bool exact = true;
+};
+#endif
+
+template <>
+struct accumulator_traits<float>
+{
+    using type = double;
+    static constexpr bool wider = true;
+    static constexpr bool exact = false;
+};
+
+template <>
+struct accumulator_traits<double>
+{
+    using type = long double;
+    static constexpr bool wider = sizeof(long double) > sizeof(double); // MSVC's long double is just a double
+    static constexpr bool exact = false;
+};
+
+
+/// <summary>
+/// What add_numbers / subtract_numbers need to know about T (see the top of this file).
+///   max() / lowest()  - the range of T; no step may leave it
+///   zero()            - the value that is neither an increment nor a decrement
+///   accumulator       - the accumulator_traits-like description of the type deferred checks accumulate in
+///   has_checked_fma   - true when checked_fma(start, amount, steps, subtract) works out
+///                       start + amount * steps (start - amount * steps when subtract) in O(1)
+/// The primary template reads std::numeric_limits and has no checked_fma.
+/// </summary>
+template <typename T, typename Enable = void>
+struct overflow_traits
+{
+    static constexpr T max() { return std::numeric_limits<T>::max(); }
+    static constexpr T lowest() { return std::numeric_limits<T>::lowest(); }
+    static constexpr T zero() { return T{ 0 }; }
+    using accumulator = accumulator_traits<T>;
+    static constexpr bool has_checked_fma = false;
+};
+
+
+#if defined(__SIZEOF_INT128__)
+/// <summary>
+/// __int128 and unsigned __int128, which std::is_integral only counts as integers in GNU modes (-std=gnu++17).
+/// checked_fma is the closed form the built-in integers use: one overflow-checked multiply and one compare,
+/// and on failure one division finds the last step that still fits.
+/// </summary>
+template <typename T>
+struct overflow_traits<T, std::enable_if_t<std::is_same<T, __int128>::value || std::is_same<T, unsigned __int128>::value>>
+{
+    using U = unsigned __int128;
+    static constexpr bool is_signed = std::is_same<T, __int128>::value;
+
+    static constexpr T max() { return static_cast<T>(is_signed ? ~U{ 0 } >> 1 : ~U{ 0 }); }
+    static constexpr T lowest() { return static_cast<T>(is_signed ? ~(~U{ 0 } >> 1) : U{ 0 }); }
+    static constexpr T zero() { return T{ 0 }; }
+    using accumulator = accumulator_traits<T>;
+    static constexpr bool has_checked_fma = true;
+
+    static constexpr CalcResult<T> checked_fma(T const& start, T const& amount, step_count_t steps, bool subtract)
+    {
+        CalcResult<T> out{};
+        out.value = start;
+        if (steps == 0 || amount == T{ 0 })
+        {
+            return out;
+        }
+
+        // Subtracting a negative amount moves up, the same as adding a positive one. Unsigned
+        // wrap-around gives the magnitude of lowest() and the room left from a negative start.
+        const bool negative = amount < T{ 0 };
+        const bool upward = negative == subtract;
+        const U ustart = static_cast<U>(start);
+        const U magnitude = negative ? U{ 0 } - static_cast<U>(amount) : static_cast<U>(amount);
+        const U room = upward ? static_cast<U>(max()) - ustart : ustart - static_cast<U>(lowest());
+
+        U total = 0;
+        if (!__builtin_mul_overflow(magnitude, static_cast<U>(steps), &total) && total <= room)
+        {
+            out.value = static_cast<T>(upward ? ustart + total : ustart - total);
+            return out;
+        }
+
+        // Fewer than steps whole steps fit, so taken also fits in failed_at_step.
+        const U taken = room / magnitude;
+        const U moved = magnitude * taken;
+        out.value = static_cast<T>(upward ? ustart + moved : ustart - moved);
+        out.success = false;
+        out.failed_at_step = static_cast<step_count_t>(taken);
+        return out;
+    }
+};
+#endif
+
+
+#if defined(__FLT16_MAX__)
+/// <summary>
+/// _Float16, which std::numeric_limits does not describe before C++23. Every step rounds, so checked_fma
+/// takes the steps one at a time with the stepwise loop's check, but stops once a step leaves the value
+/// unchanged: every later step would too, so it reports precision_lost like float and double do. A _Float16
+/// has fewer than 65536 values to pass through, so no walk takes more steps than that.
+/// </summary>
+template <>
+struct overflow_traits<_Float16>
+{
+    static constexpr _Float16 max() { return static_cast<_Float16>(65504.0f); }
+    static constexpr _Float16 lowest() { return static_cast<_Float16>(-65504.0f); }
+    static constexpr _Float16 zero() { return static_cast<_Float16>(0.0f); }
+    using accumulator = accumulator_traits<_Float16>;
+    static constexpr bool has_checked_fma = true;
+
+    static constexpr CalcResult<_Float16> checked_fma(_Float16 const& start, _Float16 const& amount, step_count_t steps, bool subtract)
+    {
+        CalcResult<_Float16> out{};
+        out.value = start;
+        for (step_count_t i = 0; i < steps; ++i)
+        {
+            // The checks add_numbers_stepwise / subtract_numbers_stepwise make before every step.
+            const bool upward = subtract ? amount < zero() : amount > zero();
+            const bool downward = subtract ? amount > zero() : amount < zero();
+            if ((upward && (subtract ? out.value > max() + amount : out.value > max() - amount))
+                || (downward && (subtract ? out.value < lowest() + amount : out.value < lowest() - amount)))
+            {
+                out.success = false;
+                out.failed_at_step = i;
+                return out;
+            }
+
+            const _Float16 next = static_cast<_Float16>(subtract ? out.value - amount : out.value + amount);
+            // As in OverflowGuard: next is kept, since the first step can still flip -0 to +0.
+            if (next == out.value)
+            {
+                out.value = next;
+                out.precision_lost = amount != zero();
+                return out;
+            }
+            out.value = next;
+            if (next != next)
+            {
+                return out; // a NaN stays NaN whatever the steps left
+            }
+        }
+        return out;
+    }
+};
+#endif
+
+
+#if defined(__SIZEOF_INT128__)
+static_assert(overflow_traits<__int128>::checked_fma(overflow_traits<__int128>::max() - 5, 1, 5, false).value == overflow_traits<__int128>::max()
+    && overflow_traits<__int128>::checked_fma(overflow_traits<__int128>::max() - 5, 1, 5, false).success, "__int128 steps up to max()");
+static_assert(!overflow_traits<__int128>::checked_fma(overflow_traits<__int128>::max() - 5, 2, 3, false).success
+    && overflow_traits<__int128>::checked_fma(overflow_traits<__int128>::max() - 5, 2, 3, false).value == overflow_traits<__int128>::max() - 1
+    && overflow_traits<__int128>::checked_fma(overflow_traits<__int128>::max() - 5, 2, 3, false).failed_at_step == 2,
+    "__int128 stops on the last step that fits below max()");
+static_assert(!overflow_traits<__int128>::checked_fma(overflow_traits<__int128>::lowest() + 10, -3, 4, false).success
+    && overflow_traits<__int128>::checked_fma(overflow_traits<__int128>::lowest() + 10, -3, 4, false).value == overflow_traits<__int128>::lowest() + 1
+    && overflow_traits<__int128>::checked_fma(overflow_traits<__int128>::lowest() + 10, -3, 4, false).failed_at_step == 3,
+    "a negative amount stops on the last step that fits above lowest()");
+static_assert(overflow_traits<__int128>::checked_fma(overflow_traits<__int128>::max() - 10, -3, 3, true).value == overflow_traits<__int128>::max() - 1,
+    "subtracting a negative amount moves up");
+static_assert(overflow_traits<__int128>::checked_fma(0, overflow_traits<__int128>::lowest(), 1, false).value == overflow_traits<__int128>::lowest()
+    && !overflow_traits<__int128>::checked_fma(-1, overflow_traits<__int128>::lowest(), 1, false).success
+    && overflow_traits<__int128>::checked_fma(-1, overflow_traits<__int128>::lowest(), 1, false).failed_at_step == 0,
+    "an amount of lowest() has a magnitude one past max()");
+static_assert(!overflow_traits<unsigned __int128>::checked_fma(overflow_traits<unsigned __int128>::max() - 5, 1, 6, false).success
+    && overflow_traits<unsigned __int128>::checked_fma(overflow_traits<unsigned __int128>::max() - 5, 1, 6, false).value == overflow_traits<unsigned __int128>::max()
+    && overflow_traits<unsigned __int128>::checked_fma(overflow_traits<unsigned __int128>::max() - 5, 1, 6, false).failed_at_step == 5,
+    "unsigned __int128 stops at max()");
+static_assert(!overflow_traits<unsigned __int128>::checked_fma(10, 3, 4, true).success && overflow_traits<unsigned __int128>::checked_fma(10, 3, 4, true).value == 1
+    && overflow_traits<unsigned __int128>::checked_fma(10, 3, 4, true).failed_at_step == 3, "unsigned __int128 stops above 0");
+static_assert(overflow_traits<unsigned __int128>::checked_fma(0, 1, ~step_count_t{ 0 }, false).value == ~step_count_t{ 0 },
+    "every 64-bit step count fits");
+#endif
+#if defined(__FLT16_MAX__)
+static_assert(overflow_traits<_Float16>::checked_fma(static_cast<_Float16>(2048.0f), static_cast<_Float16>(1.0f), 3, false).value == static_cast<_Float16>(2048.0f)
+    && overflow_traits<_Float16>::checked_fma(static_cast<_Float16>(2048.0f), static_cast<_Float16>(1.0f), 3, false).success
+    && overflow_traits<_Float16>::checked_fma(static_cast<_Float16>(2048.0f), static_cast<_Float16>(1.0f), 3, false).precision_lost,
+    "1 is lost on a _Float16 of 2048");
+static_assert(!overflow_traits<_Float16>::checked_fma(static_cast<_Float16>(65000.0f), static_cast<_Float16>(100.0f), 10, false).success
+    && overflow_traits<_Float16>::checked_fma(static_cast<_Float16>(65000.0f), static_cast<_Float16>(100.0f), 10, false).value == static_cast<_Float16>(65472.0f)
+    && overflow_traits<_Float16>::checked_fma(static_cast<_Float16>(65000.0f), static_cast<_Float16>(100.0f), 10, false).failed_at_step == 5,
+    "_Float16 stops on the last step that fits below max()");
+static_assert(!overflow_traits<_Float16>::checked_fma(static_cast<_Float16>(-65000.0f), static_cast<_Float16>(100.0f), 10, true).success
+    && overflow_traits<_Float16>::checked_fma(static_cast<_Float16>(-65000.0f), static_cast<_Float16>(100.0f), 10, true).value == static_cast<_Float16>(-65472.0f)
+    && overflow_traits<_Float16>::checked_fma(static_cast<_Float16>(-65000.0f), static_cast<_Float16>(-100.0f), 10, false).failed_at_step == 5,
+    "_Float16 stops on the last step that fits above lowest()");
+#endif
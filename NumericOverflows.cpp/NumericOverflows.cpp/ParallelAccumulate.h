@@ -0,0 +1,255 @@
+// ParallelAccumulate.h : checked_accumulate spread over every core, with exactly the serial result.
+//
+// The range is cut into chunks that are summarised independently, in parallel: each summary holds the chunk's
+// sum in the wide accumulator plus bounds on every running total inside it (or a flag saying the bounds could
+// not be proven). The summaries are then merged in order. A chunk whose bounds keep the total inside T's range
+// is taken in one add; any other chunk is walked again serially from the exact total before it. The first
+// refused element, its index and the last safe total therefore always match checked_accumulate, whatever the
+// number of threads.
+//
+// parallel_checked_accumulate() runs the summaries on its own threads. Where the standard library has parallel
+// algorithms, checked_accumulate(policy, first, last, init) takes std::execution::par_unseq (or any policy) too.
+// Floating point ranges are not associative, so both fall back to the serial walk for them.
+
+#pragma once
+
+#include <algorithm>    // std::max, std::min, std::for_each
+#include <atomic>       // std::atomic_size_t
+#include <cstddef>      // std::size_t, std::ptrdiff_t
+#include <cstdint>      // std::uint64_t
+#include <iterator>     // std::iterator_traits, std::random_access_iterator_tag
+#include <limits>       // std::numeric_limits
+#include <system_error> // std::system_error
+#include <thread>       // std::thread
+#include <type_traits>  // std::is_base_of, std::decay_t, std::enable_if_t
+#include <utility>      // std::forward
+#include <vector>       // std::vector
+
+#if defined(__has_include)
+#if __has_include(<execution>)
+#include <execution>    // std::execution::par_unseq, std::is_execution_policy_v
+#endif
+#endif
+
+#include "CheckedAccumulate.h"
+
+
+namespace accumulate_detail
+{
+    // Ranges shorter than this are not worth starting threads for.
+    constexpr std::size_t parallel_min_elements = std::size_t{ 1 } << 16;
+
+    // Chunks handed out per thread, so a thread that falls behind does not hold everyone up.
+    constexpr std::size_t chunks_per_thread = 8;
+
+    /// <summary>
+    /// One chunk, summarised in the accumulator type W: its sum, and bounds on every running total
+    /// inside it measured from the total it starts on (low <= 0 <= high).
+    /// </summary>
+    template <typename W>
+    struct chunk_summary
+    {
+        W sum{ 0 };
+        W low{ 0 };
+        W high{ 0 };
+        bool proven{ true }; // false when an element was too big to bound, so the merge walks the chunk
+    };
+
+    template <typename T, typename It>
+    chunk_summary<typename accumulator_traits<T>::type> summarize_chunk(It first, std::size_t count)
+    {
+        using W = typename accumulator_traits<T>::type;
+
+        chunk_summary<W> summary{};
+        for (std::size_t done = 0; done < count; done += chunk_elements)
+        {
+            const std::size_t n = std::min(chunk_elements, count - done);
+            std::uint64_t up = 0;
+            std::uint64_t down = 0;
+            if (!block_bounds<T>(first + static_cast<std::ptrdiff_t>(done), n, up, down))
+            {
+                summary.proven = false;
+                return summary;
+            }
+            summary.high = std::max(summary.high, static_cast<W>(summary.sum + static_cast<W>(up)));
+            summary.low = std::min(summary.low, static_cast<W>(summary.sum - static_cast<W>(down)));
+            summary.sum += static_cast<W>(up) - static_cast<W>(down);
+        }
+        return summary;
+    }
+
+    /// <summary>
+    /// How many elements go in each chunk: a whole number of blocks, about chunks_per_thread chunks per thread.
+    /// </summary>
+    inline std::size_t parallel_chunk_size(std::size_t count, std::size_t thread_count)
+    {
+        const std::size_t wanted = count / (thread_count * chunks_per_thread) + 1;
+        const std::size_t blocks = (wanted + chunk_elements - 1) / chunk_elements;
+        return std::max<std::size_t>(blocks, 16) * chunk_elements;
+    }
+
+    /// <summary>
+    /// Merges the chunk summaries in order into the serial result.
+    /// </summary>
+    template <typename T, typename It>
+    CalcResult<T> merge_chunks(It first, It last, T init, std::size_t chunk_size,
+        const std::vector<chunk_summary<typename accumulator_traits<T>::type>>& summaries)
+    {
+        using W = typename accumulator_traits<T>::type;
+        const W maxVal = static_cast<W>(std::numeric_limits<T>::max());
+        const W lowVal = static_cast<W>(std::numeric_limits<T>::lowest());
+        const std::size_t count = static_cast<std::size_t>(last - first);
+
+        W total = static_cast<W>(init);
+        for (std::size_t k = 0; k < summaries.size(); ++k)
+        {
+            const chunk_summary<W>& summary = summaries[k];
+            if (summary.proven && total + summary.high <= maxVal && total + summary.low >= lowVal)
+            {
+                total += summary.sum;
+                continue;
+            }
+
+            // The bounds are not tight, so the chunk may still fit; only the exact walk can say.
+            const std::size_t begin = k * chunk_size;
+            const It chunk_first = first + static_cast<std::ptrdiff_t>(begin);
+            const It chunk_last = first + static_cast<std::ptrdiff_t>(std::min(begin + chunk_size, count));
+            CalcResult<T> r = chunked_accumulate<T>(chunk_first, chunk_last, static_cast<T>(total));
+            if (!r.success)
+            {
+                r.failed_at_step += begin;
+                return r;
+            }
+            total = static_cast<W>(r.value);
+        }
+
+        CalcResult<T> out{};
+        out.value = static_cast<T>(total);
+        return out;
+    }
+
+    template <typename T, typename It>
+    constexpr bool can_run_parallel = use_wide_chunks<T>
+        && std::is_base_of<std::random_access_iterator_tag, typename std::iterator_traits<It>::iterator_category>::value;
+}
+
+
+/// <summary>
+/// checked_accumulate with the chunks summarised on up to thread_count threads (0 = one per core).
+/// The result is identical to checked_accumulate(first, last, init).
+/// </summary>
+/// <typeparam name="RandomIt">A random access iterator over values of type T</typeparam>
+/// <typeparam name="T">A type that with basic math functions</typeparam>
+/// <param name="first">The first element to add</param>
+/// <param name="last">One past the last element to add</param>
+/// <param name="init">The number to start with</param>
+/// <param name="thread_count">Threads to use, 0 for one per core</param>
+/// <returns>The sum with success = true, or the last safe total with success = false and
+/// failed_at_step = the index (from first) of the element that would have overflowed</returns>
+template <typename RandomIt, typename T>
+CalcResult<T> parallel_checked_accumulate(RandomIt first, RandomIt last, T init, unsigned thread_count = 0)
+{
+    accumulate_detail::require_elements_of<RandomIt, T>();
+
+    if (thread_count == 0)
+    {
+        thread_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    if constexpr (!accumulate_detail::can_run_parallel<T, RandomIt>)
+    {
+        return checked_accumulate(first, last, init);
+    }
+    else
+    {
+        const std::size_t count = static_cast<std::size_t>(last - first);
+        if (thread_count <= 1 || count < accumulate_detail::parallel_min_elements)
+        {
+            return checked_accumulate(first, last, init);
+        }
+
+        using W = typename accumulator_traits<T>::type;
+        const std::size_t chunk_size = accumulate_detail::parallel_chunk_size(count, thread_count);
+        std::vector<accumulate_detail::chunk_summary<W>> summaries((count + chunk_size - 1) / chunk_size);
+        thread_count = static_cast<unsigned>(std::min<std::size_t>(thread_count, summaries.size()));
+
+        std::atomic_size_t next{ 0 };
+        auto worker = [&]()
+        {
+            for (std::size_t k = next++; k < summaries.size(); k = next++)
+            {
+                const std::size_t begin = k * chunk_size;
+                summaries[k] = accumulate_detail::summarize_chunk<T>(first + static_cast<std::ptrdiff_t>(begin),
+                    std::min(chunk_size, count - begin));
+            }
+        };
+
+        std::vector<std::thread> pool;
+        try
+        {
+            pool.reserve(thread_count - 1);
+            for (unsigned t = 1; t < thread_count; ++t)
+            {
+                pool.emplace_back(worker);
+            }
+        }
+        catch (const std::system_error&)
+        {
+            // Out of threads: the ones that did start share the work with this one.
+        }
+        worker();
+        for (std::thread& thread : pool)
+        {
+            thread.join();
+        }
+
+        return accumulate_detail::merge_chunks<T>(first, last, init, chunk_size, summaries);
+    }
+}
+
+
+#if defined(__cpp_lib_execution)
+/// <summary>
+/// checked_accumulate with the chunks summarised by the standard parallel algorithms under policy
+/// (std::execution::par_unseq, par or seq). The result is identical to checked_accumulate(first, last, init).
+/// </summary>
+template <typename ExecutionPolicy, typename RandomIt, typename T,
+    std::enable_if_t<std::is_execution_policy_v<std::decay_t<ExecutionPolicy>>, int> = 0>
+CalcResult<T> checked_accumulate(ExecutionPolicy&& policy, RandomIt first, RandomIt last, T init)
+{
+    accumulate_detail::require_elements_of<RandomIt, T>();
+
+    if constexpr (!accumulate_detail::can_run_parallel<T, RandomIt>)
+    {
+        (void)policy;
+        return checked_accumulate(first, last, init);
+    }
+    else
+    {
+        const std::size_t count = static_cast<std::size_t>(last - first);
+        if (count < accumulate_detail::parallel_min_elements)
+        {
+            return checked_accumulate(first, last, init);
+        }
+
+        using W = typename accumulator_traits<T>::type;
+        const std::size_t chunk_size = accumulate_detail::parallel_chunk_size(count, std::max(1u, std::thread::hardware_concurrency()));
+        std::vector<accumulate_detail::chunk_summary<W>> summaries((count + chunk_size - 1) / chunk_size);
+
+        // Each chunk only writes its own summary, so the calls need no synchronisation (par_unseq safe).
+        std::vector<std::size_t> chunks(summaries.size());
+        for (std::size_t k = 0; k < chunks.size(); ++k)
+        {
+            chunks[k] = k;
+        }
+        std::for_each(std::forward<ExecutionPolicy>(policy), chunks.begin(), chunks.end(), [&](std::size_t k)
+        {
+            const std::size_t begin = k * chunk_size;
+            summaries[k] = accumulate_detail::summarize_chunk<T>(first + static_cast<std::ptrdiff_t>(begin),
+                std::min(chunk_size, count - begin));
+        });
+
+        return accumulate_detail::merge_chunks<T>(first, last, init, chunk_size, summaries);
+    }
+}
+#endif
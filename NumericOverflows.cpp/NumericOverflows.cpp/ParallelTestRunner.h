@@ -0,0 +1,214 @@
+// ParallelTestRunner.h : Runs independent console tests on a thread pool and prints their output in order.
+//
+// The type tests in NumericOverflows.cpp write straight to std::cout. While OrderedTestRunner::run() is going,
+// the stream's buffer is swapped for a ThreadRoutedBuffer that sends each thread's writes to the buffer of
+// the test that thread is running. The buffers are printed in the order the tests were added, each one as
+// soon as every test before it has finished, so the output is byte for byte what running them in a row gives.
+//
+// Tests may share the stream as long as they only insert into it: changing its flags (std::boolalpha and
+// friends) from several threads at once is a race, so anything like that must go through a local formatter.
+
+#pragma once
+
+#include <algorithm>          // std::max, std::min
+#include <atomic>             // std::atomic_size_t
+#include <condition_variable> // std::condition_variable
+#include <cstddef>            // std::size_t
+#include <exception>          // std::exception_ptr, std::current_exception, std::rethrow_exception
+#include <functional>         // std::function
+#include <mutex>              // std::mutex, std::unique_lock, std::lock_guard
+#include <ostream>            // std::ostream
+#include <streambuf>          // std::streambuf
+#include <string>             // std::string
+#include <system_error>       // std::system_error
+#include <thread>             // std::thread
+#include <utility>            // std::move
+#include <vector>             // std::vector
+
+
+/// <summary>
+/// A stream buffer that hands every character to the calling thread's capture string.
+/// Threads without one (the main thread) write through to the buffer that was there before.
+/// It has no put area of its own, so nothing is shared between the threads writing through it.
+/// </summary>
+class ThreadRoutedBuffer : public std::streambuf
+{
+public:
+    explicit ThreadRoutedBuffer(std::streambuf* passthrough) : passthrough_(passthrough) {}
+
+    /// <summary>
+    /// Sends this thread's writes to target (or back to the pass-through buffer for nullptr).
+    /// </summary>
+    static void capture_into(std::string* target)
+    {
+        current_target() = target;
+    }
+
+protected:
+    int_type overflow(int_type ch) override
+    {
+        if (traits_type::eq_int_type(ch, traits_type::eof()))
+        {
+            return traits_type::not_eof(ch);
+        }
+
+        const char c = traits_type::to_char_type(ch);
+        return xsputn(&c, 1) == 1 ? ch : traits_type::eof();
+    }
+
+    std::streamsize xsputn(const char* s, std::streamsize count) override
+    {
+        if (std::string* target = current_target())
+        {
+            target->append(s, static_cast<std::size_t>(count));
+            return count;
+        }
+
+        std::lock_guard<std::mutex> lock(passthrough_mutex_);
+        return passthrough_->sputn(s, count);
+    }
+
+    int sync() override
+    {
+        if (current_target() != nullptr)
+        {
+            return 0; // captured output is flushed when the runner prints it
+        }
+
+        std::lock_guard<std::mutex> lock(passthrough_mutex_);
+        return passthrough_->pubsync();
+    }
+
+private:
+    static std::string*& current_target()
+    {
+        static thread_local std::string* target = nullptr;
+        return target;
+    }
+
+    std::streambuf* passthrough_;
+    std::mutex passthrough_mutex_;
+};
+
+
+/// <summary>
+/// A list of independent tests that run side by side and print in the order they were added.
+/// </summary>
+class OrderedTestRunner
+{
+public:
+    using test_function = std::function<void()>;
+
+    /// <summary>
+    /// Adds a test. Its output to the stream given to run() is collected and printed in turn.
+    /// </summary>
+    void add(test_function test)
+    {
+        tests_.push_back(std::move(test));
+    }
+
+    /// <summary>
+    /// Runs every test on up to thread_count threads (0 = one per core) and prints their output
+    /// to out in the order they were added. With one thread the tests simply run in a row.
+    /// An exception thrown by a test is rethrown here once all of them have finished.
+    /// </summary>
+    void run(std::ostream& out, unsigned thread_count = 0)
+    {
+        if (thread_count == 0)
+        {
+            thread_count = std::max(1u, std::thread::hardware_concurrency());
+        }
+        thread_count = static_cast<unsigned>(std::min<std::size_t>(thread_count, tests_.size()));
+
+        if (thread_count <= 1)
+        {
+            for (const test_function& test : tests_)
+            {
+                test();
+            }
+            return;
+        }
+
+        // Anything already buffered in the stream belongs before the tests' output.
+        out.flush();
+        std::streambuf* const original = out.rdbuf();
+        ThreadRoutedBuffer router(original);
+        out.rdbuf(&router);
+
+        std::vector<std::string> outputs(tests_.size());
+        std::vector<std::exception_ptr> errors(tests_.size());
+        std::vector<bool> finished(tests_.size(), false);
+        std::atomic_size_t next{ 0 };
+        std::mutex mutex;
+        std::condition_variable done;
+
+        auto worker = [&]()
+        {
+            for (std::size_t i = next++; i < tests_.size(); i = next++)
+            {
+                ThreadRoutedBuffer::capture_into(&outputs[i]);
+                try
+                {
+                    tests_[i]();
+                }
+                catch (...)
+                {
+                    errors[i] = std::current_exception();
+                }
+                ThreadRoutedBuffer::capture_into(nullptr);
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    finished[i] = true;
+                }
+                done.notify_one();
+            }
+        };
+
+        std::vector<std::thread> pool;
+        try
+        {
+            pool.reserve(thread_count);
+            for (unsigned t = 0; t < thread_count; ++t)
+            {
+                pool.emplace_back(worker);
+            }
+        }
+        catch (const std::system_error&)
+        {
+            // Out of threads: the ones that did start share the work, or this thread does it all.
+            if (pool.empty())
+            {
+                worker();
+            }
+        }
+
+        // Print each test as soon as it and every test before it are done.
+        for (std::size_t i = 0; i < tests_.size(); ++i)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            done.wait(lock, [&]() { return finished[i]; });
+            lock.unlock();
+            original->sputn(outputs[i].data(), static_cast<std::streamsize>(outputs[i].size()));
+        }
+
+        for (std::thread& thread : pool)
+        {
+            thread.join();
+        }
+
+        out.rdbuf(original);
+        out.flush();
+
+        for (const std::exception_ptr& error : errors)
+        {
+            if (error)
+            {
+                std::rethrow_exception(error);
+            }
+        }
+    }
+
+private:
+    std::vector<test_function> tests_;
+};
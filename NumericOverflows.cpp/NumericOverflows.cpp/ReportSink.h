@@ -0,0 +1,343 @@
+// ReportSink.h : A buffered report writer with pluggable console, file and memory backends.
+//
+// Every std::endl on std::cout is a flush, which is one write to the console per line. A ReportSink collects
+// the text in one preallocated buffer instead and only hands it to its backend when the buffer fills up or
+// the sink is flushed (at the latest when it is destroyed). ReportStreamBuffer puts a sink underneath an
+// existing std::ostream, so code printing through std::cout keeps its exact text but stops flushing per line.
+// Numbers are formatted with std::to_chars, giving the same text std::cout's default formatting prints.
+
+#pragma once
+
+#include <charconv>     // std::to_chars, std::chars_format
+#include <cstddef>      // std::size_t
+#include <cstdio>       // std::FILE, std::fopen, std::fwrite, std::fflush, std::fclose, std::snprintf
+#include <limits>       // std::numeric_limits
+#include <ostream>      // std::ostream
+#include <streambuf>    // std::streambuf
+#include <string>       // std::string
+#include <system_error> // std::errc
+#include <type_traits>  // std::is_integral, std::is_floating_point
+#include <vector>       // std::vector
+
+
+/// <summary>
+/// Where a ReportSink sends its text. Backends only ever see whole buffers, not single lines.
+/// </summary>
+class ReportBackend
+{
+public:
+    virtual ~ReportBackend() = default;
+
+    /// <summary>
+    /// Takes size bytes of report text.
+    /// </summary>
+    virtual void write(const char* data, std::size_t size) = 0;
+
+    /// <summary>
+    /// Pushes anything the backend holds on to out to its destination.
+    /// </summary>
+    virtual void flush() {}
+};
+
+/// <summary>
+/// Writes the report to standard output.
+/// </summary>
+class ConsoleReportBackend : public ReportBackend
+{
+public:
+    void write(const char* data, std::size_t size) override
+    {
+        std::fwrite(data, 1, size, stdout);
+    }
+
+    void flush() override
+    {
+        std::fflush(stdout);
+    }
+};
+
+/// <summary>
+/// Writes the report to a file, replacing what was there.
+/// </summary>
+class FileReportBackend : public ReportBackend
+{
+public:
+    explicit FileReportBackend(const std::string& path)
+    {
+#if defined(_MSC_VER)
+        if (fopen_s(&file_, path.c_str(), "wb") != 0)
+        {
+            file_ = nullptr;
+        }
+#else
+        file_ = std::fopen(path.c_str(), "wb");
+#endif
+    }
+
+    ~FileReportBackend() override
+    {
+        if (file_ != nullptr)
+        {
+            std::fclose(file_);
+        }
+    }
+
+    FileReportBackend(const FileReportBackend&) = delete;
+    FileReportBackend& operator=(const FileReportBackend&) = delete;
+
+    /// <summary>
+    /// false when the file could not be opened; everything written is then dropped.
+    /// </summary>
+    bool is_open() const { return file_ != nullptr; }
+
+    void write(const char* data, std::size_t size) override
+    {
+        if (file_ != nullptr)
+        {
+            std::fwrite(data, 1, size, file_);
+        }
+    }
+
+    void flush() override
+    {
+        if (file_ != nullptr)
+        {
+            std::fflush(file_);
+        }
+    }
+
+private:
+    std::FILE* file_{ nullptr };
+};
+
+/// <summary>
+/// Keeps the report in memory, for tests and for callers that post-process it.
+/// </summary>
+class MemoryReportBackend : public ReportBackend
+{
+public:
+    void write(const char* data, std::size_t size) override
+    {
+        text_.append(data, size);
+    }
+
+    const std::string& text() const { return text_; }
+    void clear() { text_.clear(); }
+
+private:
+    std::string text_;
+};
+
+
+// Enough for any 64-bit integer and any %g-style or shortest round-trip float, long double's 5-digit exponents included.
+constexpr std::size_t number_text_capacity = 64;
+
+/// <summary>
+/// Writes value into [first, last) with std::to_chars. Integers print in decimal and floating point values
+/// like std::cout's defaults (%g, 6 digits), or with round_trip as the shortest text that reads back to
+/// exactly the same value. number_text_capacity characters are always enough.
+/// </summary>
+/// <returns>One past the last character written, or nullptr when the text did not fit</returns>
+template <typename T>
+char* write_number(char* first, char* last, T value, bool round_trip = false)
+{
+    static_assert(std::is_integral<T>::value || std::is_floating_point<T>::value, "write_number needs a number");
+    if constexpr (std::is_integral<T>::value)
+    {
+        const std::to_chars_result r = std::to_chars(first, last, value);
+        return r.ec == std::errc{} ? r.ptr : nullptr;
+    }
+    else
+    {
+#if defined(__cpp_lib_to_chars)
+        const std::to_chars_result r = round_trip
+            ? std::to_chars(first, last, value)
+            : std::to_chars(first, last, value, std::chars_format::general, 6);
+        return r.ec == std::errc{} ? r.ptr : nullptr;
+#else
+        // Standard libraries without floating point to_chars get the same text from printf.
+        const int digits = round_trip ? std::numeric_limits<T>::max_digits10 : 6;
+        const int written = std::snprintf(first, static_cast<std::size_t>(last - first), "%.*Lg", digits, static_cast<long double>(value));
+        return written < 0 || written >= last - first ? nullptr : first + written;
+#endif
+    }
+}
+
+/// <summary>
+/// The text of one number, formatted with write_number into a fixed buffer (no allocation).
+/// </summary>
+class FormattedNumber
+{
+public:
+    template <typename T>
+    explicit FormattedNumber(T value, bool round_trip = false)
+    {
+        const char* const end = write_number(text_, text_ + sizeof(text_), value, round_trip);
+        size_ = end == nullptr ? 0 : static_cast<std::size_t>(end - text_);
+    }
+
+    const char* data() const { return text_; }
+    std::size_t size() const { return size_; }
+
+private:
+    char text_[number_text_capacity]{};
+    std::size_t size_{ 0 };
+};
+
+/// <summary>
+/// Writes the number as unformatted output, so it does not read or change the stream's flags.
+/// </summary>
+inline std::ostream& operator<<(std::ostream& out, const FormattedNumber& number)
+{
+    return out.write(number.data(), static_cast<std::streamsize>(number.size()));
+}
+
+/// <summary>
+/// Shorthand for FormattedNumber(value).
+/// </summary>
+template <typename T>
+FormattedNumber format_number(T value)
+{
+    return FormattedNumber(value);
+}
+
+/// <summary>
+/// Shorthand for FormattedNumber(value, true): floating point values keep every digit they need.
+/// </summary>
+template <typename T>
+FormattedNumber format_number_exact(T value)
+{
+    return FormattedNumber(value, true);
+}
+
+
+/// <summary>
+/// Collects report text in a buffer allocated once up front and passes it to a backend in large pieces:
+/// when the buffer is full, when flush() is called, and when the sink is destroyed.
+/// </summary>
+class ReportSink
+{
+public:
+    static constexpr std::size_t default_capacity = 64 * 1024;
+
+    /// <param name="backend">Where the text goes; must outlive the sink</param>
+    /// <param name="capacity">Buffer size in bytes, which is also the flush threshold</param>
+    explicit ReportSink(ReportBackend& backend, std::size_t capacity = default_capacity)
+        : backend_(backend), buffer_(capacity == 0 ? 1 : capacity)
+    {
+    }
+
+    ~ReportSink()
+    {
+        flush();
+    }
+
+    ReportSink(const ReportSink&) = delete;
+    ReportSink& operator=(const ReportSink&) = delete;
+
+    /// <summary>
+    /// Appends size bytes. Text bigger than the whole buffer goes straight to the backend.
+    /// </summary>
+    void write(const char* data, std::size_t size)
+    {
+        if (size > buffer_.size() - used_)
+        {
+            drain();
+            if (size >= buffer_.size())
+            {
+                backend_.write(data, size);
+                return;
+            }
+        }
+
+        std::char_traits<char>::copy(buffer_.data() + used_, data, size);
+        used_ += size;
+    }
+
+    ReportSink& operator<<(const std::string& text)
+    {
+        write(text.data(), text.size());
+        return *this;
+    }
+
+    ReportSink& operator<<(const char* text)
+    {
+        write(text, std::char_traits<char>::length(text));
+        return *this;
+    }
+
+    ReportSink& operator<<(char c)
+    {
+        write(&c, 1);
+        return *this;
+    }
+
+    ReportSink& operator<<(const FormattedNumber& number)
+    {
+        write(number.data(), number.size());
+        return *this;
+    }
+
+    /// <summary>
+    /// Hands everything buffered so far to the backend and flushes it.
+    /// </summary>
+    void flush()
+    {
+        drain();
+        backend_.flush();
+    }
+
+    /// <summary>
+    /// Bytes waiting in the buffer.
+    /// </summary>
+    std::size_t buffered() const { return used_; }
+
+private:
+    void drain()
+    {
+        if (used_ != 0)
+        {
+            backend_.write(buffer_.data(), used_);
+            used_ = 0;
+        }
+    }
+
+    ReportBackend& backend_;
+    std::vector<char> buffer_;
+    std::size_t used_{ 0 };
+};
+
+
+/// <summary>
+/// A stream buffer that feeds a ReportSink, so an existing std::ostream (std::cout) can print into it.
+/// Flushes of the stream (std::endl, std::flush) are ignored; the sink decides when text goes out.
+/// </summary>
+class ReportStreamBuffer : public std::streambuf
+{
+public:
+    explicit ReportStreamBuffer(ReportSink& sink) : sink_(sink) {}
+
+protected:
+    int_type overflow(int_type ch) override
+    {
+        if (!traits_type::eq_int_type(ch, traits_type::eof()))
+        {
+            sink_ << traits_type::to_char_type(ch);
+        }
+        return traits_type::not_eof(ch);
+    }
+
+    std::streamsize xsputn(const char* s, std::streamsize count) override
+    {
+        sink_.write(s, static_cast<std::size_t>(count));
+        return count;
+    }
+
+    int sync() override
+    {
+        return 0;
+    }
+
+private:
+    ReportSink& sink_;
+};
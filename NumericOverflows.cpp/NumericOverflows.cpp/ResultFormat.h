@@ -0,0 +1,44 @@
+// ResultFormat.h : Writes a whole CalcResult<T> as text into a buffer the caller owns.
+//
+// format_result() writes "<value> <success> <failed_at_step> <precision_lost>", the flags as 0 / 1 (the line
+// --bulk prints for every request), with std::to_chars through write_number (ReportSink.h). Nothing touches a
+// stream, a locale or the heap, so a char[result_text_capacity] on the stack is all it needs. Floating point
+// values are written as the shortest text that reads back to the same value unless round_trip is false,
+// which gives std::cout's default %g text instead. Character types print as numbers, like +value does.
+
+#pragma once
+
+#include <cstddef>      // std::size_t
+
+#include "NumericFunctions.h"
+#include "ReportSink.h"
+
+
+// Enough for any result: the value, two flags, a 64-bit step count and the spaces between them.
+constexpr std::size_t result_text_capacity = number_text_capacity + 32;
+
+/// <summary>
+/// Writes result into [first, last) (see the top of this file).
+/// </summary>
+/// <returns>One past the last character written, or nullptr when [first, last) was too small</returns>
+template <typename T>
+char* format_result(char* first, char* last, const CalcResult<T>& result, bool round_trip = true)
+{
+    char* out = write_number(first, last, +result.value, round_trip);
+    if (out == nullptr || last - out < 3)
+    {
+        return nullptr;
+    }
+    *out++ = ' ';
+    *out++ = result.success ? '1' : '0';
+    *out++ = ' ';
+
+    out = write_number(out, last, result.failed_at_step);
+    if (out == nullptr || last - out < 2)
+    {
+        return nullptr;
+    }
+    *out++ = ' ';
+    *out++ = result.precision_lost ? '1' : '0';
+    return out;
+}
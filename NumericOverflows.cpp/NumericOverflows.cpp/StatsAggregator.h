@@ -0,0 +1,197 @@
+// StatsAggregator.h : Lock-free totals of checks, overflows and underflows per type, shared by every thread,
+// with a histogram of the steps the failed calls stopped at.
+//
+// overflow_aggregator keeps its counts in shards. A thread picks a shard the first time it records and keeps it,
+// so threads running side by side (the test runner's pool, bulk workers) add into different cache lines.
+// Every count of a type sits on a cache line of its own within the shard, and so does the step histogram.
+// Writers only do relaxed atomic adds. snapshot() reads every shard with relaxed loads while they carry on,
+// so a metrics exporter can scrape it at any time; a snapshot taken mid-run may count a failure before the
+// check it belongs to, but never loses or doubles anything once the writers are done.
+
+#pragma once
+
+#include <atomic>       // std::atomic, std::memory_order_relaxed
+#include <cstddef>      // std::size_t
+#include <cstdint>      // std::uint64_t
+
+#include "NumericTypeList.h"
+
+
+namespace numeric_stats
+{
+    // One slot per type in tested_types, and a last one shared by every other type.
+    constexpr std::size_t slot_count = tested_types::size + 1;
+
+    // failed_at_step histogram buckets: bucket 0 holds step 0, bucket b holds steps [2^(b - 1), 2^b).
+    constexpr std::size_t step_bucket_count = 65;
+
+    // Shards the counts are spread over. Threads past this many share shards, which is still correct.
+    constexpr std::size_t shard_count = 16;
+
+    /// <summary>
+    /// The counts for one type, added up over every thread.
+    /// </summary>
+    struct type_stats
+    {
+        std::uint64_t checks{ 0 };          // calls to add_numbers / subtract_numbers
+        std::uint64_t overflows{ 0 };       // calls stopped before going past max()
+        std::uint64_t underflows{ 0 };      // calls stopped before going past lowest()
+        std::uint64_t sampled_calls{ 0 };   // calls that were timed
+        std::uint64_t sampled_cycles{ 0 };  // time stamp counter ticks spent in them
+
+        /// <summary>
+        /// The mean ticks per timed call, 0 when none were timed.
+        /// </summary>
+        double cycles_per_call() const
+        {
+            return sampled_calls == 0 ? 0.0 : static_cast<double>(sampled_cycles) / static_cast<double>(sampled_calls);
+        }
+    };
+
+    /// <summary>
+    /// The counts for every type at one moment. per_type[type_index<T, tested_types>::value] holds T,
+    /// per_type[slot_count - 1] every type that is not in tested_types.
+    /// </summary>
+    struct stats_snapshot
+    {
+        type_stats per_type[slot_count]{};
+        std::uint64_t failed_steps[step_bucket_count]{}; // see step_bucket_count
+    };
+
+    /// <summary>
+    /// Where T is counted in a stats_snapshot.
+    /// </summary>
+    template <typename T>
+    constexpr std::size_t slot_of = type_position<T, tested_types>;
+
+    /// <summary>
+    /// The histogram bucket for a failed_at_step: the number of bits it takes.
+    /// </summary>
+    constexpr std::size_t step_bucket(std::uint64_t step)
+    {
+        std::size_t bits = 0;
+        for (; step != 0; step >>= 1)
+        {
+            ++bits;
+        }
+        return bits;
+    }
+
+    /// <summary>
+    /// The smallest step that lands in bucket (step_bucket(step_bucket_floor(b)) == b).
+    /// </summary>
+    constexpr std::uint64_t step_bucket_floor(std::size_t bucket)
+    {
+        return bucket == 0 ? 0 : std::uint64_t{ 1 } << (bucket - 1);
+    }
+
+
+    /// <summary>
+    /// Sharded, cache-line padded atomic counts that any number of threads add to at once (see the top of this file).
+    /// </summary>
+    class overflow_aggregator
+    {
+    public:
+        /// <summary>
+        /// Adds count checks (calls) to slot.
+        /// </summary>
+        void record_checks(std::size_t slot, std::uint64_t count)
+        {
+            add(local_shard().per_type[slot].checks, count);
+        }
+
+        /// <summary>
+        /// Records one call that stopped at failed_at_step: an overflow prevented when upward, else an underflow.
+        /// </summary>
+        void record_failure(std::size_t slot, bool upward, std::uint64_t failed_at_step)
+        {
+            shard& s = local_shard();
+            add(upward ? s.per_type[slot].overflows : s.per_type[slot].underflows, 1);
+            add(s.failed_steps[step_bucket(failed_at_step)], 1);
+        }
+
+        /// <summary>
+        /// Adds calls timed calls that took cycles ticks in all to slot.
+        /// </summary>
+        void record_samples(std::size_t slot, std::uint64_t calls, std::uint64_t cycles)
+        {
+            shard& s = local_shard();
+            add(s.per_type[slot].sampled_calls, calls);
+            add(s.per_type[slot].sampled_cycles, cycles);
+        }
+
+        /// <summary>
+        /// Adds every count in this aggregator to out. Safe to call while other threads are recording.
+        /// </summary>
+        void add_to(stats_snapshot& out) const
+        {
+            for (const shard& s : shards_)
+            {
+                for (std::size_t t = 0; t < slot_count; ++t)
+                {
+                    out.per_type[t].checks += s.per_type[t].checks.load(std::memory_order_relaxed);
+                    out.per_type[t].overflows += s.per_type[t].overflows.load(std::memory_order_relaxed);
+                    out.per_type[t].underflows += s.per_type[t].underflows.load(std::memory_order_relaxed);
+                    out.per_type[t].sampled_calls += s.per_type[t].sampled_calls.load(std::memory_order_relaxed);
+                    out.per_type[t].sampled_cycles += s.per_type[t].sampled_cycles.load(std::memory_order_relaxed);
+                }
+                for (std::size_t b = 0; b < step_bucket_count; ++b)
+                {
+                    out.failed_steps[b] += s.failed_steps[b].load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        /// <summary>
+        /// Every count in this aggregator. Safe to call while other threads are recording.
+        /// </summary>
+        stats_snapshot snapshot() const
+        {
+            stats_snapshot out{};
+            add_to(out);
+            return out;
+        }
+
+    private:
+        using counter = std::atomic<std::uint64_t>;
+
+        struct alignas(64) padded_counts
+        {
+            counter checks{ 0 };
+            counter overflows{ 0 };
+            counter underflows{ 0 };
+            counter sampled_calls{ 0 };
+            counter sampled_cycles{ 0 };
+        };
+
+        struct alignas(64) shard
+        {
+            padded_counts per_type[slot_count];
+            alignas(64) counter failed_steps[step_bucket_count]{};
+        };
+
+        static void add(counter& c, std::uint64_t n)
+        {
+            c.fetch_add(n, std::memory_order_relaxed);
+        }
+
+        shard& local_shard()
+        {
+            // Handed out round robin, once per thread; the same thread uses the same shard of every aggregator.
+            static std::atomic<std::size_t> next_shard{ 0 };
+            thread_local const std::size_t index = next_shard.fetch_add(1, std::memory_order_relaxed) % shard_count;
+            return shards_[index];
+        }
+
+        shard shards_[shard_count];
+    };
+
+    /// <summary>
+    /// The aggregator add_numbers / subtract_numbers report to in NUMERIC_STATS builds.
+    /// </summary>
+    inline overflow_aggregator& shared_aggregator()
+    {
+        static overflow_aggregator aggregator;
+        return aggregator;
+    }
+}